@@ -51,7 +51,7 @@ struct Error
 
   static Error unexpected(parsing::tokens::Text  token, std::string expression)
   {
-    return Error {UNEXPECTED, token, std::move(expression)};
+    return Error {UNEXPECTED, {token, expression}, std::move(expression)};
   }
 
   static Error unexpected_end_of_expression(std::string expression)
@@ -61,12 +61,12 @@ struct Error
 
   static Error wrong_format(parsing::tokens::Text  token, std::string expression)
   {
-    return Error {WRONG_FORMAT, token, std::move(expression)};
+    return Error {WRONG_FORMAT, {token, expression}, std::move(expression)};
   }
 
   static Error missing(parsing::tokens::Text  token, std::string expression)
   {
-    return Error {MISSING, token, std::move(expression)};
+    return Error {MISSING, {token, expression}, std::move(expression)};
   }
 
   static Error unkown()
@@ -76,12 +76,12 @@ struct Error
 
   static Error undefined_variable(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {UNDEFINED_VARIABLE, tokenTxt, std::move(expression)};
+    return Error {UNDEFINED_VARIABLE, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error undefined_function(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {UNDEFINED_FUNCTION, tokenTxt, std::move(expression)};
+    return Error {UNDEFINED_FUNCTION, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error cpp_incorrect_argnum()
@@ -91,12 +91,17 @@ struct Error
 
   static Error mismatched_fun_args(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {CALLING_FUN_ARG_COUNT_MISMATCH, tokenTxt, std::move(expression)};
+    return Error {CALLING_FUN_ARG_COUNT_MISMATCH, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error not_implemented(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {NOT_IMPLEMENTED, tokenTxt, std::move(expression)};
+    return Error {NOT_IMPLEMENTED, {tokenTxt, expression}, std::move(expression)};
+  }
+
+  static Error not_implemented()
+  {
+    return Error {NOT_IMPLEMENTED};
   }
 
   static Error empty_expression(std::string expression = {})
@@ -106,7 +111,7 @@ struct Error
 
   static Error object_in_invalid_state(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {OBJECT_INVALID_STATE, tokenTxt, std::move(expression)};
+    return Error {OBJECT_INVALID_STATE, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error recursion_depth_overflow()
@@ -116,17 +121,17 @@ struct Error
 
   static Error wrong_object_type(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {WRONG_OBJECT_TYPE, tokenTxt, std::move(expression)};
+    return Error {WRONG_OBJECT_TYPE, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error name_already_taken(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {NAME_ALREADY_TAKEN, tokenTxt, std::move(expression)};
+    return Error {NAME_ALREADY_TAKEN, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error object_not_in_world(parsing::tokens::Text tokenTxt, std::string expression)
   {
-    return Error {OBJECT_NOT_IN_WORLD, tokenTxt, std::move(expression)};
+    return Error {OBJECT_NOT_IN_WORLD, {tokenTxt, expression}, std::move(expression)};
   }
 
   static Error object_not_in_world()
@@ -142,8 +147,9 @@ struct Error
   // kind of error
   Type type = UNKNOWN;
 
-  // on what token
-  parsing::tokens::Text token = {};
+  /// @brief on what token
+  /// @note  owns its text: the error can outlive the expression it refers to
+  parsing::tokens::OwnedText token = {};
 
   /// @brief full expression where the parsing error is
   std::string expression = {};
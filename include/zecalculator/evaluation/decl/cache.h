@@ -20,14 +20,95 @@
 **
 ****************************************************************************/
 
+
+#include <zecalculator/evaluation/decl/index_cache.h>
 #include <zecalculator/evaluation/decl/object_cache.h>
 
-#include <unordered_map>
+#include <deque>
+#include <optional>
+#include <variant>
 
 namespace zc {
 namespace eval {
 
-using Cache = std::unordered_map<size_t, ObjectCache>;
+/// @brief cache of the values of one object
+/// @note  the values are either stored by key, or by integer index, which is the default
+///        for sequences and data, see zc::evaluate()
+class SlotCache
+{
+public:
+  /// @brief KEYED: least recently used values get evicted once the buffer size is reached,
+  ///               see ObjectCache
+  ///        INDEXED: a value gets evicted when an index 'capacity' apart from it gets inserted,
+  ///                 the capacity starts at IndexCache::default_capacity and only grows when asked
+  ///                 to, e.g. by the bottom-up evaluation of recursive sequences, see IndexCache
+  enum Backend {KEYED, INDEXED};
+
+  SlotCache(Backend backend = KEYED);
+
+  Backend get_backend() const { return Backend(storage.index()); }
+
+  /// @brief switches the storage of the cache, cached values are dropped
+  void use(Backend backend);
+
+  size_t get_cached_revision() const;
+
+  /// @brief insert new point to cache
+  /// @note  an INDEXED cache ignores keys that are not non-negative integers, or too big for size_t
+  void insert(size_t object_revision, double key, double value);
+
+  /// @brief clears the cache entirely
+  void clear();
+
+  /// @returns the cached value, if it exists
+  std::optional<double> get_value(size_t object_revision, double key);
+
+  /// @returns the underlying storage, nullptr if it's not the one in use
+  ObjectCache* keyed() { return std::get_if<ObjectCache>(&storage); }
+  IndexCache* indexed() { return std::get_if<IndexCache>(&storage); }
+
+  /// @brief set during the outermost evaluation of a recursive sequence using this cache,
+  ///        see zc::evaluate()
+  bool evaluating = false;
+
+protected:
+  /// @returns 'key' as an index, if it is a non-negative integer within the range of size_t
+  static std::optional<size_t> to_index(double key);
+
+  /// @note order matches the one of Backend
+  std::variant<ObjectCache, IndexCache> storage;
+};
+
+/// @brief caches of the objects, indexed directly by their slot
+/// @note  slots are small dense integers, a cache gets created the first time its slot is asked for.
+///        References to the created caches stay valid until they get erased
+class Cache
+{
+public:
+  /// @returns the cache of the object at 'slot', nullptr if it has not been created
+  SlotCache* find(size_t slot);
+  const SlotCache* find(size_t slot) const;
+
+  bool contains(size_t slot) const { return find(slot) != nullptr; }
+
+  /// @returns the cache of the object at 'slot', it gets created with 'backend' if needed
+  /// @note    the backend of an existing cache is left as is
+  SlotCache& get_or_create(size_t slot, SlotCache::Backend backend = SlotCache::KEYED);
+
+  SlotCache& operator [] (size_t slot) { return get_or_create(slot); }
+
+  /// @brief number of created caches
+  size_t size() const { return created_num; }
+
+  void erase(size_t slot);
+
+  void clear();
+
+protected:
+  /// @note std::deque: growing it does not move the existing caches
+  std::deque<std::optional<SlotCache>> caches;
+  size_t created_num = 0;
+};
 
 }
 }
@@ -0,0 +1,142 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/evaluation/decl/evaluation.h>
+
+/// @brief forward mode automatic differentiation: programs are evaluated over dual numbers,
+///        which carry the derivative of each intermediate value along with the value itself
+
+namespace zc {
+
+/// @brief value of an expression, along with its derivative with respect to a chosen variable
+struct Dual
+{
+  double value = 0;
+  double derivative = 0;
+
+  bool operator == (const Dual&) const = default;
+};
+
+namespace eval {
+
+template <parsing::Type type>
+struct DualEvaluator
+{
+  using ValuesContainer =
+    std::conditional_t<type == parsing::Type::FAST,
+                       std::span<const Dual>,
+                       RPNStack<Dual>>;
+
+  std::span<const Dual> input_vars;
+  ValuesContainer subnodes = {};
+  const size_t current_recursion_depth = 0;
+  Cache* cache = nullptr;
+
+  /// @brief only used in the RPN case
+  Error error = {};
+
+  using RetType = std::conditional_t<type == parsing::Type::FAST, std::expected<Dual, Error>, bool>;
+
+  template <class Op>
+  auto handle_binary_operator(Op&&) -> RetType;
+
+  template <class Op>
+  auto handle_unary_operator(Op&&) -> RetType;
+
+  /// @brief returns 'res' in the FAST case, pushes it on the stack otherwise
+  auto push(Dual res, size_t values_consumed) -> RetType;
+
+  /// @brief returns 'err' in the FAST case, stores it otherwise
+  auto fail(Error err) -> RetType;
+
+  auto operator () (zc::parsing::shared::node::Add) -> RetType;
+  auto operator () (zc::parsing::shared::node::Subtract) -> RetType;
+  auto operator () (zc::parsing::shared::node::Multiply) -> RetType;
+  auto operator () (zc::parsing::shared::node::Divide) -> RetType;
+  auto operator () (zc::parsing::shared::node::Power) -> RetType;
+  auto operator () (zc::parsing::shared::node::UnaryMinus) -> RetType;
+
+  auto operator () (const zc::parsing::LinkedFunc<type>*) -> RetType;
+
+  /// @note sequences and data are only defined over integers: their derivative is zero
+  template <class T>
+    requires utils::is_any_of<T, zc::parsing::LinkedSeq<type>, zc::parsing::LinkedData<type>>
+  auto operator () (const T*) -> RetType;
+
+  auto operator () (const zc::parsing::shared::node::InputVariable&) -> RetType;
+
+  auto operator () (const zc::parsing::shared::node::Number&) -> RetType;
+
+  /// @note only builtin functions can be differentiated
+  template <size_t args_num>
+  auto operator () (zc::CppFunction<args_num>) -> RetType;
+
+  auto operator () (const double*) -> RetType;
+
+  auto operator () (const zc::parsing::shared::node::LoadLocal&) -> RetType;
+
+  template <class T>
+    requires zc::parsing::shared::is_superinstruction<T>
+  auto operator () (const T&) -> RetType;
+};
+
+} // namespace eval
+
+/// ================= FAST
+
+/// @brief evaluates a syntax tree along with its derivative
+/// @param input_vars: values of the input variables, each with its own derivative
+///                    e.g. {{x, 1}, {y, 0}} to differentiate with respect to 'x'
+std::expected<Dual, Error> evaluate_dual(parsing::FAST<parsing::Type::FAST>::Ref tree,
+                                         std::span<const Dual> input_vars,
+                                         size_t current_recursion_depth,
+                                         eval::Cache* cache = nullptr);
+
+/// @brief evaluates a syntax tree along with its derivative
+std::expected<Dual, Error> evaluate_dual(const parsing::FAST<parsing::Type::FAST>& tree,
+                                         std::span<const Dual> input_vars,
+                                         eval::Cache* cache = nullptr);
+
+/// ================= RPN
+
+/// @brief evaluates an RPN program along with its derivative
+/// @param input_vars: values of the input variables, each with its own derivative
+///                    e.g. {{x, 1}, {y, 0}} to differentiate with respect to 'x'
+/// @note  calls to functions are evaluated over dual numbers too, their JIT compiled code is not used
+std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                         std::span<const Dual> input_vars,
+                                         size_t current_recursion_depth,
+                                         eval::Cache* cache = nullptr);
+
+/// @brief evaluates an RPN program along with its derivative
+std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                         std::span<const Dual> input_vars,
+                                         eval::Cache* cache = nullptr);
+
+/// @brief evaluates an RPN program, whose max stack depth is already known, along with its derivative
+std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                         size_t stack_depth,
+                                         std::span<const Dual> input_vars,
+                                         size_t current_recursion_depth,
+                                         eval::Cache* cache = nullptr);
+
+} // namespace zc
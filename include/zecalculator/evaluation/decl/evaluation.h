@@ -20,10 +20,15 @@
 **
 ****************************************************************************/
 
+#include <deque>
+
 #include <zecalculator/error.h>
 #include <zecalculator/evaluation/decl/cache.h>
+#include <zecalculator/evaluation/decl/kernels.h>
+#include <zecalculator/math_objects/object_list.h>
 #include <zecalculator/mathworld/decl/mathworld.h>
 #include <zecalculator/parsing/data_structures/decl/fast.h>
+#include <zecalculator/parsing/decl/parser.h>
 #include <zecalculator/utils/name_map.h>
 
 namespace zc {
@@ -32,13 +37,50 @@ namespace eval {
 /// @brief maximum recursion depth to reach before returning an error
 inline size_t max_recursion_depth = 20;
 
+/// @brief maximum number of missing terms a recursive sequence computes bottom-up in a single evaluation,
+///        before returning an error
+inline size_t max_bottom_up_terms = 10'000'000;
+
+/// @brief capacity up to which the index cache of a recursive sequence grows while computing terms bottom-up
+/// @note  terms further back than that get evicted, and recomputed top-down when asked for again
+inline size_t max_bottom_up_cache_capacity = size_t(1) << 20;
+
+/// @brief frames of bytecode programs that need more registers than this are allocated on the heap
+inline constexpr size_t bytecode_stack_registers = 64;
+
+/// @brief stacks of RPN programs that get deeper than this are allocated on the heap
+inline constexpr size_t rpn_stack_size = 64;
+
+/// @brief stack of an RPN evaluation, over a buffer provided by the caller
+/// @note never allocates: the buffer needs to hold the max stack depth of the program
+template <class T = double>
+struct RPNStack
+{
+  T* buffer = nullptr;
+  size_t capacity = 0;
+  size_t stack_size = 0;
+
+  size_t size() const;
+
+  T* begin() const;
+  T* end() const;
+
+  T& front() const;
+  T& back() const;
+
+  void push_back(T val);
+
+  /// @brief only changes the size of the stack: new entries are left uninitialized
+  void resize(size_t new_size);
+};
+
 template <parsing::Type type>
 struct Evaluator
 {
   using ValuesContainer =
     std::conditional_t<type == parsing::Type::FAST,
                        std::span<const double>,
-                       std::vector<double>>;
+                       RPNStack<double>>;
 
   std::span<const double> input_vars;
   ValuesContainer subnodes = {};
@@ -80,6 +122,115 @@ struct Evaluator
 
   auto operator () (const double*) -> RetType;
 
+  auto operator () (const zc::parsing::shared::node::LoadLocal&) -> RetType;
+
+  template <class T>
+    requires zc::parsing::shared::is_superinstruction<T>
+  auto operator () (const T&) -> RetType;
+
+};
+
+/// @brief evaluates an RPN node whose alternative index is known to be 'i', without checking it
+template <size_t i>
+bool evaluate_node(Evaluator<parsing::Type::RPN>& evaluator,
+                   const parsing::shared::Node<parsing::Type::RPN>& node);
+
+/// @brief number of inputs evaluated together, node per node, by the batch evaluator
+inline constexpr size_t batch_size = 256;
+
+/// @brief storage reused across batch evaluations, to not allocate once it has grown large enough
+/// @note  calls to functions are evaluated with a stack of their own: there is one frame
+///        per recursion depth
+struct BatchWorkspace
+{
+  struct Frame
+  {
+    /// @brief storage of the stack, each entry being batch_size contiguous doubles
+    std::vector<double> stack;
+
+    /// @brief inputs of the block being evaluated, one span per input variable
+    std::vector<std::span<const double>> input_vars;
+
+    /// @brief arguments of the functions called at this depth, one span per argument
+    /// @note  sized from the callee, whatever its number of arguments
+    std::vector<std::span<const double>> call_args;
+  };
+
+  /// @note std::deque: growing it does not move the existing frames
+  std::deque<Frame> frames;
+
+  /// @returns the frame of the evaluations at 'depth', created if needed
+  Frame& at(size_t depth);
+};
+
+/// @brief evaluates an RPN program over a block of (at most batch_size) inputs at once
+/// @note each node is applied to every lane of the block before moving to the next node
+///       the stack is stored in structure-of-arrays form: each entry is a block of batch_size values
+struct BatchEvaluator
+{
+  /// @brief one span per input variable, each span holds 'lanes' values
+  std::span<const std::span<const double>> input_vars;
+
+  /// @brief number of values per input variable, i.e. number of evaluations in the block
+  size_t lanes = 0;
+
+  const size_t current_recursion_depth = 0;
+  Cache* cache = nullptr;
+  BatchWorkspace& workspace;
+
+  /// @brief storage of the stack, each entry being batch_size contiguous doubles
+  /// @note  sized from the max stack depth of the program
+  std::span<double> stack = {};
+
+  /// @brief number of entries currently in the stack
+  size_t stack_size = 0;
+
+  Error error = {};
+
+  /// @brief returns the entry that is at 'offset' from the top of the stack
+  double* top(size_t offset = 0);
+
+  /// @brief pushes a new (uninitialized) entry on the top of the stack and returns it
+  double* push();
+
+  bool handle_binary_kernel(kernels::BinaryKernel);
+  bool handle_unary_kernel(kernels::UnaryKernel);
+
+  template <class Op>
+  bool handle_binary_operator(Op&&);
+
+  template <class Op>
+  bool handle_unary_operator(Op&&);
+
+  bool operator () (zc::parsing::shared::node::Add);
+  bool operator () (zc::parsing::shared::node::Subtract);
+  bool operator () (zc::parsing::shared::node::Multiply);
+  bool operator () (zc::parsing::shared::node::Divide);
+  bool operator () (zc::parsing::shared::node::Power);
+  bool operator () (zc::parsing::shared::node::UnaryMinus);
+
+  bool operator () (const zc::parsing::LinkedFunc<parsing::Type::RPN>*);
+
+  template <class T>
+    requires utils::is_any_of<T,
+                              zc::parsing::LinkedSeq<parsing::Type::RPN>,
+                              zc::parsing::LinkedData<parsing::Type::RPN>>
+  bool operator () (const T*);
+
+  bool operator () (const zc::parsing::shared::node::InputVariable&);
+
+  bool operator () (const zc::parsing::shared::node::Number&);
+
+  template <size_t args_num>
+  bool operator () (zc::CppFunction<args_num>);
+
+  bool operator () (const double*);
+
+  bool operator () (const zc::parsing::shared::node::LoadLocal&);
+
+  template <class T>
+    requires zc::parsing::shared::is_superinstruction<T>
+  bool operator () (const T&);
 };
 
 } // namespace eval
@@ -90,7 +241,7 @@ struct Evaluator
 /// @param tree: tree to evaluate
 /// @param input_vars: variables that are given as input to the tree, will shadow any variable in the math world
 /// @param world: math world (contains functions, global constants... etc)
-std::expected<double, Error> evaluate(const parsing::FAST<parsing::Type::FAST>& tree,
+std::expected<double, Error> evaluate(parsing::FAST<parsing::Type::FAST>::Ref tree,
                                      std::span<const double> input_vars,
                                      size_t current_recursion_depth,
                                      eval::Cache* cache = nullptr);
@@ -123,6 +274,70 @@ std::expected<double, Error> evaluate(const parsing::RPN& rpn,
 /// @brief evaluates a syntax tree using a given math world
 std::expected<double, Error> evaluate(const parsing::RPN& rpn, eval::Cache* cache = nullptr);
 
+/// @brief evaluates an RPN program whose max stack depth is already known, without allocating
+/// @param stack_depth: max stack depth of 'rpn', as computed by parsing::max_stack_depth()
+std::expected<double, Error> evaluate(const parsing::RPN& rpn,
+                                     size_t stack_depth,
+                                     std::span<const double> input_vars,
+                                     size_t current_recursion_depth,
+                                     eval::Cache* cache = nullptr);
+
+/// ================= RPN batch
+
+/// @brief evaluates an RPN program over many inputs at once
+/// @param input_vars: one span per input variable, each span containing one value per evaluation
+/// @param out: where to write the results, its size gives the number of evaluations
+/// @note each span in 'input_vars' must hold at least out.size() values
+/// @note evaluation stops at the first error, in which case 'out' is only partially written
+std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                        std::span<const std::span<const double>> input_vars,
+                                        std::span<double> out,
+                                        size_t current_recursion_depth,
+                                        eval::Cache* cache = nullptr);
+
+/// @brief evaluates an RPN program over many inputs at once
+std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                        std::span<const std::span<const double>> input_vars,
+                                        std::span<double> out,
+                                        eval::Cache* cache = nullptr);
+
+/// @brief evaluates an RPN program whose max stack depth is already known over many inputs at once
+/// @param stack_depth: max stack depth of 'rpn', as computed by parsing::max_stack_depth()
+/// @param workspace: storage reused from one call to the next, a local one is used if null
+std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                        size_t stack_depth,
+                                        std::span<const std::span<const double>> input_vars,
+                                        std::span<double> out,
+                                        size_t current_recursion_depth,
+                                        eval::Cache* cache = nullptr,
+                                        eval::BatchWorkspace* workspace = nullptr);
+
+/// @brief evaluates a single input variable RPN program over many inputs at once
+/// @param xs: values of the input variable, one per evaluation
+/// @param out: where to write the results, must have the same size as 'xs'
+std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                        std::span<const double> xs,
+                                        std::span<double> out,
+                                        eval::Cache* cache = nullptr);
+
+/// ================= Bytecode
+
+/// @brief evaluates a register based program
+/// @param bytecode: program to evaluate
+/// @param input_vars: variables that are given as input to the program
+std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode,
+                                     std::span<const double> input_vars,
+                                     size_t current_recursion_depth,
+                                     eval::Cache* cache = nullptr);
+
+/// @brief evaluates a register based program
+std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode,
+                                     std::span<const double> input_vars,
+                                     eval::Cache* cache = nullptr);
+
+/// @brief evaluates a register based program
+std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode, eval::Cache* cache = nullptr);
+
 // Specific to sequences and data
 
 template <class T>
@@ -130,7 +345,9 @@ template <class T>
                             zc::parsing::LinkedSeq<parsing::Type::RPN>,
                             zc::parsing::LinkedData<parsing::Type::RPN>,
                             zc::parsing::LinkedSeq<parsing::Type::FAST>,
-                            zc::parsing::LinkedData<parsing::Type::FAST>>
+                            zc::parsing::LinkedData<parsing::Type::FAST>,
+                            zc::parsing::LinkedSeq<parsing::Type::BYTECODE>,
+                            zc::parsing::LinkedData<parsing::Type::BYTECODE>>
 std::expected<double, Error>
   evaluate(const T& u, double index, size_t current_recursion_depth, eval::Cache* cache = nullptr);
 
@@ -139,7 +356,9 @@ template <class T>
                             zc::parsing::LinkedSeq<parsing::Type::RPN>,
                             zc::parsing::LinkedData<parsing::Type::RPN>,
                             zc::parsing::LinkedSeq<parsing::Type::FAST>,
-                            zc::parsing::LinkedData<parsing::Type::FAST>>
+                            zc::parsing::LinkedData<parsing::Type::FAST>,
+                            zc::parsing::LinkedSeq<parsing::Type::BYTECODE>,
+                            zc::parsing::LinkedData<parsing::Type::BYTECODE>>
 std::expected<double, Error>
   evaluate(const T& u, double index, eval::Cache* cache = nullptr);
 
@@ -0,0 +1,189 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <deque>
+
+#include <zecalculator/evaluation/decl/evaluation.h>
+
+/// @brief reverse mode automatic differentiation: an RPN program is evaluated once while recording
+///        the local partial derivatives of each value in a tape, then the tape is swept backwards
+///        to get the derivatives of the result with respect to every input variable at once
+
+namespace zc {
+namespace eval {
+
+/// @brief record of an RPN evaluation
+/// @note  the first entries are the input variables, then each entry is a value computed by the program
+struct Tape
+{
+  struct Entry
+  {
+    double value;
+
+    /// @brief end of the partial derivatives of this entry in 'partials'
+    /// @note  they start where the ones of the previous entry end
+    size_t partials_end;
+  };
+
+  /// @brief derivative of an entry with respect to one of the entries it is computed from
+  struct Partial
+  {
+    size_t index;
+    double derivative;
+  };
+
+  std::vector<Entry> entries;
+  std::vector<Partial> partials;
+
+  /// @brief derivatives of the entry being backpropagated, kept to reuse their storage
+  std::vector<double> adjoints;
+
+  /// @brief number of input variables, i.e. of entries at the beginning that are not computed
+  size_t input_vars_num = 0;
+
+  /// @brief clears the tape and adds the input variables to it
+  void reset(std::span<const double> input_vars);
+
+  /// @brief true if the entry at 'index' depends on at least one input variable
+  bool is_active(size_t index) const;
+
+  /// @brief returns the partial derivatives of the entry at 'index'
+  std::span<const Partial> get_partials(size_t index) const;
+
+  /// @brief adds an entry that does not depend on any input variable
+  size_t push_constant(double value);
+
+  /// @brief adds an entry computed from other entries
+  /// @param parents: indices of the entries 'value' is computed from
+  /// @param derivative: callable that returns, given a position 'i' in 'parents',
+  ///                    the derivative of 'value' with respect to parents[i]
+  /// @note  'derivative' is only called for active parents: the derivatives with respect to the
+  ///        others are not needed, and may not be defined, e.g. sqrt'(0)
+  template <class Derivative>
+  size_t push(double value, std::span<const size_t> parents, Derivative&& derivative);
+
+  /// @brief sweeps the tape backwards from the entry at 'index'
+  /// @param gradient: where to write the derivative of the entry with respect to each input variable
+  void backpropagate(size_t index, std::span<double> gradient);
+};
+
+/// @brief storage reused across gradient evaluations, to not allocate once it has grown large enough
+/// @note  calls to functions are differentiated with a tape of their own: there is one frame
+///        per recursion depth
+struct GradientWorkspace
+{
+  struct Frame
+  {
+    Tape tape;
+
+    /// @brief used when the stack of the program does not fit in eval::rpn_stack_size
+    std::vector<size_t> stack;
+
+    /// @brief arguments and gradient of the function called from this depth
+    std::vector<double> call_args, call_gradient;
+  };
+
+  /// @note std::deque: growing it does not move the existing frames
+  std::deque<Frame> frames;
+
+  /// @returns the frame of the evaluations at 'depth', created if needed
+  Frame& at(size_t depth);
+};
+
+/// @brief records the evaluation of an RPN program in a tape
+/// @note  the stack holds indices in the tape, rather than values
+struct TapeRecorder
+{
+  std::span<const double> input_vars;
+  RPNStack<size_t> subnodes = {};
+  Tape& tape;
+  GradientWorkspace& workspace;
+  const size_t current_recursion_depth = 0;
+  Cache* cache = nullptr;
+
+  Error error = {};
+
+  /// @brief returns the value at 'offset' from the top of the stack
+  double top_value(size_t offset = 0) const;
+
+  /// @brief replaces the 'values_consumed' entries on the top of the stack with 'index'
+  bool update_stack(size_t index, size_t values_consumed);
+
+  bool operator () (zc::parsing::shared::node::Add);
+  bool operator () (zc::parsing::shared::node::Subtract);
+  bool operator () (zc::parsing::shared::node::Multiply);
+  bool operator () (zc::parsing::shared::node::Divide);
+  bool operator () (zc::parsing::shared::node::Power);
+  bool operator () (zc::parsing::shared::node::UnaryMinus);
+
+  bool operator () (const zc::parsing::LinkedFunc<parsing::Type::RPN>*);
+
+  /// @note sequences and data are only defined over integers: their derivative is zero
+  template <class T>
+    requires utils::is_any_of<T,
+                              zc::parsing::LinkedSeq<parsing::Type::RPN>,
+                              zc::parsing::LinkedData<parsing::Type::RPN>>
+  bool operator () (const T*);
+
+  bool operator () (const zc::parsing::shared::node::InputVariable&);
+
+  bool operator () (const zc::parsing::shared::node::Number&);
+
+  /// @note only builtin functions can be differentiated
+  template <size_t args_num>
+  bool operator () (zc::CppFunction<args_num>);
+
+  bool operator () (const double*);
+
+  bool operator () (const zc::parsing::shared::node::LoadLocal&);
+
+  template <class T>
+    requires zc::parsing::shared::is_superinstruction<T>
+  bool operator () (const T&);
+};
+
+} // namespace eval
+
+/// @brief evaluates an RPN program along with its gradient
+/// @param input_vars: values of the input variables
+/// @param gradient: where to write the derivative of the result with respect to each input variable,
+///                  must have the same size as 'input_vars'
+/// @param workspace: storage to reuse across evaluations, a temporary one is used if nullptr
+/// @returns the value of the program
+/// @note  calls to functions are differentiated too, their JIT compiled code is only used
+///        when none of their arguments depends on the input variables
+std::expected<double, Error> evaluate_gradient(const parsing::RPN& rpn,
+                                               size_t stack_depth,
+                                               std::span<const double> input_vars,
+                                               std::span<double> gradient,
+                                               size_t current_recursion_depth,
+                                               eval::Cache* cache = nullptr,
+                                               eval::GradientWorkspace* workspace = nullptr);
+
+/// @brief evaluates an RPN program along with its gradient
+std::expected<double, Error> evaluate_gradient(const parsing::RPN& rpn,
+                                               std::span<const double> input_vars,
+                                               std::span<double> gradient,
+                                               eval::Cache* cache = nullptr,
+                                               eval::GradientWorkspace* workspace = nullptr);
+
+} // namespace zc
@@ -0,0 +1,93 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2024, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace zc {
+namespace eval {
+
+/// @brief cache for values of integer indices, e.g. of sequences and data
+/// @note  direct-mapped ring buffer: index 'i' goes to slot 'i % capacity', all operations are O(1).
+///        Consecutive indices never collide, which suits sequences evaluated bottom-up. Indices
+///        that are 'capacity' apart do: inserting one evicts the other, see reserve()
+/// @note  the ring gets allocated on the first insertion
+class IndexCache {
+
+public:
+  constexpr static size_t default_capacity = 1024;
+
+  /// @note capacity gets rounded up to the next power of two
+  IndexCache(size_t capacity = default_capacity);
+
+  IndexCache(IndexCache&&) = default;
+  IndexCache(const IndexCache&) = default;
+
+  IndexCache& operator = (IndexCache&&) = default;
+  IndexCache& operator = (const IndexCache&) = default;
+
+  size_t get_capacity() const { return mask + 1; }
+
+  size_t get_cached_revision() const { return cached_object_revision; }
+
+  /// @brief update the capacity, cached values are dropped
+  void set_capacity(size_t new_capacity);
+
+  /// @brief grows the capacity to at least 'min_capacity', cached values are kept
+  /// @note  any 'min_capacity' consecutive indices can then be cached without evicting each other.
+  ///        Does nothing if the capacity is already large enough
+  void reserve(size_t min_capacity);
+
+  /// @brief insert new value to cache, it replaces the one of the index sharing its slot, if any
+  /// @param revision: revision of the cached object
+  void insert(size_t object_revision, size_t index, double value);
+
+  /// @brief clears the cache entirely
+  /// @note  O(1): the entries of previous generations are just ignored
+  void clear();
+
+  /// @returns the cached value, if it exists
+  std::optional<double> get_value(size_t object_revision, size_t index) const;
+
+protected:
+  struct Entry
+  {
+    size_t index = 0;
+    /// @brief generation of the cache the entry got inserted in, zero when never set
+    size_t generation = 0;
+    double value = 0;
+  };
+
+  /// @brief empty until the first insertion, then of size 'mask + 1'
+  std::vector<Entry> entries;
+
+  /// @brief capacity - 1, capacity being a power of two
+  size_t mask = 0;
+
+  size_t generation = 1;
+  size_t cached_object_revision = 0;
+};
+
+}
+}
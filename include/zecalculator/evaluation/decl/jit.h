@@ -0,0 +1,105 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <zecalculator/parsing/data_structures/decl/rpn.h>
+
+/// @brief compiles RPN programs of linked functions to native x86-64 code
+/// @note  only programs that cannot fail are compiled: arithmetic operators, numbers,
+///        input variables, global constants, C++ functions and calls to other compiled functions.
+///        Anything else (sequences, data, recursion...) keeps being evaluated as RPN
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(ZC_DISABLE_JIT)
+#define ZC_JIT
+#endif
+
+namespace zc {
+namespace eval {
+namespace jit {
+
+/// @brief true if the JIT is available on the target platform
+#ifdef ZC_JIT
+inline constexpr bool supported = true;
+#else
+inline constexpr bool supported = false;
+#endif
+
+/// @brief compile linked functions to native code
+/// @note  only takes effect on functions that get (re)linked afterwards
+inline bool enabled = supported;
+
+/// @brief executable memory that holds the machine code of one function
+struct Code
+{
+  void* memory = nullptr;
+  size_t size = 0;
+
+  /// @brief code of the functions called by this one, kept alive as long as this one is
+  std::vector<std::shared_ptr<const Code>> callees = {};
+
+  /// @brief levels of nested function bodies a call goes through, this one included
+  /// @note  e.g. 1 when no other function gets called, 2 when only functions of depth 1 do
+  size_t call_depth = 1;
+
+  Code() = default;
+  Code(const Code&) = delete;
+  Code& operator = (const Code&) = delete;
+
+  ~Code();
+};
+
+/// @brief native function compiled from an RPN program
+/// @note  empty when the program could not be compiled
+struct Function
+{
+  using Entry = double (*)(const double* input_vars);
+
+  Entry entry = nullptr;
+  std::shared_ptr<const Code> code = {};
+
+  explicit operator bool () const;
+
+  /// @brief see Code::call_depth, 0 when empty
+  size_t call_depth() const;
+
+  /// @brief says if the interpreter would run the calls this function makes without overflowing
+  ///        eval::max_recursion_depth, when evaluating its body at 'recursion_depth'
+  /// @note  compiled code does not count its calls: the interpreter runs instead when it does not fit,
+  ///        to return the same error
+  bool fits(size_t recursion_depth) const;
+
+  /// @param input_vars: points to as many values as the function has arguments
+  double operator () (const double* input_vars) const;
+};
+
+/// @brief compiles an RPN program to native code
+/// @param stack_depth: max stack depth of 'rpn', as computed by parsing::max_stack_depth()
+/// @returns an empty Function if the JIT is unsupported or disabled, or if 'rpn'
+///          contains nodes that cannot be compiled, or calls functions that are not compiled
+Function compile(const parsing::RPN& rpn, size_t stack_depth);
+
+} // namespace jit
+} // namespace eval
+} // namespace zc
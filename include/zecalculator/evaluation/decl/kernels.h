@@ -0,0 +1,62 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <cstddef>
+
+#include <zecalculator/math_objects/decl/cpp_function.h>
+
+/// @brief kernels used by the batch evaluator: each one works in-place over contiguous lanes
+/// @note  kernels are vectorized with the widest instruction set enabled at compile time
+///        (AVX-512, AVX or SSE4.1) with a scalar fallback, and give the exact same results
+///        as their scalar counterparts in eval::Evaluator
+/// @note  libm's transcendental functions have no vectorized kernel, only their approximations do,
+///        see zc::approx. Without the approximations, they are evaluated lane per lane over the block
+/// @note  power() is a scalar loop over std::pow: a vectorized power would not give the same results
+
+namespace zc {
+namespace eval {
+namespace kernels {
+
+/// @brief kernel over one array: a[i] = op(a[i])
+using UnaryKernel = void (*)(double* a, size_t n);
+
+/// @brief kernel over two arrays: a[i] = op(a[i], b[i])
+using BinaryKernel = void (*)(double* a, const double* b, size_t n);
+
+void add(double* a, const double* b, size_t n);
+void subtract(double* a, const double* b, size_t n);
+void multiply(double* a, const double* b, size_t n);
+void divide(double* a, const double* b, size_t n);
+void power(double* a, const double* b, size_t n);
+void negate(double* a, size_t n);
+
+/// @brief returns a vectorized kernel that computes the same thing as 'f'
+/// @returns nullptr if 'f' is not a builtin function that has a vectorized kernel
+UnaryKernel find(CppFunction<1> f);
+
+/// @brief returns a vectorized kernel that computes the same thing as 'f'
+/// @returns nullptr if 'f' is not a builtin function that has a vectorized kernel
+BinaryKernel find(CppFunction<2> f);
+
+} // namespace kernels
+} // namespace eval
+} // namespace zc
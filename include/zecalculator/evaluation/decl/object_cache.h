@@ -21,16 +21,21 @@
 ****************************************************************************/
 
 #include <cstddef>
-#include <deque>
+#include <flat_map>
 #include <initializer_list>
+#include <optional>
 #include <ranges>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
-#include <flat_map>
+#include <vector>
 
 namespace zc {
 namespace eval {
 
+/// @brief least recently used cache of key/value pairs
+/// @note  a hash map gives the node of each key, nodes are chained in an intrusive recency list:
+///        lookups, inserts and evictions are all O(1)
 struct ObjectCache {
 
   constexpr static size_t default_buffer_size = 32;
@@ -59,8 +64,11 @@ struct ObjectCache {
 
   size_t get_cached_revision() const { return cached_object_revision; }
 
+  /// @brief number of cached values
+  size_t size() const { return positions.size(); }
+
   /// @brief update the max buffer size to this size
-  /// @note if it's smaller than the previously set one, oldest values are popped out of the cache
+  /// @note if it's smaller than the previously set one, least recently used values are popped out of the cache
   void set_buffer_size(size_t new_buffer_size);
 
   /// @brief insert new point to cache
@@ -72,9 +80,11 @@ struct ObjectCache {
   void clear();
 
   /// @returns the cached value, if it exists
+  /// @note  a hit makes the value the most recently used one
   std::optional<double> get_value(size_t object_revision, double key);
 
-  const std::flat_map<double, double>& get_cache() const { return cache; }
+  /// @returns a copy of the cached values, sorted by key
+  std::flat_map<double, double> get_cache() const;
 
 protected:
   /// @note added 'std::monostate' argument just so we use it as a delegate constructor for both
@@ -84,12 +94,36 @@ protected:
              and std::is_same_v<std::ranges::range_value_t<Values>, double>
   ObjectCache(std::in_place_t, Keys&& keys, Values&& values, size_t object_revision, size_t buffer_size);
 
+  constexpr static size_t npos = size_t(-1);
+
+  struct Node
+  {
+    double key = 0;
+    double value = 0;
+    /// @brief neighbours in the recency list, 'npos' at its ends
+    size_t older = npos;
+    size_t newer = npos;
+  };
+
+  /// @brief removes the node at 'index' from the recency list
+  void unlink(size_t index);
+
+  /// @brief appends the node at 'index' to the recency list, as the most recently used one
+  void link_newest(size_t index);
+
   void pop_oldest();
 
-  std::flat_map<double, double> cache;
+  /// @brief key -> index of its node in 'nodes'
+  std::unordered_map<double, size_t> positions;
+
+  std::vector<Node> nodes;
+
+  /// @brief indices in 'nodes' that are not in use
+  std::vector<size_t> free_nodes;
 
-  /// @brief indices of cache, sorted from oldest to newest
-  std::deque<size_t> age_sorted_indices;
+  /// @brief ends of the recency list
+  size_t oldest = npos;
+  size_t newest = npos;
 
   size_t buffer_size = 0;
   size_t cached_object_revision = 0;
@@ -0,0 +1,130 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <zecalculator/evaluation/decl/evaluation.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// @brief evaluation of RPN programs over many inputs, split in chunks that run on several threads
+
+namespace zc {
+namespace eval {
+
+/// @brief pool of threads that run the tasks of one job at a time
+/// @note  the tasks of a job get split evenly between the workers beforehand, a worker that runs
+///        out of tasks then steals the last tasks of the others: the load stays balanced
+///        even when some tasks take longer, e.g. when they evaluate sequences
+class ThreadPool
+{
+public:
+  /// @param threads_num: number of worker threads, one per hardware thread by default
+  explicit ThreadPool(size_t threads_num = std::max(std::thread::hardware_concurrency(), 1u));
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator = (const ThreadPool&) = delete;
+
+  ~ThreadPool();
+
+  /// @brief number of worker threads
+  size_t size() const { return threads.size(); }
+
+  /// @brief runs 'task(task_index, worker_index)' for every 'task_index' in [0, tasks_num),
+  ///        returns once they are all done
+  /// @note  'worker_index' is in [0, size()): tasks with the same 'worker_index' never run concurrently
+  /// @note  'task' must not throw, and jobs must not be run concurrently on the same pool
+  void run(size_t tasks_num, const std::function<void(size_t, size_t)>& task);
+
+protected:
+  struct Worker
+  {
+    std::mutex mutex;
+
+    /// @brief tasks left, the worker itself takes from the front and thieves from the back
+    std::deque<size_t> tasks;
+
+    /// @brief generation of the job 'tasks' belong to
+    size_t generation = 0;
+  };
+
+  /// @brief loop of the thread of the worker at 'index'
+  void work(size_t index);
+
+  /// @brief takes a task of the job 'generation' from the worker at 'index', or steals one from the others
+  std::optional<size_t> next_task(size_t index, size_t generation);
+
+  std::unique_ptr<Worker[]> workers;
+  std::vector<std::thread> threads;
+
+  /// @brief protects everything below
+  std::mutex mutex;
+  std::condition_variable job_started;
+  std::condition_variable job_done;
+
+  const std::function<void(size_t, size_t)>* job = nullptr;
+
+  /// @brief incremented at each job, so the workers know when a new one starts
+  size_t generation = 0;
+
+  /// @brief tasks of the current job that are not done yet
+  size_t remaining_tasks = 0;
+
+  bool stopping = false;
+};
+
+/// @brief number of evaluations per task of evaluate_parallel()
+inline constexpr size_t parallel_chunk_size = 16 * batch_size;
+
+} // namespace eval
+
+/// @brief evaluates an RPN program over many inputs at once, with the threads of 'pool'
+/// @param input_vars: one span per input variable, each span containing one value per evaluation
+/// @param out: where to write the results, its size gives the number of evaluations
+/// @param chunk_size: number of evaluations each task does, on a single thread
+/// @note  each span in 'input_vars' must hold at least out.size() values
+/// @note  every worker uses its own cache, since eval::Cache is not thread safe
+/// @note  on error, the one met at the smallest index gets returned, and 'out' is only partially written
+std::expected<Ok, Error> evaluate_parallel(const parsing::RPN& rpn,
+                                           std::span<const std::span<const double>> input_vars,
+                                           std::span<double> out,
+                                           eval::ThreadPool& pool,
+                                           size_t chunk_size = eval::parallel_chunk_size);
+
+/// @brief evaluates a single input variable RPN program over many inputs at once, with the threads of 'pool'
+/// @param xs: values of the input variable, one per evaluation
+/// @param out: where to write the results, must have the same size as 'xs'
+std::expected<Ok, Error> evaluate_parallel(const parsing::RPN& rpn,
+                                           std::span<const double> xs,
+                                           std::span<double> out,
+                                           eval::ThreadPool& pool,
+                                           size_t chunk_size = eval::parallel_chunk_size);
+
+} // namespace zc
@@ -20,5 +20,11 @@
 **
 ****************************************************************************/
 
+#include <zecalculator/evaluation/decl/dual.h>
 #include <zecalculator/evaluation/decl/evaluation.h>
+#include <zecalculator/evaluation/decl/gradient.h>
+#include <zecalculator/evaluation/decl/parallel.h>
+#include <zecalculator/evaluation/impl/dual.h>
 #include <zecalculator/evaluation/impl/evaluation.h>
+#include <zecalculator/evaluation/impl/gradient.h>
+#include <zecalculator/evaluation/impl/parallel.h>
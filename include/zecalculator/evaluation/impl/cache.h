@@ -20,4 +20,111 @@
 **
 ****************************************************************************/
 
+
+#include <zecalculator/evaluation/decl/cache.h>
+#include <zecalculator/evaluation/impl/index_cache.h>
 #include <zecalculator/evaluation/impl/object_cache.h>
+
+#include <cmath>
+#include <limits>
+
+namespace zc {
+namespace eval {
+
+inline SlotCache::SlotCache(Backend backend)
+{
+  use(backend);
+}
+
+inline void SlotCache::use(Backend backend)
+{
+  if (backend == INDEXED)
+    storage.emplace<IndexCache>();
+  else storage.emplace<ObjectCache>();
+}
+
+inline std::optional<size_t> SlotCache::to_index(double key)
+{
+  // converting doubles out of the range of size_t is undefined behavior
+  // note: the max of size_t rounds up to a power of two when converted to double, hence the strict comparison
+  constexpr double size_t_limit = double(std::numeric_limits<size_t>::max());
+
+  // also false for NaN keys
+  if (key >= 0 and key < size_t_limit and std::trunc(key) == key)
+    return size_t(key);
+  else return {};
+}
+
+inline size_t SlotCache::get_cached_revision() const
+{
+  return std::visit([](const auto& cache){ return cache.get_cached_revision(); }, storage);
+}
+
+inline void SlotCache::insert(size_t object_revision, double key, double value)
+{
+  if (auto* object_cache = keyed())
+    object_cache->insert(object_revision, key, value);
+  else if (auto index = to_index(key))
+    indexed()->insert(object_revision, *index, value);
+}
+
+inline void SlotCache::clear()
+{
+  std::visit([](auto& cache){ cache.clear(); }, storage);
+}
+
+inline std::optional<double> SlotCache::get_value(size_t object_revision, double key)
+{
+  if (auto* object_cache = keyed())
+    return object_cache->get_value(object_revision, key);
+  else if (auto index = to_index(key))
+    return indexed()->get_value(object_revision, *index);
+  else return {};
+}
+
+inline SlotCache* Cache::find(size_t slot)
+{
+  if (slot < caches.size() and caches[slot])
+    return &*caches[slot];
+  else return nullptr;
+}
+
+inline const SlotCache* Cache::find(size_t slot) const
+{
+  if (slot < caches.size() and caches[slot])
+    return &*caches[slot];
+  else return nullptr;
+}
+
+inline SlotCache& Cache::get_or_create(size_t slot, SlotCache::Backend backend)
+{
+  if (slot >= caches.size())
+    caches.resize(slot + 1);
+
+  auto& cache = caches[slot];
+  if (not cache)
+  {
+    cache.emplace(backend);
+    created_num++;
+  }
+
+  return *cache;
+}
+
+inline void Cache::erase(size_t slot)
+{
+  if (slot < caches.size() and caches[slot])
+  {
+    caches[slot].reset();
+    created_num--;
+  }
+}
+
+inline void Cache::clear()
+{
+  caches.clear();
+  created_num = 0;
+}
+
+}
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <algorithm>
+
+#include <zecalculator/evaluation/decl/dual.h>
+#include <zecalculator/evaluation/impl/evaluation.h>
+#include <zecalculator/math_objects/builtin.h>
+
+namespace zc {
+namespace eval {
+
+template <parsing::Type type>
+template <class Op>
+auto DualEvaluator<type>::handle_binary_operator(Op&& op) -> RetType
+{
+  assert(subnodes.size() >= 2);
+
+  if constexpr (type == parsing::Type::FAST)
+    assert(subnodes.size() == 2);
+
+  return push(op(*(subnodes.end() - 2), *(subnodes.end() - 1)), 2);
+}
+
+template <parsing::Type type>
+template <class Op>
+auto DualEvaluator<type>::handle_unary_operator(Op&& op) -> RetType
+{
+  assert(subnodes.size() >= 1);
+
+  if constexpr (type == parsing::Type::FAST)
+    assert(subnodes.size() == 1);
+
+  return push(op(subnodes.back()), 1);
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::push([[maybe_unused]] Dual res, [[maybe_unused]] size_t values_consumed) -> RetType
+{
+  if constexpr (type == parsing::Type::FAST)
+    return res;
+  else
+  {
+    subnodes.resize(subnodes.size() + 1 - values_consumed);
+    subnodes.back() = res;
+    return true;
+  }
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::fail(Error err) -> RetType
+{
+  if constexpr (type == parsing::Type::FAST)
+    return std::unexpected(std::move(err));
+  else
+  {
+    error = std::move(err);
+    return false;
+  }
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::Add) -> RetType
+{
+  return handle_binary_operator(
+    [](Dual a, Dual b) { return Dual{a.value + b.value, a.derivative + b.derivative}; });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::Subtract) -> RetType
+{
+  return handle_binary_operator(
+    [](Dual a, Dual b) { return Dual{a.value - b.value, a.derivative - b.derivative}; });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::Multiply) -> RetType
+{
+  return handle_binary_operator(
+    [](Dual a, Dual b) {
+      return Dual{a.value * b.value, a.derivative * b.value + a.value * b.derivative};
+    });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::Divide) -> RetType
+{
+  return handle_binary_operator(
+    [](Dual a, Dual b) {
+      const double value = a.value / b.value;
+      return Dual{value, (a.derivative - value * b.derivative) / b.value};
+    });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::Power) -> RetType
+{
+  return handle_binary_operator(
+    [](Dual a, Dual b) {
+      const double value = std::pow(a.value, b.value);
+
+      // terms with a zero factor are skipped: they may not be defined, e.g. log(a) for a <= 0
+      double derivative = 0;
+      if (a.derivative != 0)
+        derivative += b.value * std::pow(a.value, b.value - 1) * a.derivative;
+      if (b.derivative != 0)
+        derivative += value * std::log(a.value) * b.derivative;
+
+      return Dual{value, derivative};
+    });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator () (zc::parsing::shared::node::UnaryMinus) -> RetType
+{
+  return handle_unary_operator([](Dual a) { return Dual{-a.value, -a.derivative}; });
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator()(const zc::parsing::LinkedFunc<type>* f) -> RetType
+{
+  const size_t args_num = f->args_num;
+
+  if constexpr (type == parsing::Type::FAST)
+    assert(subnodes.size() == args_num);
+
+  std::span<const Dual> args(subnodes.end() - args_num, args_num);
+
+  auto exp_res = [&]{
+    if constexpr (type == parsing::Type::RPN)
+      return zc::evaluate_dual(f->repr, f->stack_depth, args, current_recursion_depth + 1, cache);
+    else
+      return zc::evaluate_dual(f->repr, args, current_recursion_depth + 1, cache);
+  }();
+
+  if (exp_res)
+    return push(*exp_res, args_num);
+  else return fail(std::move(exp_res.error()));
+}
+
+template <parsing::Type type>
+template <class T>
+  requires utils::is_any_of<T, zc::parsing::LinkedSeq<type>, zc::parsing::LinkedData<type>>
+auto DualEvaluator<type>::operator()(const T* u) -> RetType
+{
+  if constexpr (type == parsing::Type::FAST)
+    assert(subnodes.size() == 1);
+
+  auto exp_res = zc::evaluate(*u, subnodes.back().value, current_recursion_depth + 1, cache);
+
+  if (exp_res)
+    return push(Dual{*exp_res, 0}, 1);
+  else return fail(std::move(exp_res.error()));
+}
+
+template <parsing::Type type>
+template <size_t args_num>
+auto DualEvaluator<type>::operator()(zc::CppFunction<args_num> cpp_f) -> RetType
+{
+  if constexpr (type == parsing::Type::FAST)
+    assert(subnodes.size() == args_num);
+
+  std::span<const Dual> args(subnodes.end() - args_num, args_num);
+
+  std::array<double, args_num> vals;
+  for (size_t i = 0; i < args_num; i++)
+    vals[i] = args[i].value;
+
+  Dual res = {cpp_f(vals), 0};
+
+  // any function can be applied to constants, e.g. a user-defined C++ function
+  if (std::ranges::all_of(args, [](const Dual& arg) { return arg.derivative == 0; }))
+    return push(res, args_num);
+
+  const auto partial_derivatives = builtin_gradient(cpp_f);
+
+  if (not partial_derivatives)
+    return fail(Error::not_implemented());
+
+  // arguments that do not depend on the variable are skipped: the partial derivative
+  // with respect to them may not be defined, e.g. sqrt'(0)
+  for (size_t i = 0; i < args_num; i++)
+    if (args[i].derivative != 0)
+      res.derivative += (*partial_derivatives)[i](vals) * args[i].derivative;
+
+  return push(res, args_num);
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator()(const double* node) -> RetType
+{
+  return push(Dual{*node, 0}, 0);
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator()(const zc::parsing::shared::node::InputVariable& node) -> RetType
+{
+  // node.index should never be bigger than input_vars.size()
+  assert(node.index < input_vars.size());
+
+  return push(input_vars[node.index], 0);
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator()(const zc::parsing::shared::node::Number& node) -> RetType
+{
+  return push(Dual{node.value, 0}, 0);
+}
+
+template <parsing::Type type>
+auto DualEvaluator<type>::operator()([[maybe_unused]] const zc::parsing::shared::node::LoadLocal& node) -> RetType
+{
+  if constexpr (type == parsing::Type::RPN)
+  {
+    assert(node.index < subnodes.size());
+    return push(subnodes.begin()[node.index], 0);
+  }
+  else
+  {
+    // only RPN programs have local values
+    assert(false);
+    return std::unexpected(Error::unkown());
+  }
+}
+
+template <parsing::Type type>
+template <class T>
+  requires zc::parsing::shared::is_superinstruction<T>
+auto DualEvaluator<type>::operator()([[maybe_unused]] const T& node) -> RetType
+{
+  using namespace zc::parsing::shared::node;
+
+  if constexpr (type == parsing::Type::RPN)
+  {
+    if constexpr (std::is_same_v<T, AddNumber>)
+      subnodes.back().value += node.value;
+    else if constexpr (std::is_same_v<T, MultiplyNumber>)
+    {
+      subnodes.back().value *= node.value;
+      subnodes.back().derivative *= node.value;
+    }
+    else if constexpr (std::is_same_v<T, AddGlobalConstant>)
+      subnodes.back().value += *node.constant;
+    else if constexpr (std::is_same_v<T, MultiplyGlobalConstant>)
+    {
+      subnodes.back().value *= *node.constant;
+      subnodes.back().derivative *= *node.constant;
+    }
+    else if constexpr (std::is_same_v<T, ScaledInput>)
+    {
+      assert(node.index < input_vars.size());
+      const Dual x = input_vars[node.index];
+      return push(Dual{x.value * node.factor, x.derivative * node.factor}, 0);
+    }
+    else
+    {
+      static_assert(std::is_same_v<T, MultiplyAdd>);
+      assert(subnodes.size() >= 3);
+      const Dual c = *(subnodes.end() - 3);
+      const Dual a = *(subnodes.end() - 2);
+      const Dual b = *(subnodes.end() - 1);
+      return push(Dual{std::fma(a.value, b.value, c.value),
+                       a.derivative * b.value + a.value * b.derivative + c.derivative},
+                  3);
+    }
+    return true;
+  }
+  else
+  {
+    // only RPN programs have superinstructions
+    assert(false);
+    return std::unexpected(Error::unkown());
+  }
+}
+
+} // namespace eval
+
+/// =========================================== FAST
+
+inline std::expected<Dual, Error> evaluate_dual(parsing::FAST<parsing::Type::FAST>::Ref tree,
+                                                std::span<const Dual> input_vars,
+                                                size_t current_recursion_depth,
+                                                eval::Cache* cache)
+{
+  if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
+    return std::unexpected(Error::recursion_depth_overflow());
+
+  std::vector<Dual> subnodes;
+  subnodes.reserve(tree.subnodes().size());
+  for (auto subnode : tree.subnodes())
+  {
+    auto eval = evaluate_dual(subnode, input_vars, current_recursion_depth, cache);
+    if (eval) [[likely]]
+      subnodes.push_back(*eval);
+    else [[unlikely]]
+      return eval;
+  }
+
+  return std::visit(eval::DualEvaluator<parsing::Type::FAST>{.input_vars = input_vars,
+                                                             .subnodes = subnodes,
+                                                             .current_recursion_depth
+                                                             = current_recursion_depth,
+                                                             .cache = cache},
+                    tree.node());
+}
+
+inline std::expected<Dual, Error> evaluate_dual(const parsing::FAST<parsing::Type::FAST>& tree,
+                                                std::span<const Dual> input_vars,
+                                                eval::Cache* cache)
+{
+  return evaluate_dual(tree, input_vars, 0, cache);
+}
+
+/// =========================================== RPN
+
+inline std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                                std::span<const Dual> input_vars,
+                                                size_t current_recursion_depth,
+                                                eval::Cache* cache)
+{
+  return evaluate_dual(rpn, parsing::max_stack_depth(rpn), input_vars, current_recursion_depth, cache);
+}
+
+inline std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                                std::span<const Dual> input_vars,
+                                                eval::Cache* cache)
+{
+  return evaluate_dual(rpn, input_vars, 0, cache);
+}
+
+inline std::expected<Dual, Error> evaluate_dual(const parsing::RPN& rpn,
+                                                size_t stack_depth,
+                                                std::span<const Dual> input_vars,
+                                                size_t current_recursion_depth,
+                                                eval::Cache* cache)
+{
+  if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
+    return std::unexpected(Error::recursion_depth_overflow());
+
+  std::array<Dual, eval::rpn_stack_size> stack_buffer;
+  std::vector<Dual> heap_buffer;
+
+  Dual* buffer = stack_buffer.data();
+  if (stack_depth > eval::rpn_stack_size) [[unlikely]]
+  {
+    heap_buffer.resize(stack_depth);
+    buffer = heap_buffer.data();
+  }
+
+  eval::DualEvaluator<parsing::Type::RPN> stateful_evaluator{.input_vars = input_vars,
+                                                             .subnodes = {.buffer = buffer,
+                                                                          .capacity = stack_depth},
+                                                             .current_recursion_depth
+                                                             = current_recursion_depth,
+                                                             .cache = cache};
+
+  for (const auto& node: rpn)
+  {
+    if(not std::visit(stateful_evaluator, node)) [[unlikely]]
+      return std::unexpected(std::move(stateful_evaluator.error));
+  }
+
+  // the values of common subexpressions may remain below the result
+  assert(stateful_evaluator.subnodes.size() >= 1);
+  return stateful_evaluator.subnodes.back();
+}
+
+} // namespace zc
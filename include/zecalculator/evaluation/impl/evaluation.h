@@ -22,11 +22,59 @@
 
 #include <zecalculator/evaluation/decl/evaluation.h>
 #include <zecalculator/evaluation/impl/cache.h>
+#include <zecalculator/evaluation/impl/jit.h>
+#include <zecalculator/evaluation/impl/kernels.h>
 #include <zecalculator/parsing/data_structures/impl/fast.h>
 
 namespace zc {
 namespace eval {
 
+template <class T>
+size_t RPNStack<T>::size() const
+{
+  return stack_size;
+}
+
+template <class T>
+T* RPNStack<T>::begin() const
+{
+  return buffer;
+}
+
+template <class T>
+T* RPNStack<T>::end() const
+{
+  return buffer + stack_size;
+}
+
+template <class T>
+T& RPNStack<T>::front() const
+{
+  assert(stack_size != 0);
+  return buffer[0];
+}
+
+template <class T>
+T& RPNStack<T>::back() const
+{
+  assert(stack_size != 0);
+  return buffer[stack_size - 1];
+}
+
+template <class T>
+void RPNStack<T>::push_back(T val)
+{
+  assert(stack_size < capacity);
+  buffer[stack_size++] = val;
+}
+
+template <class T>
+void RPNStack<T>::resize(size_t new_size)
+{
+  assert(new_size <= capacity);
+  stack_size = new_size;
+}
+
 template <parsing::Type type>
 template <class Op>
 auto Evaluator<type>::handle_binary_operator(Op&& op) -> RetType
@@ -117,10 +165,26 @@ auto Evaluator<type>::operator()(const zc::parsing::LinkedFunc<type>* f) -> RetT
   if constexpr (type == parsing::Type::FAST)
     assert(subnodes.size() == args_num);
 
-  auto exp_res = zc::evaluate(f->repr,
-                              {(subnodes.end() - args_num), args_num},
-                              current_recursion_depth + 1,
-                              cache);
+  if constexpr (type == parsing::Type::RPN)
+    if (f->jit and f->jit.fits(current_recursion_depth + 1))
+    {
+      update_stack(f->jit(subnodes.end() - args_num), args_num);
+      return true;
+    }
+
+  auto exp_res = [&]{
+    if constexpr (type == parsing::Type::RPN)
+      return zc::evaluate(f->repr,
+                          f->stack_depth,
+                          {(subnodes.end() - args_num), args_num},
+                          current_recursion_depth + 1,
+                          cache);
+    else
+      return zc::evaluate(f->repr,
+                          {(subnodes.end() - args_num), args_num},
+                          current_recursion_depth + 1,
+                          cache);
+  }();
 
   if constexpr (type == parsing::Type::FAST)
   {
@@ -233,6 +297,329 @@ auto Evaluator<type>::operator()(const zc::parsing::shared::node::Number& node)
   else return node.value;
 }
 
+template <parsing::Type type>
+auto Evaluator<type>::operator()([[maybe_unused]] const zc::parsing::shared::node::LoadLocal& node) -> RetType
+{
+  if constexpr (type == parsing::Type::RPN)
+  {
+    assert(node.index < subnodes.size());
+    subnodes.push_back(subnodes.begin()[node.index]);
+    return true;
+  }
+  else
+  {
+    // only RPN programs have local values
+    assert(false);
+    return std::unexpected(Error::unkown());
+  }
+}
+
+template <parsing::Type type>
+template <class T>
+  requires zc::parsing::shared::is_superinstruction<T>
+auto Evaluator<type>::operator()([[maybe_unused]] const T& node) -> RetType
+{
+  using namespace zc::parsing::shared::node;
+
+  if constexpr (type == parsing::Type::RPN)
+  {
+    if constexpr (std::is_same_v<T, AddNumber>)
+      subnodes.back() += node.value;
+    else if constexpr (std::is_same_v<T, MultiplyNumber>)
+      subnodes.back() *= node.value;
+    else if constexpr (std::is_same_v<T, AddGlobalConstant>)
+      subnodes.back() += *node.constant;
+    else if constexpr (std::is_same_v<T, MultiplyGlobalConstant>)
+      subnodes.back() *= *node.constant;
+    else if constexpr (std::is_same_v<T, ScaledInput>)
+    {
+      assert(node.index < input_vars.size());
+      subnodes.push_back(input_vars[node.index] * node.factor);
+    }
+    else
+    {
+      static_assert(std::is_same_v<T, MultiplyAdd>);
+      assert(subnodes.size() >= 3);
+      update_stack(std::fma(*(subnodes.end() - 2), *(subnodes.end() - 1), *(subnodes.end() - 3)), 3);
+    }
+    return true;
+  }
+  else
+  {
+    // only RPN programs have superinstructions
+    assert(false);
+    return std::unexpected(Error::unkown());
+  }
+}
+
+template <size_t i>
+bool evaluate_node(Evaluator<parsing::Type::RPN>& evaluator,
+                   const parsing::shared::Node<parsing::Type::RPN>& node)
+{
+  // lets the compiler drop the alternative check of std::get_if
+  if (node.index() != i)
+    std::unreachable();
+
+  return evaluator(*std::get_if<i>(&node));
+}
+
+inline BatchWorkspace::Frame& BatchWorkspace::at(size_t depth)
+{
+  if (frames.size() <= depth)
+    frames.resize(depth + 1);
+  return frames[depth];
+}
+
+inline double* BatchEvaluator::top(size_t offset)
+{
+  assert(offset < stack_size);
+  return stack.data() + (stack_size - 1 - offset) * batch_size;
+}
+
+inline double* BatchEvaluator::push()
+{
+  stack_size++;
+  assert(stack_size * batch_size <= stack.size());
+  return top();
+}
+
+inline bool BatchEvaluator::handle_binary_kernel(kernels::BinaryKernel kernel)
+{
+  assert(stack_size >= 2);
+
+  kernel(top(1), top(0), lanes);
+
+  stack_size--;
+  return true;
+}
+
+inline bool BatchEvaluator::handle_unary_kernel(kernels::UnaryKernel kernel)
+{
+  assert(stack_size >= 1);
+
+  kernel(top(), lanes);
+
+  return true;
+}
+
+template <class Op>
+bool BatchEvaluator::handle_binary_operator(Op&& op)
+{
+  assert(stack_size >= 2);
+
+  double* a = top(1);
+  const double* b = top(0);
+  for (size_t i = 0; i < lanes; i++)
+    a[i] = op(a[i], b[i]);
+
+  stack_size--;
+  return true;
+}
+
+template <class Op>
+bool BatchEvaluator::handle_unary_operator(Op&& op)
+{
+  assert(stack_size >= 1);
+
+  double* a = top();
+  for (size_t i = 0; i < lanes; i++)
+    a[i] = op(a[i]);
+
+  return true;
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::Add)
+{
+  return handle_binary_kernel(kernels::add);
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::Subtract)
+{
+  return handle_binary_kernel(kernels::subtract);
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::Multiply)
+{
+  return handle_binary_kernel(kernels::multiply);
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::Divide)
+{
+  return handle_binary_kernel(kernels::divide);
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::Power)
+{
+  return handle_binary_kernel(kernels::power);
+}
+
+inline bool BatchEvaluator::operator () (zc::parsing::shared::node::UnaryMinus)
+{
+  return handle_unary_kernel(kernels::negate);
+}
+
+inline bool BatchEvaluator::operator () (const zc::parsing::LinkedFunc<parsing::Type::RPN>* f)
+{
+  const size_t args_num = f->args_num;
+  assert(stack_size >= args_num);
+
+  // note: the callee copies its arguments in its own frame, the next call at this depth can reuse them
+  std::vector<std::span<const double>>& args = workspace.at(current_recursion_depth).call_args;
+  args.resize(args_num);
+  for (size_t i = 0; i < args_num; i++)
+    args[i] = std::span<const double>(top(args_num - 1 - i), lanes);
+
+  // the result takes the place of the first argument
+  // note: the callee writes its output only once it's done reading its inputs
+  double* res = args_num != 0 ? top(args_num - 1) : push();
+
+  auto exp_res = zc::evaluate_batch(f->repr,
+                                    f->stack_depth,
+                                    args,
+                                    std::span<double>(res, lanes),
+                                    current_recursion_depth + 1,
+                                    cache,
+                                    &workspace);
+  if (not exp_res) [[unlikely]]
+  {
+    error = std::move(exp_res.error());
+    return false;
+  }
+
+  if (args_num != 0)
+    stack_size -= args_num - 1;
+
+  return true;
+}
+
+template <class T>
+  requires utils::is_any_of<T,
+                            zc::parsing::LinkedSeq<parsing::Type::RPN>,
+                            zc::parsing::LinkedData<parsing::Type::RPN>>
+bool BatchEvaluator::operator () (const T* u)
+{
+  assert(stack_size >= 1);
+
+  // sequences and data are evaluated lane per lane: they are cached per index
+  double* a = top();
+  for (size_t i = 0; i < lanes; i++)
+  {
+    auto exp_res = zc::evaluate(*u, a[i], current_recursion_depth + 1, cache);
+    if (not exp_res) [[unlikely]]
+    {
+      error = std::move(exp_res.error());
+      return false;
+    }
+    a[i] = *exp_res;
+  }
+
+  return true;
+}
+
+inline bool BatchEvaluator::operator () (const zc::parsing::shared::node::InputVariable& node)
+{
+  // node.index should never be bigger than input_vars.size()
+  assert(node.index < input_vars.size());
+
+  std::ranges::copy(input_vars[node.index].first(lanes), push());
+  return true;
+}
+
+inline bool BatchEvaluator::operator () (const zc::parsing::shared::node::Number& node)
+{
+  std::fill_n(push(), lanes, node.value);
+  return true;
+}
+
+template <size_t args_num>
+bool BatchEvaluator::operator () (zc::CppFunction<args_num> cpp_f)
+{
+  assert(stack_size >= args_num);
+
+  if constexpr (args_num == 1)
+  {
+    if (auto kernel = kernels::find(cpp_f))
+      return handle_unary_kernel(kernel);
+    else return handle_unary_operator(cpp_f.f_ptr);
+  }
+  else if constexpr (args_num == 2)
+  {
+    if (auto kernel = kernels::find(cpp_f))
+      return handle_binary_kernel(kernel);
+    else return handle_binary_operator(cpp_f.f_ptr);
+  }
+  else
+  {
+    std::array<double*, args_num> args;
+    for (size_t i = 0; i < args_num; i++)
+      args[i] = top(args_num - 1 - i);
+
+    for (size_t l = 0; l < lanes; l++)
+    {
+      std::array<double, args_num> vals;
+      for (size_t i = 0; i < args_num; i++)
+        vals[i] = args[i][l];
+      args[0][l] = cpp_f(vals);
+    }
+
+    stack_size -= args_num - 1;
+    return true;
+  }
+}
+
+inline bool BatchEvaluator::operator () (const double* node)
+{
+  std::fill_n(push(), lanes, *node);
+  return true;
+}
+
+inline bool BatchEvaluator::operator () (const zc::parsing::shared::node::LoadLocal& node)
+{
+  assert(node.index < stack_size);
+  double* res = push();
+  std::copy_n(stack.data() + node.index * batch_size, lanes, res);
+  return true;
+}
+
+template <class T>
+  requires zc::parsing::shared::is_superinstruction<T>
+bool BatchEvaluator::operator () (const T& node)
+{
+  using namespace zc::parsing::shared::node;
+
+  if constexpr (std::is_same_v<T, AddNumber>)
+    return handle_unary_operator([value = node.value](double a) { return a + value; });
+  else if constexpr (std::is_same_v<T, MultiplyNumber>)
+    return handle_unary_operator([value = node.value](double a) { return a * value; });
+  else if constexpr (std::is_same_v<T, AddGlobalConstant>)
+    return handle_unary_operator([value = *node.constant](double a) { return a + value; });
+  else if constexpr (std::is_same_v<T, MultiplyGlobalConstant>)
+    return handle_unary_operator([value = *node.constant](double a) { return a * value; });
+  else if constexpr (std::is_same_v<T, ScaledInput>)
+  {
+    assert(node.index < input_vars.size());
+    const double* x = input_vars[node.index].data();
+    double* res = push();
+    for (size_t i = 0; i < lanes; i++)
+      res[i] = x[i] * node.factor;
+    return true;
+  }
+  else
+  {
+    static_assert(std::is_same_v<T, MultiplyAdd>);
+    assert(stack_size >= 3);
+
+    double* c = top(2);
+    const double* a = top(1);
+    const double* b = top(0);
+    for (size_t i = 0; i < lanes; i++)
+      c[i] = std::fma(a[i], b[i], c[i]);
+
+    stack_size -= 2;
+    return true;
+  }
+}
+
 } // namespace eval
 
 /// =========================================== FAST
@@ -241,7 +628,7 @@ auto Evaluator<type>::operator()(const zc::parsing::shared::node::Number& node)
 /// @param tree: tree to evaluate
 /// @param input_vars: variables that are given as input to the tree, will shadow any variable in the math world
 /// @param world: math world (contains functions, global constants... etc)
-inline std::expected<double, Error> evaluate(const parsing::FAST<parsing::Type::FAST>& tree,
+inline std::expected<double, Error> evaluate(parsing::FAST<parsing::Type::FAST>::Ref tree,
                                             std::span<const double> input_vars,
                                             size_t current_recursion_depth,
                                             eval::Cache* cache)
@@ -250,8 +637,8 @@ inline std::expected<double, Error> evaluate(const parsing::FAST<parsing::Type::
     return std::unexpected(Error::recursion_depth_overflow());
 
   std::vector<double> subnodes;
-  subnodes.reserve(tree.subnodes.size());
-  for (const auto& subnode : tree.subnodes)
+  subnodes.reserve(tree.subnodes().size());
+  for (auto subnode : tree.subnodes())
   {
     auto eval = evaluate(subnode, input_vars, current_recursion_depth, cache);
     if (eval) [[likely]]
@@ -265,7 +652,7 @@ inline std::expected<double, Error> evaluate(const parsing::FAST<parsing::Type::
                                                          .current_recursion_depth
                                                          = current_recursion_depth,
                                                          .cache = cache},
-                    tree.node);
+                    tree.node());
 }
 
 /// @brief evaluates a syntax tree using a given math world
@@ -294,16 +681,100 @@ inline std::expected<double, Error> evaluate(const parsing::RPN& rpn,
                                             std::span<const double> input_vars,
                                             size_t current_recursion_depth,
                                             eval::Cache* cache)
+{
+  return evaluate(rpn, parsing::max_stack_depth(rpn), input_vars, current_recursion_depth, cache);
+}
+
+inline std::expected<double, Error> evaluate(const parsing::RPN& rpn,
+                                            size_t stack_depth,
+                                            std::span<const double> input_vars,
+                                            size_t current_recursion_depth,
+                                            eval::Cache* cache)
 {
   if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
     return std::unexpected(Error::recursion_depth_overflow());
 
+  std::array<double, eval::rpn_stack_size> stack_buffer;
+  std::vector<double> heap_buffer;
+
+  double* buffer = stack_buffer.data();
+  if (stack_depth > eval::rpn_stack_size) [[unlikely]]
+  {
+    heap_buffer.resize(stack_depth);
+    buffer = heap_buffer.data();
+  }
+
   eval::Evaluator<parsing::Type::RPN> stateful_evaluator{.input_vars = input_vars,
+                                                         .subnodes = {.buffer = buffer,
+                                                                      .capacity = stack_depth},
                                                          .current_recursion_depth
                                                          = current_recursion_depth,
                                                          .cache = cache};
 
-  stateful_evaluator.subnodes.reserve(rpn.size());
+#if defined(__GNUC__)
+
+  // threaded dispatch: the handler of each alternative jumps straight to the handler of
+  // the next node, through a table indexed by the variant's alternative index
+  // note: nodes that cannot fail always return true, their error branch gets optimized out
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+  static void* const handlers[] = {&&node_0,  &&node_1,  &&node_2,  &&node_3,  &&node_4,
+                                   &&node_5,  &&node_6,  &&node_7,  &&node_8,  &&node_9,
+                                   &&node_10, &&node_11, &&node_12, &&node_13, &&node_14,
+                                   &&node_15, &&node_16, &&node_17, &&node_18, &&node_19,
+                                   &&node_20};
+
+  static_assert(std::size(handlers) == std::variant_size_v<parsing::RPN::value_type>);
+
+  auto it = rpn.begin();
+  const auto end = rpn.end();
+
+#define ZC_DISPATCH_NEXT_NODE()                                                                    \
+  if (it == end)                                                                                   \
+    goto done;                                                                                     \
+  goto* handlers[it->index()];
+
+#define ZC_NODE_HANDLER(i)                                                                         \
+  node_##i:                                                                                        \
+  if (not eval::evaluate_node<i>(stateful_evaluator, *it)) [[unlikely]]                            \
+    return std::unexpected(std::move(stateful_evaluator.error));                                   \
+  ++it;                                                                                            \
+  ZC_DISPATCH_NEXT_NODE()
+
+  ZC_DISPATCH_NEXT_NODE()
+
+  ZC_NODE_HANDLER(0)
+  ZC_NODE_HANDLER(1)
+  ZC_NODE_HANDLER(2)
+  ZC_NODE_HANDLER(3)
+  ZC_NODE_HANDLER(4)
+  ZC_NODE_HANDLER(5)
+  ZC_NODE_HANDLER(6)
+  ZC_NODE_HANDLER(7)
+  ZC_NODE_HANDLER(8)
+  ZC_NODE_HANDLER(9)
+  ZC_NODE_HANDLER(10)
+  ZC_NODE_HANDLER(11)
+  ZC_NODE_HANDLER(12)
+  ZC_NODE_HANDLER(13)
+  ZC_NODE_HANDLER(14)
+  ZC_NODE_HANDLER(15)
+  ZC_NODE_HANDLER(16)
+  ZC_NODE_HANDLER(17)
+  ZC_NODE_HANDLER(18)
+  ZC_NODE_HANDLER(19)
+  ZC_NODE_HANDLER(20)
+
+#undef ZC_NODE_HANDLER
+#undef ZC_DISPATCH_NEXT_NODE
+
+done:
+
+#pragma GCC diagnostic pop
+
+#else
 
   for (const auto& node: rpn)
   {
@@ -311,8 +782,11 @@ inline std::expected<double, Error> evaluate(const parsing::RPN& rpn,
       return std::unexpected(std::move(stateful_evaluator.error));
   }
 
-  assert(stateful_evaluator.subnodes.size() == 1);
-  return stateful_evaluator.subnodes.front();
+#endif
+
+  // the values of common subexpressions may remain below the result
+  assert(stateful_evaluator.subnodes.size() >= 1);
+  return stateful_evaluator.subnodes.back();
 }
 
 /// @brief evaluates a syntax tree using a given math world
@@ -329,39 +803,276 @@ inline std::expected<double, Error> evaluate(const parsing::RPN& rpn, eval::Cach
   return evaluate(rpn, std::span<const double, 0>(), 0, cache);
 }
 
+/// =========================================== RPN batch
+
+inline std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                               std::span<const std::span<const double>> input_vars,
+                                               std::span<double> out,
+                                               size_t current_recursion_depth,
+                                               eval::Cache* cache)
+{
+  return evaluate_batch(rpn, parsing::max_stack_depth(rpn), input_vars, out, current_recursion_depth, cache);
+}
+
+inline std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                               size_t stack_depth,
+                                               std::span<const std::span<const double>> input_vars,
+                                               std::span<double> out,
+                                               size_t current_recursion_depth,
+                                               eval::Cache* cache,
+                                               eval::BatchWorkspace* workspace)
+{
+  if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
+    return std::unexpected(Error::recursion_depth_overflow());
+
+  assert(std::ranges::all_of(input_vars, [&](auto vals) { return vals.size() >= out.size(); }));
+
+  // note: only created when needed, creating a workspace allocates
+  std::optional<eval::BatchWorkspace> local_workspace;
+  if (not workspace)
+    workspace = &local_workspace.emplace();
+
+  eval::BatchWorkspace::Frame& frame = workspace->at(current_recursion_depth);
+
+  // the vectors of the frame keep their size from one evaluation to the next
+  if (frame.stack.size() < stack_depth * eval::batch_size)
+    frame.stack.resize(stack_depth * eval::batch_size);
+
+  frame.input_vars.assign(input_vars.begin(), input_vars.end());
+
+  eval::BatchEvaluator stateful_evaluator{.input_vars = frame.input_vars,
+                                          .current_recursion_depth = current_recursion_depth,
+                                          .cache = cache,
+                                          .workspace = *workspace,
+                                          .stack = frame.stack};
+
+  for (size_t offset = 0; offset < out.size(); offset += eval::batch_size)
+  {
+    const size_t lanes = std::min(eval::batch_size, out.size() - offset);
+
+    for (size_t i = 0; i < input_vars.size(); i++)
+      frame.input_vars[i] = input_vars[i].subspan(offset, lanes);
+
+    stateful_evaluator.lanes = lanes;
+    stateful_evaluator.stack_size = 0;
+
+    for (const auto& node: rpn)
+    {
+      if (not std::visit(stateful_evaluator, node)) [[unlikely]]
+        return std::unexpected(std::move(stateful_evaluator.error));
+    }
+
+    // the values of common subexpressions may remain below the result
+    assert(stateful_evaluator.stack_size >= 1);
+    std::copy_n(stateful_evaluator.top(), lanes, out.begin() + offset);
+  }
+
+  return Ok{};
+}
+
+inline std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                               std::span<const std::span<const double>> input_vars,
+                                               std::span<double> out,
+                                               eval::Cache* cache)
+{
+  return evaluate_batch(rpn, input_vars, out, 0, cache);
+}
+
+inline std::expected<Ok, Error> evaluate_batch(const parsing::RPN& rpn,
+                                               std::span<const double> xs,
+                                               std::span<double> out,
+                                               eval::Cache* cache)
+{
+  assert(xs.size() == out.size());
+  return evaluate_batch(rpn, std::array{xs}, out, 0, cache);
+}
+
+/// =========================================== Bytecode
+
+inline std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode,
+                                            std::span<const double> input_vars,
+                                            size_t current_recursion_depth,
+                                            eval::Cache* cache)
+{
+  using parsing::bytecode::OpCode;
+
+  if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
+    return std::unexpected(Error::recursion_depth_overflow());
+
+  assert(input_vars.size() >= bytecode.input_vars_num);
+
+  std::array<double, eval::bytecode_stack_registers> stack_registers;
+  std::vector<double> heap_registers;
+
+  double* r = stack_registers.data();
+  if (bytecode.registers_num > eval::bytecode_stack_registers) [[unlikely]]
+  {
+    heap_registers.resize(bytecode.registers_num);
+    r = heap_registers.data();
+  }
+
+  // frame layout: [ input variables | constants | global constants | temporaries ]
+  double* it = std::copy_n(input_vars.begin(), bytecode.input_vars_num, r);
+  it = std::ranges::copy(bytecode.constants, it).out;
+  for (const double* global_constant: bytecode.global_constants)
+    *(it++) = *global_constant;
+
+  for (const auto& [op, dst, a, b]: bytecode.instructions)
+  {
+    switch (op)
+    {
+    case OpCode::ADD:
+      r[dst] = r[a] + r[b];
+      break;
+    case OpCode::SUBTRACT:
+      r[dst] = r[a] - r[b];
+      break;
+    case OpCode::MULTIPLY:
+      r[dst] = r[a] * r[b];
+      break;
+    case OpCode::DIVIDE:
+      r[dst] = r[a] / r[b];
+      break;
+    case OpCode::POWER:
+      r[dst] = std::pow(r[a], r[b]);
+      break;
+    case OpCode::NEGATE:
+      r[dst] = -r[a];
+      break;
+    case OpCode::MOVE:
+      r[dst] = r[a];
+      break;
+    case OpCode::CALL_CPP_1:
+      r[dst] = bytecode.cpp_functions_1[b].f_ptr(r[a]);
+      break;
+    case OpCode::CALL_CPP_2:
+      r[dst] = bytecode.cpp_functions_2[b].f_ptr(r[a], r[a + 1]);
+      break;
+    case OpCode::CALL_FUNC:
+    {
+      const auto* f = bytecode.functions[b];
+      auto exp_res = zc::evaluate(f->repr,
+                                  std::span<const double>(r + a, f->args_num),
+                                  current_recursion_depth + 1,
+                                  cache);
+      if (not exp_res) [[unlikely]]
+        return exp_res;
+      r[dst] = *exp_res;
+      break;
+    }
+    case OpCode::CALL_SEQ:
+    {
+      auto exp_res = zc::evaluate(*bytecode.sequences[b], r[a], current_recursion_depth + 1, cache);
+      if (not exp_res) [[unlikely]]
+        return exp_res;
+      r[dst] = *exp_res;
+      break;
+    }
+    case OpCode::CALL_DATA:
+    {
+      auto exp_res = zc::evaluate(*bytecode.data[b], r[a], current_recursion_depth + 1, cache);
+      if (not exp_res) [[unlikely]]
+        return exp_res;
+      r[dst] = *exp_res;
+      break;
+    }
+    }
+  }
+
+  return r[bytecode.result];
+}
+
+/// @brief evaluates a register based program
+inline std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode,
+                                            std::span<const double> input_vars,
+                                            eval::Cache* cache)
+{
+  return evaluate(bytecode, input_vars, 0, cache);
+}
+
+/// @brief evaluates a register based program
+inline std::expected<double, Error> evaluate(const parsing::Bytecode& bytecode, eval::Cache* cache)
+{
+  return evaluate(bytecode, std::span<const double, 0>(), 0, cache);
+}
+
 template <class T>
   requires utils::is_any_of<T,
                             zc::parsing::LinkedSeq<parsing::Type::RPN>,
                             zc::parsing::LinkedData<parsing::Type::RPN>,
                             zc::parsing::LinkedSeq<parsing::Type::FAST>,
-                            zc::parsing::LinkedData<parsing::Type::FAST>>
+                            zc::parsing::LinkedData<parsing::Type::FAST>,
+                            zc::parsing::LinkedSeq<parsing::Type::BYTECODE>,
+                            zc::parsing::LinkedData<parsing::Type::BYTECODE>>
 std::expected<double, Error>
   evaluate(const T& u, double index, size_t current_recursion_depth, eval::Cache* cache)
 {
   constexpr bool is_data = utils::is_any_of<T,
                                             zc::parsing::LinkedData<parsing::Type::RPN>,
-                                            zc::parsing::LinkedData<parsing::Type::FAST>>;
+                                            zc::parsing::LinkedData<parsing::Type::FAST>,
+                                            zc::parsing::LinkedData<parsing::Type::BYTECODE>>;
+
+  constexpr bool is_rpn = utils::is_any_of<T,
+                                           zc::parsing::LinkedSeq<parsing::Type::RPN>,
+                                           zc::parsing::LinkedData<parsing::Type::RPN>>;
 
   double rounded_index = std::round(index);
 
   std::expected<double, zc::Error> exp_res = std::unexpected(zc::Error::unkown());
 
-  auto get_cached_value = [&] () -> std::optional<double> {
-    if (cache)
-      if (auto obj_cache_it = cache->find(u.slot); obj_cache_it != cache->end())
-        return obj_cache_it->second.get_value(u.object_revision, rounded_index);
+  auto evaluate_repr = [&](const auto& repr)
+  {
+    if constexpr (is_rpn)
+      return zc::evaluate(repr, u.stack_depth, std::array{rounded_index}, current_recursion_depth, cache);
+    else return zc::evaluate(repr, std::array{rounded_index}, current_recursion_depth, cache);
+  };
+
+  // looked up once, it stays in place when nested evaluations create the caches of other slots
+  // sequences and data are cached by index, unless another backend got selected beforehand
+  eval::SlotCache* slot_cache =
+    cache ? &cache->get_or_create(u.slot, eval::SlotCache::INDEXED) : nullptr;
+
+  auto get_cached_value = [&] (double i) -> std::optional<double> {
+    if (slot_cache)
+      return slot_cache->get_value(u.object_revision, i);
     return {};
   };
 
-  if (rounded_index < 0 or u.repr.empty() or (is_data and rounded_index >= u.repr.size())) [[unlikely]]
+  // 'not (rounded_index >= 0)' also catches NaN indices
+  if (not (rounded_index >= 0) or std::isinf(rounded_index) or u.repr.empty()
+      or (is_data and rounded_index >= u.repr.size())) [[unlikely]]
     exp_res = std::nan("");
 
-  else if (auto opt_val = get_cached_value(); bool(opt_val))
+  else if (auto opt_val = get_cached_value(rounded_index); bool(opt_val))
     exp_res = *opt_val;
 
   else
   {
-    size_t unsigned_index = rounded_index;
+    // converting indices out of the range of size_t is undefined behavior: they get saturated,
+    // only the general term of sequences applies to them anyway
+    constexpr double size_t_limit = double(std::numeric_limits<size_t>::max());
+    const size_t unsigned_index = rounded_index < size_t_limit ? size_t(rounded_index)
+                                                               : std::numeric_limits<size_t>::max();
+
+    // note: only created when needed, creating a cache allocates
+    std::optional<eval::Cache> local_cache;
+
+    // whether this is the outermost evaluation of the sequence, the nested ones being the terms it asks for
+    bool outermost = false;
+
+    if constexpr (not is_data)
+      if (u.recursive and unsigned_index > u.repr.size() - 1)
+      {
+        // the terms asked for more than once are computed once
+        if (not cache)
+        {
+          cache = &local_cache.emplace();
+          slot_cache = &local_cache->get_or_create(u.slot, eval::SlotCache::INDEXED);
+        }
+
+        outermost = not slot_cache->evaluating;
+        slot_cache->evaluating = true;
+      }
 
     if constexpr (is_data)
     {
@@ -369,18 +1080,57 @@ std::expected<double, Error>
       const auto& exp_parsing = u.repr[unsigned_index];
 
       if (exp_parsing)
-        exp_res = zc::evaluate(*exp_parsing, std::array{rounded_index}, current_recursion_depth, cache);
+        exp_res = evaluate_repr(*exp_parsing);
       else exp_res = std::unexpected(exp_parsing.error());
     }
     else
     {
       const auto& parsing = unsigned_index < u.repr.size() ? u.repr[unsigned_index] : u.repr.back();
 
-      exp_res = zc::evaluate(parsing, std::array{rounded_index}, current_recursion_depth, cache);
+      // computes the missing terms bottom-up, each of them being cached before the next one needs it:
+      // the recursion stays one level deep
+      auto evaluate_bottom_up = [&]() -> std::expected<double, zc::Error>
+      {
+        // the general term applies from index 'u.repr.size() - 1'
+        size_t first_missing = unsigned_index;
+        while (first_missing > u.repr.size() - 1 and not get_cached_value(double(first_missing - 1)))
+        {
+          if (unsigned_index - first_missing == eval::max_bottom_up_terms) [[unlikely]]
+            return std::unexpected(Error::recursion_depth_overflow());
+          first_missing--;
+        }
+
+        // the ring of an index cache evicts terms that are 'capacity' apart: it grows along with the
+        // terms computed, so it holds each of them with the one before, up to a bounded capacity
+        eval::IndexCache* index_cache = slot_cache->indexed();
+
+        for (size_t i = first_missing; i != unsigned_index; i++)
+        {
+          if (index_cache)
+            index_cache->reserve(std::min(i - first_missing + 2, eval::max_bottom_up_cache_capacity));
+
+          auto exp_term = zc::evaluate(u, double(i), current_recursion_depth, cache);
+          if (not exp_term)
+            return exp_term;
+        }
+
+        return evaluate_repr(u.repr.back());
+      };
+
+      // recursive sequences are evaluated top-down first: only the terms the recurrence asks for get
+      // computed, e.g. about log10(n) of them for 'u(n) = 0 ; u(n/10) + 1'. When that gets too deep,
+      // the outermost evaluation computes every missing term bottom-up instead
+      exp_res = evaluate_repr(parsing);
+
+      if (outermost and not exp_res and exp_res.error() == Error::recursion_depth_overflow())
+        exp_res = evaluate_bottom_up();
+
+      if (outermost)
+        slot_cache->evaluating = false;
     }
 
-    if (exp_res and cache)
-      (*cache)[u.slot].insert(u.object_revision, rounded_index, *exp_res);
+    if (exp_res and slot_cache)
+      slot_cache->insert(u.object_revision, rounded_index, *exp_res);
   }
 
   return exp_res;
@@ -391,7 +1141,9 @@ template <class T>
                             zc::parsing::LinkedSeq<parsing::Type::RPN>,
                             zc::parsing::LinkedData<parsing::Type::RPN>,
                             zc::parsing::LinkedSeq<parsing::Type::FAST>,
-                            zc::parsing::LinkedData<parsing::Type::FAST>>
+                            zc::parsing::LinkedData<parsing::Type::FAST>,
+                            zc::parsing::LinkedSeq<parsing::Type::BYTECODE>,
+                            zc::parsing::LinkedData<parsing::Type::BYTECODE>>
 std::expected<double, Error>
   evaluate(const T& u, double index, eval::Cache* cache)
 {
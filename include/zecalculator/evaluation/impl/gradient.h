@@ -0,0 +1,389 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/evaluation/decl/gradient.h>
+#include <zecalculator/evaluation/impl/evaluation.h>
+#include <zecalculator/math_objects/builtin.h>
+
+namespace zc {
+namespace eval {
+
+inline void Tape::reset(std::span<const double> input_vars)
+{
+  entries.clear();
+  partials.clear();
+
+  input_vars_num = input_vars.size();
+  for (double val: input_vars)
+    entries.push_back({val, 0});
+}
+
+inline std::span<const Tape::Partial> Tape::get_partials(size_t index) const
+{
+  assert(index < entries.size());
+
+  const size_t begin = index == 0 ? 0 : entries[index - 1].partials_end;
+  return std::span(partials).subspan(begin, entries[index].partials_end - begin);
+}
+
+inline bool Tape::is_active(size_t index) const
+{
+  return index < input_vars_num or not get_partials(index).empty();
+}
+
+inline size_t Tape::push_constant(double value)
+{
+  entries.push_back({value, partials.size()});
+  return entries.size() - 1;
+}
+
+template <class Derivative>
+size_t Tape::push(double value, std::span<const size_t> parents, Derivative&& derivative)
+{
+  for (size_t i = 0; i < parents.size(); i++)
+    if (is_active(parents[i]))
+      partials.push_back({parents[i], derivative(i)});
+
+  return push_constant(value);
+}
+
+inline void Tape::backpropagate(size_t index, std::span<double> gradient)
+{
+  assert(gradient.size() == input_vars_num);
+
+  // adjoints[i]: derivative of the entry at 'index' with respect to the entry at 'i'
+  adjoints.assign(index + 1, 0.);
+  adjoints[index] = 1;
+
+  // entries are computed from previous ones only: one backward sweep is enough
+  for (size_t i = index + 1; i-- > input_vars_num;)
+    for (const Partial& partial: get_partials(i))
+      adjoints[partial.index] += adjoints[i] * partial.derivative;
+
+  for (size_t i = 0; i < gradient.size(); i++)
+    gradient[i] = i < adjoints.size() ? adjoints[i] : 0.;
+}
+
+inline GradientWorkspace::Frame& GradientWorkspace::at(size_t depth)
+{
+  if (frames.size() <= depth)
+    frames.resize(depth + 1);
+  return frames[depth];
+}
+
+inline double TapeRecorder::top_value(size_t offset) const
+{
+  assert(offset < subnodes.size());
+  return tape.entries[*(subnodes.end() - 1 - offset)].value;
+}
+
+inline bool TapeRecorder::update_stack(size_t index, size_t values_consumed)
+{
+  subnodes.resize(subnodes.size() + 1 - values_consumed);
+  subnodes.back() = index;
+  return true;
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::Add)
+{
+  assert(subnodes.size() >= 2);
+  const double a = top_value(1), b = top_value(0);
+  return update_stack(tape.push(a + b, {subnodes.end() - 2, 2}, [](size_t) { return 1.; }), 2);
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::Subtract)
+{
+  assert(subnodes.size() >= 2);
+  const double a = top_value(1), b = top_value(0);
+  return update_stack(tape.push(a - b, {subnodes.end() - 2, 2}, [](size_t i) { return i == 0 ? 1. : -1.; }),
+                      2);
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::Multiply)
+{
+  assert(subnodes.size() >= 2);
+  const double a = top_value(1), b = top_value(0);
+  return update_stack(tape.push(a * b, {subnodes.end() - 2, 2}, [&](size_t i) { return i == 0 ? b : a; }),
+                      2);
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::Divide)
+{
+  assert(subnodes.size() >= 2);
+  const double a = top_value(1), b = top_value(0);
+  const double value = a / b;
+  return update_stack(
+    tape.push(value, {subnodes.end() - 2, 2}, [&](size_t i) { return i == 0 ? 1 / b : -value / b; }), 2);
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::Power)
+{
+  assert(subnodes.size() >= 2);
+  const double a = top_value(1), b = top_value(0);
+  const double value = std::pow(a, b);
+  return update_stack(tape.push(value,
+                                {subnodes.end() - 2, 2},
+                                [&](size_t i)
+                                { return i == 0 ? b * std::pow(a, b - 1) : value * std::log(a); }),
+                      2);
+}
+
+inline bool TapeRecorder::operator () (zc::parsing::shared::node::UnaryMinus)
+{
+  assert(subnodes.size() >= 1);
+  return update_stack(tape.push(-top_value(), {subnodes.end() - 1, 1}, [](size_t) { return -1.; }), 1);
+}
+
+inline bool TapeRecorder::operator () (const zc::parsing::LinkedFunc<parsing::Type::RPN>* f)
+{
+  const size_t args_num = f->args_num;
+  assert(subnodes.size() >= args_num);
+
+  std::span<const size_t> args(subnodes.end() - args_num, args_num);
+
+  // one call at a time from this depth: the storage of the frame is free to reuse
+  GradientWorkspace::Frame& frame = workspace.at(current_recursion_depth);
+  std::vector<double>& vals = frame.call_args;
+  vals.resize(args_num);
+  for (size_t i = 0; i < args_num; i++)
+    vals[i] = tape.entries[args[i]].value;
+
+  // the call does not depend on the input variables: a plain evaluation is enough
+  if (std::ranges::none_of(args, [&](size_t index) { return tape.is_active(index); }))
+  {
+    auto exp_res = [&]() -> std::expected<double, Error> {
+      if (f->jit and f->jit.fits(current_recursion_depth + 1))
+        return f->jit(vals.data());
+      else return zc::evaluate(f->repr, f->stack_depth, vals, current_recursion_depth + 1, cache);
+    }();
+
+    if (not exp_res) [[unlikely]]
+    {
+      error = std::move(exp_res.error());
+      return false;
+    }
+
+    return update_stack(tape.push_constant(*exp_res), args_num);
+  }
+
+  std::vector<double>& gradient = frame.call_gradient;
+  gradient.resize(args_num);
+  auto exp_res = zc::evaluate_gradient(f->repr,
+                                       f->stack_depth,
+                                       vals,
+                                       gradient,
+                                       current_recursion_depth + 1,
+                                       cache,
+                                       &workspace);
+  if (not exp_res) [[unlikely]]
+  {
+    error = std::move(exp_res.error());
+    return false;
+  }
+
+  return update_stack(tape.push(*exp_res, args, [&](size_t i) { return gradient[i]; }), args_num);
+}
+
+template <class T>
+  requires utils::is_any_of<T,
+                            zc::parsing::LinkedSeq<parsing::Type::RPN>,
+                            zc::parsing::LinkedData<parsing::Type::RPN>>
+bool TapeRecorder::operator () (const T* u)
+{
+  assert(subnodes.size() >= 1);
+
+  auto exp_res = zc::evaluate(*u, top_value(), current_recursion_depth + 1, cache);
+  if (not exp_res) [[unlikely]]
+  {
+    error = std::move(exp_res.error());
+    return false;
+  }
+
+  return update_stack(tape.push_constant(*exp_res), 1);
+}
+
+inline bool TapeRecorder::operator () (const zc::parsing::shared::node::InputVariable& node)
+{
+  // node.index should never be bigger than input_vars.size()
+  assert(node.index < input_vars.size());
+
+  // the first entries of the tape are the input variables
+  subnodes.push_back(node.index);
+  return true;
+}
+
+inline bool TapeRecorder::operator () (const zc::parsing::shared::node::Number& node)
+{
+  subnodes.push_back(tape.push_constant(node.value));
+  return true;
+}
+
+template <size_t args_num>
+bool TapeRecorder::operator () (zc::CppFunction<args_num> cpp_f)
+{
+  assert(subnodes.size() >= args_num);
+
+  std::span<const size_t> args(subnodes.end() - args_num, args_num);
+
+  std::array<double, args_num> vals;
+  for (size_t i = 0; i < args_num; i++)
+    vals[i] = tape.entries[args[i]].value;
+
+  const double value = cpp_f(vals);
+
+  if (std::ranges::none_of(args, [&](size_t index) { return tape.is_active(index); }))
+    return update_stack(tape.push_constant(value), args_num);
+
+  const auto partial_derivatives = builtin_gradient(cpp_f);
+  if (not partial_derivatives)
+  {
+    error = Error::not_implemented();
+    return false;
+  }
+
+  return update_stack(tape.push(value, args, [&](size_t i) { return (*partial_derivatives)[i](vals); }),
+                      args_num);
+}
+
+inline bool TapeRecorder::operator () (const double* node)
+{
+  subnodes.push_back(tape.push_constant(*node));
+  return true;
+}
+
+inline bool TapeRecorder::operator () (const zc::parsing::shared::node::LoadLocal& node)
+{
+  // the local value is already in the tape
+  assert(node.index < subnodes.size());
+  subnodes.push_back(subnodes.begin()[node.index]);
+  return true;
+}
+
+template <class T>
+  requires zc::parsing::shared::is_superinstruction<T>
+bool TapeRecorder::operator () (const T& node)
+{
+  using namespace zc::parsing::shared::node;
+
+  if constexpr (std::is_same_v<T, AddNumber>)
+    return update_stack(
+      tape.push(top_value() + node.value, {subnodes.end() - 1, 1}, [](size_t) { return 1.; }), 1);
+  else if constexpr (std::is_same_v<T, MultiplyNumber>)
+    return update_stack(
+      tape.push(top_value() * node.value, {subnodes.end() - 1, 1}, [&](size_t) { return node.value; }), 1);
+  else if constexpr (std::is_same_v<T, AddGlobalConstant>)
+    return update_stack(
+      tape.push(top_value() + *node.constant, {subnodes.end() - 1, 1}, [](size_t) { return 1.; }), 1);
+  else if constexpr (std::is_same_v<T, MultiplyGlobalConstant>)
+    return update_stack(tape.push(top_value() * *node.constant,
+                                  {subnodes.end() - 1, 1},
+                                  [&](size_t) { return *node.constant; }),
+                        1);
+  else if constexpr (std::is_same_v<T, ScaledInput>)
+  {
+    assert(node.index < input_vars.size());
+    const std::array parents = {node.index};
+    subnodes.push_back(
+      tape.push(input_vars[node.index] * node.factor, parents, [&](size_t) { return node.factor; }));
+    return true;
+  }
+  else
+  {
+    static_assert(std::is_same_v<T, MultiplyAdd>);
+    assert(subnodes.size() >= 3);
+    const double c = top_value(2), a = top_value(1), b = top_value(0);
+    return update_stack(tape.push(std::fma(a, b, c),
+                                  {subnodes.end() - 3, 3},
+                                  [&](size_t i) { return i == 0 ? 1. : (i == 1 ? b : a); }),
+                        3);
+  }
+}
+
+} // namespace eval
+
+inline std::expected<double, Error> evaluate_gradient(const parsing::RPN& rpn,
+                                                      size_t stack_depth,
+                                                      std::span<const double> input_vars,
+                                                      std::span<double> gradient,
+                                                      size_t current_recursion_depth,
+                                                      eval::Cache* cache,
+                                                      eval::GradientWorkspace* workspace)
+{
+  if (eval::max_recursion_depth < current_recursion_depth) [[unlikely]]
+    return std::unexpected(Error::recursion_depth_overflow());
+
+  assert(gradient.size() == input_vars.size());
+
+  // note: only created when needed, creating a workspace allocates
+  std::optional<eval::GradientWorkspace> local_workspace;
+  if (not workspace)
+    workspace = &local_workspace.emplace();
+
+  eval::GradientWorkspace::Frame& frame = workspace->at(current_recursion_depth);
+
+  std::array<size_t, eval::rpn_stack_size> stack_buffer;
+
+  size_t* buffer = stack_buffer.data();
+  if (stack_depth > eval::rpn_stack_size) [[unlikely]]
+  {
+    frame.stack.resize(stack_depth);
+    buffer = frame.stack.data();
+  }
+
+  // the vectors of the tape keep their capacity from one evaluation to the next
+  eval::Tape& tape = frame.tape;
+  tape.reset(input_vars);
+  tape.entries.reserve(input_vars.size() + rpn.size());
+  tape.partials.reserve(2 * rpn.size());
+
+  eval::TapeRecorder recorder{.input_vars = input_vars,
+                              .subnodes = {.buffer = buffer, .capacity = stack_depth},
+                              .tape = tape,
+                              .workspace = *workspace,
+                              .current_recursion_depth = current_recursion_depth,
+                              .cache = cache};
+
+  for (const auto& node: rpn)
+  {
+    if (not std::visit(recorder, node)) [[unlikely]]
+      return std::unexpected(std::move(recorder.error));
+  }
+
+  // the values of common subexpressions may remain below the result
+  assert(recorder.subnodes.size() >= 1);
+  const size_t res = recorder.subnodes.back();
+
+  tape.backpropagate(res, gradient);
+
+  return tape.entries[res].value;
+}
+
+inline std::expected<double, Error> evaluate_gradient(const parsing::RPN& rpn,
+                                                      std::span<const double> input_vars,
+                                                      std::span<double> gradient,
+                                                      eval::Cache* cache,
+                                                      eval::GradientWorkspace* workspace)
+{
+  return evaluate_gradient(rpn, parsing::max_stack_depth(rpn), input_vars, gradient, 0, cache, workspace);
+}
+
+} // namespace zc
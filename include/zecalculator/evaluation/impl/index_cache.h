@@ -0,0 +1,92 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2024, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <zecalculator/evaluation/decl/index_cache.h>
+
+namespace zc {
+namespace eval {
+
+inline IndexCache::IndexCache(size_t capacity)
+{
+  set_capacity(capacity);
+}
+
+inline void IndexCache::set_capacity(size_t new_capacity)
+{
+  entries.clear();
+  mask = std::bit_ceil(std::max(new_capacity, size_t(1))) - 1;
+  generation = 1;
+}
+
+inline void IndexCache::reserve(size_t min_capacity)
+{
+  if (min_capacity <= get_capacity())
+    return;
+
+  mask = std::bit_ceil(min_capacity) - 1;
+  if (entries.empty())
+    return;
+
+  std::vector<Entry> old_entries = std::exchange(entries, std::vector<Entry>(get_capacity()));
+
+  // entries of previous generations are dropped, the current generation carries on
+  for (const Entry& entry: old_entries)
+    if (entry.generation == generation)
+      entries[entry.index & mask] = entry;
+}
+
+inline void IndexCache::clear()
+{
+  generation++;
+}
+
+inline void IndexCache::insert(size_t object_revision, size_t index, double value)
+{
+  if (cached_object_revision != object_revision)
+  {
+    clear();
+    cached_object_revision = object_revision;
+  }
+
+  if (entries.empty())
+    entries.resize(get_capacity());
+
+  entries[index & mask] = Entry{.index = index, .generation = generation, .value = value};
+}
+
+inline std::optional<double> IndexCache::get_value(size_t object_revision, size_t index) const
+{
+  if (cached_object_revision != object_revision or entries.empty())
+    return {};
+
+  const Entry& entry = entries[index & mask];
+  if (entry.generation == generation and entry.index == index)
+    return entry.value;
+  else return {};
+}
+
+}
+}
@@ -0,0 +1,438 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#ifdef ZC_JIT
+#include <sys/mman.h>
+#endif
+
+#include <zecalculator/evaluation/decl/evaluation.h>
+#include <zecalculator/evaluation/decl/jit.h>
+#include <zecalculator/parsing/data_structures/decl/utils.h>
+
+namespace zc {
+namespace eval {
+namespace jit {
+
+inline Code::~Code()
+{
+#ifdef ZC_JIT
+  if (memory)
+    munmap(memory, size);
+#endif
+}
+
+inline Function::operator bool () const
+{
+  return entry != nullptr;
+}
+
+inline double Function::operator () (const double* input_vars) const
+{
+  return entry(input_vars);
+}
+
+inline size_t Function::call_depth() const
+{
+  return code ? code->call_depth : 0;
+}
+
+inline bool Function::fits(size_t recursion_depth) const
+{
+  // the deepest body gets evaluated at 'recursion_depth + call_depth() - 1'
+  return recursion_depth + call_depth() <= max_recursion_depth + 1;
+}
+
+namespace internal {
+
+  inline double power(double a, double b)
+  {
+    return std::pow(a, b);
+  }
+
+  inline double multiply_add(double a, double b, double c)
+  {
+    return std::fma(a, b, c);
+  }
+
+  /// @brief memory operand of an SSE2 instruction
+  struct Operand
+  {
+    enum Kind {
+      STACK,    // RPN stack slot 'index', at [rsp + 8*index]
+      INPUT,    // input variable 'index', at [rbx + 8*index]
+      CONSTANT, // constant pool entry 'index', at [rip + displacement]
+      POINTER,  // value pointed to by 'ptr', at [rax] once 'ptr' is loaded in rax
+    };
+
+    Kind kind;
+    size_t index = 0;
+    const double* ptr = nullptr;
+  };
+
+  /// @brief writes the x86-64 machine code of one function, doubles are handled with scalar SSE2 instructions
+  /// @note  the function follows the System V calling convention: rdi points to the input variables
+  ///        and the result is returned in xmm0. Registers are used as follows
+  ///        - rbx: input variables, callee-saved so it survives calls to C++ functions
+  ///        - rsp: RPN stack, one 8 bytes slot per entry
+  ///        - xmm0: top of the RPN stack, only written to its slot when a push or a call needs it
+  ///        - xmm1, xmm2, rax: scratch
+  struct Emitter
+  {
+    std::vector<uint8_t> code = {};
+    std::vector<double> constants = {};
+
+    /// @brief positions of rip relative displacements in 'code', with the constant they refer to
+    std::vector<std::pair<size_t, size_t>> constant_refs = {};
+
+    enum : uint8_t {
+      MOVSD_LOAD = 0x10,
+      MOVSD_STORE = 0x11,
+      MOVAPD = 0x28,
+      XORPD = 0x57,
+      ADDSD = 0x58,
+      MULSD = 0x59,
+      SUBSD = 0x5C,
+      DIVSD = 0x5E,
+    };
+
+    void bytes(std::initializer_list<uint8_t> bs)
+    {
+      code.insert(code.end(), bs);
+    }
+
+    template <class T>
+    void immediate(T val)
+    {
+      const auto raw = std::bit_cast<std::array<uint8_t, sizeof(T)>>(val);
+      code.insert(code.end(), raw.begin(), raw.end());
+    }
+
+    Operand constant(double val)
+    {
+      constants.push_back(val);
+      return Operand{.kind = Operand::CONSTANT, .index = constants.size() - 1};
+    }
+
+    /// @brief mov rax, imm64
+    void load_rax(uint64_t val)
+    {
+      bytes({0x48, 0xB8});
+      immediate(val);
+    }
+
+    /// @brief call imm64, through rax
+    void call(const void* f)
+    {
+      load_rax(std::bit_cast<uint64_t>(f));
+      bytes({0xFF, 0xD0});
+    }
+
+    /// @brief sse instruction between 'xmm' and a memory operand, e.g. addsd xmm, [mem]
+    /// @param prefix: 0xF2 for scalar double instructions
+    void sse(uint8_t opcode, uint8_t xmm, const Operand& mem, uint8_t prefix = 0xF2)
+    {
+      if (mem.kind == Operand::POINTER)
+        load_rax(std::bit_cast<uint64_t>(mem.ptr));
+
+      bytes({prefix, 0x0F, opcode});
+      const uint8_t reg = uint8_t(xmm << 3);
+      switch (mem.kind)
+      {
+      case Operand::STACK:
+        bytes({uint8_t(0x84 | reg), 0x24});
+        immediate(int32_t(8 * mem.index));
+        break;
+      case Operand::INPUT:
+        bytes({uint8_t(0x83 | reg)});
+        immediate(int32_t(8 * mem.index));
+        break;
+      case Operand::CONSTANT:
+        bytes({uint8_t(0x05 | reg)});
+        constant_refs.emplace_back(code.size(), mem.index);
+        immediate(int32_t(0));
+        break;
+      case Operand::POINTER:
+        bytes({reg});
+        break;
+      }
+    }
+
+    /// @brief sse instruction between two xmm registers, e.g. movapd dst, src
+    void sse(uint8_t opcode, uint8_t dst, uint8_t src, uint8_t prefix = 0xF2)
+    {
+      bytes({prefix, 0x0F, opcode, uint8_t(0xC0 | (dst << 3) | src)});
+    }
+
+    void prologue(size_t frame_size)
+    {
+      bytes({0x53});             // push rbx
+      bytes({0x48, 0x89, 0xFB}); // mov rbx, rdi
+      bytes({0x48, 0x81, 0xEC}); // sub rsp, imm32
+      immediate(int32_t(frame_size));
+    }
+
+    void epilogue(size_t frame_size)
+    {
+      bytes({0x48, 0x81, 0xC4}); // add rsp, imm32
+      immediate(int32_t(frame_size));
+      bytes({0x5B});             // pop rbx
+      bytes({0xC3});             // ret
+    }
+
+    /// @brief xmm0 = -xmm0
+    void negate()
+    {
+      load_rax(0x8000000000000000);
+      bytes({0x66, 0x48, 0x0F, 0x6E, 0xC8}); // movq xmm1, rax
+      sse(XORPD, 0, 1, 0x66);
+    }
+
+    /// @brief code followed by the constant pool, with the rip relative displacements resolved
+    std::vector<uint8_t> finalize()
+    {
+      std::vector<uint8_t> res = code;
+      res.resize((res.size() + 7) / 8 * 8, 0xCC);
+      const size_t pool = res.size();
+      for (double cst: constants)
+      {
+        const auto raw = std::bit_cast<std::array<uint8_t, sizeof(double)>>(cst);
+        res.insert(res.end(), raw.begin(), raw.end());
+      }
+      for (auto [pos, cst_index]: constant_refs)
+      {
+        // displacements are relative to the end of the instruction, i.e. right after the displacement
+        const int32_t disp = int32_t(pool + 8 * cst_index) - int32_t(pos + 4);
+        std::memcpy(res.data() + pos, &disp, sizeof(disp));
+      }
+      return res;
+    }
+  };
+
+  /// @brief returns the memory operand that 'node' pushes, if it is a plain value
+  inline std::optional<Operand> pushed_operand(Emitter& emitter,
+                                               const parsing::shared::Node<parsing::Type::RPN>& node)
+  {
+    if (auto* num = std::get_if<parsing::shared::node::Number>(&node))
+      return emitter.constant(num->value);
+    else if (auto* var = std::get_if<parsing::shared::node::InputVariable>(&node))
+      return Operand{.kind = Operand::INPUT, .index = var->index};
+    else if (auto* ptr = std::get_if<const double*>(&node))
+      return Operand{.kind = Operand::POINTER, .ptr = *ptr};
+    else if (auto* local = std::get_if<parsing::shared::node::LoadLocal>(&node))
+      return Operand{.kind = Operand::STACK, .index = local->index};
+    else return {};
+  }
+
+  /// @brief returns the SSE2 instruction of an arithmetic binary operator node
+  inline std::optional<uint8_t> arithmetic_opcode(const parsing::shared::Node<parsing::Type::RPN>& node)
+  {
+    return std::visit(
+      utils::overloaded{
+        [](parsing::shared::node::Add) -> std::optional<uint8_t> { return Emitter::ADDSD; },
+        [](parsing::shared::node::Subtract) -> std::optional<uint8_t> { return Emitter::SUBSD; },
+        [](parsing::shared::node::Multiply) -> std::optional<uint8_t> { return Emitter::MULSD; },
+        [](parsing::shared::node::Divide) -> std::optional<uint8_t> { return Emitter::DIVSD; },
+        [](const auto&) -> std::optional<uint8_t> { return {}; },
+      },
+      node);
+  }
+
+  /// @brief returns the function called by a node that takes two arguments (the power operator included)
+  inline const void* binary_function(const parsing::shared::Node<parsing::Type::RPN>& node)
+  {
+    if (std::holds_alternative<parsing::shared::node::Power>(node))
+      return reinterpret_cast<const void*>(&power);
+    else if (auto* f = std::get_if<CppFunction<2>>(&node))
+      return reinterpret_cast<const void*>(f->f_ptr);
+    else return nullptr;
+  }
+
+  /// @brief writes the code of 'rpn' in 'emitter'
+  /// @returns false if 'rpn' contains a node that cannot be compiled
+  inline bool emit(Emitter& emitter, const parsing::RPN& rpn, Code& code)
+  {
+    using namespace parsing::shared;
+
+    // number of entries in the RPN stack, the top one living in xmm0
+    size_t depth = 0;
+
+    auto top = [&](size_t offset) { return Operand{.kind = Operand::STACK, .index = depth - 1 - offset}; };
+
+    auto spill_top = [&]
+    {
+      if (depth != 0)
+        emitter.sse(Emitter::MOVSD_STORE, 0, top(0));
+    };
+
+    for (size_t i = 0; i < rpn.size(); i++)
+    {
+      const Node<parsing::Type::RPN>& node = rpn[i];
+
+      if (auto operand = pushed_operand(emitter, node))
+      {
+        // the local value may be the top of the stack, that only lives in xmm0
+        if (std::holds_alternative<node::LoadLocal>(node))
+          spill_top();
+
+        // a pushed value directly consumed by a binary operator is used in place
+        const bool fusable = depth != 0 and i + 1 < rpn.size();
+        if (auto opcode = fusable ? arithmetic_opcode(rpn[i + 1]) : std::nullopt)
+        {
+          emitter.sse(*opcode, 0, *operand);
+          i++;
+        }
+        else if (const void* f = fusable ? binary_function(rpn[i + 1]) : nullptr)
+        {
+          emitter.sse(Emitter::MOVSD_LOAD, 1, *operand);
+          emitter.call(f);
+          i++;
+        }
+        else
+        {
+          spill_top();
+          emitter.sse(Emitter::MOVSD_LOAD, 0, *operand);
+          depth++;
+        }
+      }
+      else if (auto opcode = arithmetic_opcode(node))
+      {
+        assert(depth >= 2);
+        if (*opcode == Emitter::ADDSD or *opcode == Emitter::MULSD)
+          emitter.sse(*opcode, 0, top(1));
+        else
+        {
+          emitter.sse(Emitter::MOVAPD, 1, 0, 0x66);
+          emitter.sse(Emitter::MOVSD_LOAD, 0, top(1));
+          emitter.sse(*opcode, 0, 1);
+        }
+        depth--;
+      }
+      else if (const void* f = binary_function(node))
+      {
+        assert(depth >= 2);
+        emitter.sse(Emitter::MOVAPD, 1, 0, 0x66);
+        emitter.sse(Emitter::MOVSD_LOAD, 0, top(1));
+        emitter.call(f);
+        depth--;
+      }
+      else if (auto* add = std::get_if<node::AddNumber>(&node))
+        emitter.sse(Emitter::ADDSD, 0, emitter.constant(add->value));
+      else if (auto* mul = std::get_if<node::MultiplyNumber>(&node))
+        emitter.sse(Emitter::MULSD, 0, emitter.constant(mul->value));
+      else if (auto* add = std::get_if<node::AddGlobalConstant>(&node))
+        emitter.sse(Emitter::ADDSD, 0, Operand{.kind = Operand::POINTER, .ptr = add->constant});
+      else if (auto* mul = std::get_if<node::MultiplyGlobalConstant>(&node))
+        emitter.sse(Emitter::MULSD, 0, Operand{.kind = Operand::POINTER, .ptr = mul->constant});
+      else if (auto* scaled = std::get_if<node::ScaledInput>(&node))
+      {
+        spill_top();
+        emitter.sse(Emitter::MOVSD_LOAD, 0, Operand{.kind = Operand::INPUT, .index = scaled->index});
+        emitter.sse(Emitter::MULSD, 0, emitter.constant(scaled->factor));
+        depth++;
+      }
+      else if (std::holds_alternative<node::MultiplyAdd>(node))
+      {
+        assert(depth >= 3);
+        emitter.sse(Emitter::MOVAPD, 1, 0, 0x66);
+        emitter.sse(Emitter::MOVSD_LOAD, 0, top(1));
+        emitter.sse(Emitter::MOVSD_LOAD, 2, top(2));
+        emitter.call(reinterpret_cast<const void*>(&multiply_add));
+        depth -= 2;
+      }
+      else if (std::holds_alternative<node::UnaryMinus>(node))
+        emitter.negate();
+      else if (auto* f = std::get_if<CppFunction<1>>(&node))
+        emitter.call(reinterpret_cast<const void*>(f->f_ptr));
+      else if (auto* f = std::get_if<const parsing::LinkedFunc<parsing::Type::RPN>*>(&node))
+      {
+        const Function& callee = (*f)->jit;
+        if (not callee)
+          return false;
+
+        const size_t args_num = (*f)->args_num;
+        assert(depth >= args_num);
+
+        // arguments are contiguous on the RPN stack, in order
+        spill_top();
+        emitter.bytes({0x48, 0x8D, 0xBC, 0x24}); // lea rdi, [rsp + imm32]
+        emitter.immediate(int32_t(8 * (depth - args_num)));
+        emitter.call(reinterpret_cast<const void*>(callee.entry));
+
+        code.callees.push_back(callee.code);
+        code.call_depth = std::max(code.call_depth, callee.call_depth() + 1);
+        depth = depth - args_num + 1;
+      }
+      else return false;
+    }
+
+    // the values of common subexpressions may remain below the result
+    assert(depth >= 1);
+    return true;
+  }
+
+} // namespace internal
+
+inline Function compile([[maybe_unused]] const parsing::RPN& rpn, [[maybe_unused]] size_t stack_depth)
+{
+#ifdef ZC_JIT
+  if (not enabled or rpn.empty())
+    return Function();
+
+  auto code = std::make_shared<Code>();
+
+  // keeps rsp 16 bytes aligned at call sites: the return address and rbx take 16 bytes
+  const size_t frame_size = (8 * stack_depth + 15) / 16 * 16;
+
+  internal::Emitter emitter;
+  emitter.prologue(frame_size);
+  if (not internal::emit(emitter, rpn, *code))
+    return Function();
+  emitter.epilogue(frame_size);
+
+  const std::vector<uint8_t> machine_code = emitter.finalize();
+
+  void* memory = mmap(nullptr, machine_code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return Function();
+
+  code->memory = memory;
+  code->size = machine_code.size();
+
+  std::memcpy(memory, machine_code.data(), machine_code.size());
+  if (mprotect(memory, machine_code.size(), PROT_READ | PROT_EXEC) != 0)
+    return Function();
+
+  return Function{.entry = reinterpret_cast<Function::Entry>(memory), .code = std::move(code)};
+#else
+  return Function();
+#endif
+}
+
+} // namespace jit
+} // namespace eval
+} // namespace zc
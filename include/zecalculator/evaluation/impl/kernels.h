@@ -0,0 +1,161 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include <zecalculator/evaluation/decl/kernels.h>
+#include <zecalculator/math_objects/approx.h>
+#include <zecalculator/math_objects/builtin.h>
+#include <zecalculator/utils/simd.h>
+
+namespace zc {
+namespace eval {
+namespace kernels {
+
+inline void add(double* a, const double* b, size_t n)
+{
+  simd::apply(a, b, n, simd::add, [](double x, double y) { return x + y; });
+}
+
+inline void subtract(double* a, const double* b, size_t n)
+{
+  simd::apply(a, b, n, simd::sub, [](double x, double y) { return x - y; });
+}
+
+inline void multiply(double* a, const double* b, size_t n)
+{
+  simd::apply(a, b, n, simd::mul, [](double x, double y) { return x * y; });
+}
+
+inline void divide(double* a, const double* b, size_t n)
+{
+  simd::apply(a, b, n, simd::div, [](double x, double y) { return x / y; });
+}
+
+inline void power(double* a, const double* b, size_t n)
+{
+  // no vector instruction for pow: a tight loop still beats per-node dispatch
+  for (size_t i = 0; i < n; i++)
+    a[i] = std::pow(a[i], b[i]);
+}
+
+inline void negate(double* a, size_t n)
+{
+  simd::apply(a, n, simd::neg, [](double x) { return -x; });
+}
+
+// 'std::max(x, y)' returns 'x' unless 'x < y', and the max/min instructions
+// return their second operand when the comparison fails: swap the operands
+// so NaNs and signed zeros are handled exactly as in the scalar path
+
+inline void max(double* a, const double* b, size_t n)
+{
+  simd::apply(
+    a, b, n,
+    [](simd::Vec x, simd::Vec y) { return simd::max(y, x); },
+    [](double x, double y) { return zc::max(x, y); });
+}
+
+inline void min(double* a, const double* b, size_t n)
+{
+  simd::apply(
+    a, b, n,
+    [](simd::Vec x, simd::Vec y) { return simd::min(y, x); },
+    [](double x, double y) { return zc::min(x, y); });
+}
+
+inline void sqrt(double* a, size_t n)
+{
+  simd::apply(a, n, simd::sqrt, [](double x) { return std::sqrt(x); });
+}
+
+inline void abs(double* a, size_t n)
+{
+  simd::apply(a, n, simd::abs, [](double x) { return std::abs(x); });
+}
+
+inline void floor(double* a, size_t n)
+{
+  simd::apply(a, n, simd::floor, [](double x) { return std::floor(x); });
+}
+
+inline void ceil(double* a, size_t n)
+{
+  simd::apply(a, n, simd::ceil, [](double x) { return std::ceil(x); });
+}
+
+inline void cos(double* a, size_t n)
+{
+  simd::apply(a, n, [](simd::Vec x) { return simd::cos(x); }, approx::cos);
+}
+
+inline void sin(double* a, size_t n)
+{
+  simd::apply(a, n, [](simd::Vec x) { return simd::sin(x); }, approx::sin);
+}
+
+inline void exp(double* a, size_t n)
+{
+  simd::apply(a, n, simd::exp, approx::exp);
+}
+
+inline void log(double* a, size_t n)
+{
+  simd::apply(a, n, simd::log, approx::log);
+}
+
+inline UnaryKernel find(CppFunction<1> f)
+{
+  // libm's transcendental functions have no exact vector counterpart: only their
+  // approximations do, which replace them when enabled, see parsing::use_vector_math()
+  static const std::array unary_kernels = std::to_array<std::pair<CppFunction<1>, UnaryKernel>>({
+    {{std::sqrt}, kernels::sqrt},
+    {{std::abs}, kernels::abs},
+    {{std::floor}, kernels::floor},
+    {{std::ceil}, kernels::ceil},
+    {{approx::cos}, kernels::cos},
+    {{approx::sin}, kernels::sin},
+    {{approx::exp}, kernels::exp},
+    {{approx::log}, kernels::log},
+  });
+
+  auto it = std::ranges::find(unary_kernels, f, &std::pair<CppFunction<1>, UnaryKernel>::first);
+  return it != unary_kernels.end() ? it->second : nullptr;
+}
+
+inline BinaryKernel find(CppFunction<2> f)
+{
+  static const std::array binary_kernels = std::to_array<std::pair<CppFunction<2>, BinaryKernel>>({
+    {{zc::max}, kernels::max},
+    {{zc::min}, kernels::min},
+  });
+
+  auto it = std::ranges::find(binary_kernels, f, &std::pair<CppFunction<2>, BinaryKernel>::first);
+  return it != binary_kernels.end() ? it->second : nullptr;
+}
+
+} // namespace kernels
+} // namespace eval
+} // namespace zc
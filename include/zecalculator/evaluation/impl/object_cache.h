@@ -20,12 +20,8 @@
 **
 ****************************************************************************/
 
-#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <iterator>
-#include <limits>
-#include <utility>
 #include <zecalculator/evaluation/decl/object_cache.h>
 
 namespace zc {
@@ -37,32 +33,19 @@ inline ObjectCache::ObjectCache(size_t new_buffer_size)
 }
 
 /// @brief update the max buffer size to this size
-/// @note if it's smaller than the previously set one, oldest values are popped out of the cache
+/// @note if it's smaller than the previously set one, least recently used values are popped out of the cache
 inline void ObjectCache::set_buffer_size(size_t new_buffer_size)
 {
   if (new_buffer_size == buffer_size) [[unlikely]]
     return;
 
-  assert(age_sorted_indices.size() == cache.size());
-  assert(cache.size() <= buffer_size);
+  assert(positions.size() <= buffer_size);
 
-  if (new_buffer_size > cache.size())
-  {
-    auto [keys, values] = std::move(cache).extract();
-    // we allow ourselves to go +1 above buffer size in inserts, for a tad leaner code there
-    keys.reserve(new_buffer_size + 1);
-    values.reserve(new_buffer_size + 1);
-    cache.replace(std::move(keys), std::move(values));
-  }
-  else if (new_buffer_size < cache.size())
-  {
-    size_t elements_to_pop = age_sorted_indices.size() - new_buffer_size;
-
-    for (size_t i = 0 ; i != elements_to_pop; i++)
-      pop_oldest();
-  }
+  while (positions.size() > new_buffer_size)
+    pop_oldest();
 
   buffer_size = new_buffer_size;
+  positions.reserve(buffer_size);
 }
 
 inline ObjectCache::ObjectCache(std::initializer_list<double> keys,
@@ -106,15 +89,32 @@ inline std::optional<double> ObjectCache::get_value(size_t object_revision, doub
   if (cached_object_revision != object_revision)
     return {};
 
-  if (auto value_it = cache.find(key); value_it != cache.end())
-    return value_it->second;
+  if (auto it = positions.find(key); it != positions.end())
+  {
+    if (it->second != newest)
+    {
+      unlink(it->second);
+      link_newest(it->second);
+    }
+    return nodes[it->second].value;
+  }
   else return {};
 }
 
+inline std::flat_map<double, double> ObjectCache::get_cache() const
+{
+  std::flat_map<double, double> cache;
+  for (const auto& [key, index]: positions)
+    cache.insert_or_assign(key, nodes[index].value);
+  return cache;
+}
+
 inline void ObjectCache::clear()
 {
-  cache.clear();
-  age_sorted_indices.clear();
+  positions.clear();
+  nodes.clear();
+  free_nodes.clear();
+  oldest = newest = npos;
 }
 
 inline void ObjectCache::insert(size_t object_revision, double key, double value)
@@ -128,45 +128,80 @@ inline void ObjectCache::insert(size_t object_revision, double key, double value
     cached_object_revision = object_revision;
   }
 
-  auto [it, is_inserted] = cache.insert_or_assign(key, value);
-
-  int distance = std::distance(cache.begin(), it);
-  assert(distance >= 0);
-  size_t insertion_index = distance;
+  if (buffer_size == 0) [[unlikely]]
+    return;
 
-  if (is_inserted)
+  if (auto it = positions.find(key); it != positions.end())
   {
-    // All indices that comes after the insertion index need to be incremented
-    std::ranges::for_each(age_sorted_indices, [&](size_t& i){ if (i >= insertion_index) i++; });
+    // the key got a new value, it becomes the most recently used one
+    nodes[it->second].value = value;
+    if (it->second != newest)
+    {
+      unlink(it->second);
+      link_newest(it->second);
+    }
+    return;
+  }
 
-    age_sorted_indices.push_back(insertion_index);
+  if (positions.size() == buffer_size)
+    pop_oldest();
 
-    if (cache.size() > buffer_size)
-      pop_oldest();
+  size_t index;
+  if (free_nodes.empty())
+  {
+    index = nodes.size();
+    nodes.emplace_back();
   }
   else
   {
-    // the index got replaced with a new value
-    assert(std::ranges::count(age_sorted_indices, insertion_index) == 1);
-    std::erase(age_sorted_indices, insertion_index);
-    age_sorted_indices.push_back(insertion_index);
+    index = free_nodes.back();
+    free_nodes.pop_back();
   }
+
+  nodes[index].key = key;
+  nodes[index].value = value;
+  link_newest(index);
+  positions.emplace(key, index);
 }
 
-inline void ObjectCache::pop_oldest()
+inline void ObjectCache::unlink(size_t index)
 {
-  if (cache.size() == 0)
-    return;
+  Node& node = nodes[index];
+
+  if (node.older != npos)
+    nodes[node.older].newer = node.newer;
+  else oldest = node.newer;
 
-  size_t pop_index = age_sorted_indices.front();
-  age_sorted_indices.pop_front();
-  std::ranges::for_each(age_sorted_indices, [&](size_t& i){ if (i >= pop_index) i--; });
+  if (node.newer != npos)
+    nodes[node.newer].older = node.older;
+  else newest = node.older;
+
+  node.older = node.newer = npos;
+}
+
+inline void ObjectCache::link_newest(size_t index)
+{
+  Node& node = nodes[index];
 
-  auto&& [keys, values] = std::move(cache).extract();
-  keys.erase(keys.begin() + pop_index);
-  values.erase(values.begin() + pop_index);
+  node.older = newest;
+  node.newer = npos;
+
+  if (newest != npos)
+    nodes[newest].newer = index;
+  else oldest = index;
+
+  newest = index;
+}
+
+inline void ObjectCache::pop_oldest()
+{
+  if (oldest == npos)
+    return;
 
-  cache.replace(std::move(keys), std::move(values));
+  size_t index = oldest;
+  positions.erase(nodes[index].key);
+  unlink(index);
+  free_nodes.push_back(index);
 }
 
 }
@@ -0,0 +1,212 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <zecalculator/evaluation/decl/parallel.h>
+#include <zecalculator/evaluation/impl/evaluation.h>
+
+#include <atomic>
+
+namespace zc {
+namespace eval {
+
+inline ThreadPool::ThreadPool(size_t threads_num)
+  : workers(std::make_unique<Worker[]>(std::max(threads_num, size_t(1))))
+{
+  threads_num = std::max(threads_num, size_t(1));
+  threads.reserve(threads_num);
+  for (size_t i = 0; i != threads_num; i++)
+    threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+inline ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  job_started.notify_all();
+
+  for (std::thread& thread: threads)
+    thread.join();
+}
+
+inline void ThreadPool::run(size_t tasks_num, const std::function<void(size_t, size_t)>& task)
+{
+  if (tasks_num == 0)
+    return;
+
+  std::unique_lock lock(mutex);
+
+  // contiguous tasks go to the same worker, for locality
+  for (size_t i = 0; i != size(); i++)
+  {
+    std::lock_guard worker_lock(workers[i].mutex);
+    workers[i].generation = generation + 1;
+    for (size_t t = i * tasks_num / size(); t != (i + 1) * tasks_num / size(); t++)
+      workers[i].tasks.push_back(t);
+  }
+
+  job = &task;
+  remaining_tasks = tasks_num;
+  generation++;
+  job_started.notify_all();
+
+  job_done.wait(lock, [&]{ return remaining_tasks == 0; });
+  job = nullptr;
+}
+
+inline std::optional<size_t> ThreadPool::next_task(size_t index, size_t job_generation)
+{
+  // a worker late on a job must not take the tasks of the next one
+  {
+    std::lock_guard lock(workers[index].mutex);
+    if (workers[index].generation == job_generation and not workers[index].tasks.empty())
+    {
+      size_t task = workers[index].tasks.front();
+      workers[index].tasks.pop_front();
+      return task;
+    }
+  }
+
+  for (size_t i = 1; i != size(); i++)
+  {
+    Worker& victim = workers[(index + i) % size()];
+    std::lock_guard lock(victim.mutex);
+    if (victim.generation == job_generation and not victim.tasks.empty())
+    {
+      size_t task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return task;
+    }
+  }
+
+  return {};
+}
+
+inline void ThreadPool::work(size_t index)
+{
+  size_t done_generation = 0;
+  while (true)
+  {
+    const std::function<void(size_t, size_t)>* current_job;
+    {
+      std::unique_lock lock(mutex);
+      job_started.wait(lock, [&]{ return stopping or generation != done_generation; });
+      if (stopping)
+        return;
+      done_generation = generation;
+      current_job = job;
+    }
+
+    // no task gets added during a job: once every queue is empty, this worker is done with it
+    size_t done_tasks = 0;
+    while (std::optional<size_t> task = next_task(index, done_generation))
+    {
+      (*current_job)(*task, index);
+      done_tasks++;
+    }
+
+    if (done_tasks != 0)
+    {
+      std::lock_guard lock(mutex);
+      remaining_tasks -= done_tasks;
+      if (remaining_tasks == 0)
+        job_done.notify_all();
+    }
+  }
+}
+
+} // namespace eval
+
+inline std::expected<Ok, Error> evaluate_parallel(const parsing::RPN& rpn,
+                                                  std::span<const std::span<const double>> input_vars,
+                                                  std::span<double> out,
+                                                  eval::ThreadPool& pool,
+                                                  size_t chunk_size)
+{
+  assert(chunk_size != 0);
+  assert(std::ranges::all_of(input_vars, [&](auto vals) { return vals.size() >= out.size(); }));
+
+  const size_t chunks_num = (out.size() + chunk_size - 1) / chunk_size;
+
+  std::vector<eval::Cache> caches(pool.size());
+  std::vector<eval::BatchWorkspace> workspaces(pool.size());
+
+  const size_t stack_depth = parsing::max_stack_depth(rpn);
+
+  // first error met by each worker, along with the index of its chunk
+  std::vector<std::optional<std::pair<size_t, Error>>> errors(pool.size());
+
+  // chunks after an erroneous one are not evaluated
+  std::atomic<size_t> first_error_chunk = chunks_num;
+
+  pool.run(chunks_num, [&](size_t chunk, size_t worker)
+  {
+    if (first_error_chunk.load(std::memory_order_relaxed) < chunk)
+      return;
+
+    const size_t offset = chunk * chunk_size;
+    const size_t size = std::min(chunk_size, out.size() - offset);
+
+    std::vector<std::span<const double>> chunk_input_vars;
+    chunk_input_vars.reserve(input_vars.size());
+    for (std::span<const double> vals: input_vars)
+      chunk_input_vars.push_back(vals.subspan(offset, size));
+
+    auto res = evaluate_batch(rpn,
+                              stack_depth,
+                              chunk_input_vars,
+                              out.subspan(offset, size),
+                              0,
+                              &caches[worker],
+                              &workspaces[worker]);
+    if (not res and (not errors[worker] or chunk < errors[worker]->first))
+    {
+      errors[worker].emplace(chunk, std::move(res.error()));
+
+      size_t current = first_error_chunk.load(std::memory_order_relaxed);
+      while (chunk < current and not first_error_chunk.compare_exchange_weak(current, chunk));
+    }
+  });
+
+  auto first_error = std::ranges::min_element(
+    errors,
+    [](const auto& a, const auto& b) { return a and (not b or a->first < b->first); });
+
+  if (first_error != errors.end() and *first_error)
+    return std::unexpected(std::move((*first_error)->second));
+
+  return Ok{};
+}
+
+inline std::expected<Ok, Error> evaluate_parallel(const parsing::RPN& rpn,
+                                                  std::span<const double> xs,
+                                                  std::span<double> out,
+                                                  eval::ThreadPool& pool,
+                                                  size_t chunk_size)
+{
+  assert(xs.size() == out.size());
+  return evaluate_parallel(rpn, std::array{xs}, out, pool, chunk_size);
+}
+
+} // namespace zc
@@ -35,4 +35,8 @@ namespace rpn {
   using DynMathObject = zc::DynMathObject<parsing::Type::RPN>;
 } // namespace rpn
 
+namespace bytecode {
+  using DynMathObject = zc::DynMathObject<parsing::Type::BYTECODE>;
+} // namespace bytecode
+
 }
@@ -0,0 +1,87 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+#include <zecalculator/math_objects/cpp_function.h>
+#include <zecalculator/utils/simd.h>
+
+namespace zc {
+
+/// @brief approximations of libm's transcendental functions, that have vectorized kernels
+/// @note  they run the same code as their kernels, and are within a few ulps of libm's results,
+///        see eval::kernels
+namespace approx {
+
+// the vector code runs on a single value: results match the kernels' exactly
+
+inline double cos(double x)
+{
+  return simd::first(simd::cos(simd::set1(x)));
+}
+
+inline double sin(double x)
+{
+  return simd::first(simd::sin(simd::set1(x)));
+}
+
+inline double exp(double x)
+{
+  return simd::first(simd::exp(simd::set1(x)));
+}
+
+inline double log(double x)
+{
+  return simd::first(simd::log(simd::set1(x)));
+}
+
+/// @brief returns the approximation of 'f'
+/// @returns std::nullopt if 'f' has no approximation
+inline std::optional<CppFunction<1>> counterpart(CppFunction<1> f)
+{
+  static const std::array counterparts = std::to_array<std::pair<CppFunction<1>, CppFunction<1>>>({
+    {{std::cos}, {approx::cos}},
+    {{std::sin}, {approx::sin}},
+    {{std::exp}, {approx::exp}},
+    {{std::log}, {approx::log}},
+  });
+
+  auto it = std::ranges::find(counterparts, f, &std::pair<CppFunction<1>, CppFunction<1>>::first);
+  if (it != counterparts.end())
+    return it->second;
+  else return std::nullopt;
+}
+
+/// @brief says if 'f' is one of the approximations above
+inline bool is_approximation(CppFunction<1> f)
+{
+  return f == CppFunction<1>{approx::cos} or f == CppFunction<1>{approx::sin}
+         or f == CppFunction<1>{approx::exp} or f == CppFunction<1>{approx::log};
+}
+
+} // namespace approx
+
+} // namespace zc
@@ -21,7 +21,13 @@
 ****************************************************************************/
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <string_view>
 
+#include <zecalculator/math_objects/approx.h>
 #include <zecalculator/math_objects/cpp_function.h>
 
 namespace zc {
@@ -35,6 +41,16 @@ inline const std::array builtin_global_constants = std::to_array<std::pair<std::
   {"physics::c",  299792458},      // Speed of light in vacuum, SI units
 });
 
+/// @brief sign function: 1 for positive numbers, -1 for negative ones, 0 for zero, NaN for NaN
+/// @note  builtin function named "sign", added alongside the derivative of "abs": like any builtin,
+///        the name can no longer be used by the objects of a MathWorld
+inline double sign(double x)
+{
+  if (std::isnan(x))
+    return x;
+  return x > 0 ? 1. : (x < 0 ? -1. : 0.);
+}
+
 // we save the names along with the function pointers for convenience
 // we could save only the function pointers, and the names only in the inventory
 inline const std::array builtin_unary_functions = std::to_array<std::pair<std::string, CppFunction<1>>>({
@@ -48,6 +64,7 @@ inline const std::array builtin_unary_functions = std::to_array<std::pair<std::s
   {"ln", {std::log}},      {"abs", {std::abs}},      {"exp", {std::exp}},
   {"floor", {std::floor}}, {"ceil", {std::ceil}},    {"erf", {std::erf}},
   {"erfc", {std::erfc}},   {"gamma", {std::tgamma}}, {"Γ", {std::tgamma}},
+  {"sign", {sign}},
 });
 
 inline double max(double a, double b)
@@ -64,4 +81,160 @@ inline const std::array builtin_binary_functions = std::to_array<std::pair<std::
   {"max", {max}},     {"min", {min}}
 });
 
+/// @brief digamma function: derivative of ln(Γ(x))
+inline double digamma(double x)
+{
+  if (x <= 0 and x == std::floor(x))
+    return std::numeric_limits<double>::quiet_NaN();
+
+  // reflection formula
+  if (x < 0)
+    return digamma(1 - x) - std::numbers::pi / std::tan(std::numbers::pi * x);
+
+  // recurrence formula, to reach the values where the asymptotic expansion is accurate
+  double res = 0;
+  for (; x < 10; x += 1)
+    res -= 1 / x;
+
+  const double inv_x2 = 1 / (x * x);
+  return res + std::log(x) - 0.5 / x
+         - inv_x2 * (1. / 12 - inv_x2 * (1. / 120 - inv_x2 * (1. / 252 - inv_x2 * (1. / 240 - inv_x2 / 132))));
+}
+
+/// @brief returns the derivative of 'f'
+/// @returns std::nullopt if 'f' is not a builtin function
+inline std::optional<CppFunction<1>> builtin_derivative(CppFunction<1> f)
+{
+  // aliases (e.g. "ch" and "cosh") share the same function pointer
+  static const std::array derivatives = std::to_array<std::pair<CppFunction<1>, CppFunction<1>>>({
+    {{std::cos}, {[](double x) { return -std::sin(x); }}},
+    {{std::sin}, {[](double x) { return std::cos(x); }}},
+    {{std::tan}, {[](double x) { return 1 + std::tan(x) * std::tan(x); }}},
+    {{std::acos}, {[](double x) { return -1 / std::sqrt(1 - x * x); }}},
+    {{std::asin}, {[](double x) { return 1 / std::sqrt(1 - x * x); }}},
+    {{std::atan}, {[](double x) { return 1 / (1 + x * x); }}},
+    {{std::cosh}, {[](double x) { return std::sinh(x); }}},
+    {{std::sinh}, {[](double x) { return std::cosh(x); }}},
+    {{std::tanh}, {[](double x) { return 1 - std::tanh(x) * std::tanh(x); }}},
+    {{std::acosh}, {[](double x) { return 1 / std::sqrt(x * x - 1); }}},
+    {{std::asinh}, {[](double x) { return 1 / std::sqrt(x * x + 1); }}},
+    {{std::atanh}, {[](double x) { return 1 / (1 - x * x); }}},
+    {{std::sqrt}, {[](double x) { return 0.5 / std::sqrt(x); }}},
+    {{std::log10}, {[](double x) { return 1 / (x * std::numbers::ln10); }}},
+    {{std::log2}, {[](double x) { return 1 / (x * std::numbers::ln2); }}},
+    {{std::log}, {[](double x) { return 1 / x; }}},
+    {{std::abs}, {sign}},
+    {{std::exp}, {[](double x) { return std::exp(x); }}},
+    {{std::floor}, {[](double) { return 0.; }}},
+    {{std::ceil}, {[](double) { return 0.; }}},
+    {{sign}, {[](double) { return 0.; }}},
+    {{std::erf}, {[](double x) { return 2 * std::numbers::inv_sqrtpi * std::exp(-x * x); }}},
+    {{std::erfc}, {[](double x) { return -2 * std::numbers::inv_sqrtpi * std::exp(-x * x); }}},
+    {{std::tgamma}, {[](double x) { return std::tgamma(x) * digamma(x); }}},
+    {{approx::cos}, {[](double x) { return -approx::sin(x); }}},
+    {{approx::sin}, {approx::cos}},
+    {{approx::exp}, {approx::exp}},
+    {{approx::log}, {[](double x) { return 1 / x; }}},
+  });
+
+  auto it = std::ranges::find(derivatives, f, &std::pair<CppFunction<1>, CppFunction<1>>::first);
+  if (it != derivatives.end())
+    return it->second;
+  else return std::nullopt;
+}
+
+/// @brief returns the expression of the derivative of 'f', written with the builtin functions
+///        in terms of the argument 'x' of 'f'
+/// @returns std::nullopt if 'f' is not a builtin function, or if its derivative
+///          cannot be written with the builtin functions, e.g. the gamma function
+inline std::optional<std::string_view> builtin_derivative_expression(CppFunction<1> f)
+{
+  static const std::array derivatives = std::to_array<std::pair<CppFunction<1>, std::string_view>>({
+    {{std::cos}, "-sin(x)"},
+    {{std::sin}, "cos(x)"},
+    {{std::tan}, "1+tan(x)^2"},
+    {{std::acos}, "-1/sqrt(1-x^2)"},
+    {{std::asin}, "1/sqrt(1-x^2)"},
+    {{std::atan}, "1/(1+x^2)"},
+    {{std::cosh}, "sinh(x)"},
+    {{std::sinh}, "cosh(x)"},
+    {{std::tanh}, "1-tanh(x)^2"},
+    {{std::acosh}, "1/sqrt(x^2-1)"},
+    {{std::asinh}, "1/sqrt(x^2+1)"},
+    {{std::atanh}, "1/(1-x^2)"},
+    {{std::sqrt}, "0.5/sqrt(x)"},
+    {{std::log10}, "1/(x*2.302585092994046)"},
+    {{std::log2}, "1/(x*0.6931471805599453)"},
+    {{std::log}, "1/x"},
+    {{std::abs}, "sign(x)"},
+    {{std::exp}, "exp(x)"},
+    {{std::floor}, "0"},
+    {{std::ceil}, "0"},
+    {{sign}, "0"},
+    {{std::erf}, "1.1283791670955126*exp(-x^2)"},
+    {{std::erfc}, "-1.1283791670955126*exp(-x^2)"},
+  });
+
+  auto it = std::ranges::find(derivatives, f, &std::pair<CppFunction<1>, std::string_view>::first);
+  if (it != derivatives.end())
+    return it->second;
+  else return std::nullopt;
+}
+
+/// @brief returns the partial derivatives of 'f' with respect to its first and second argument
+/// @returns std::nullopt if 'f' is not a builtin function
+inline std::optional<std::array<CppFunction<2>, 2>> builtin_partial_derivatives(CppFunction<2> f)
+{
+  using Partials = std::array<CppFunction<2>, 2>;
+
+  // follow which argument 'std::max' and 'std::min' actually return
+  static const std::array partial_derivatives = std::to_array<std::pair<CppFunction<2>, Partials>>({
+    {{zc::max},
+     {{{[](double a, double b) { return a < b ? 0. : 1.; }},
+       {[](double a, double b) { return a < b ? 1. : 0.; }}}}},
+    {{zc::min},
+     {{{[](double a, double b) { return b < a ? 0. : 1.; }},
+       {[](double a, double b) { return b < a ? 1. : 0.; }}}}},
+  });
+
+  auto it = std::ranges::find(partial_derivatives, f, &std::pair<CppFunction<2>, Partials>::first);
+  if (it != partial_derivatives.end())
+    return it->second;
+  else return std::nullopt;
+}
+
+/// @brief returns the partial derivatives of 'f' with respect to each of its arguments
+/// @returns std::nullopt if 'f' is not a builtin function
+template <size_t args_num>
+std::optional<std::array<CppFunction<args_num>, args_num>> builtin_gradient(CppFunction<args_num> f)
+{
+  if constexpr (args_num == 1)
+  {
+    if (auto derivative = builtin_derivative(f))
+      return std::array{*derivative};
+    else return std::nullopt;
+  }
+  else if constexpr (args_num == 2)
+    return builtin_partial_derivatives(f);
+  else return std::nullopt;
+}
+
+/// @brief returns true if 'f' is one of the builtin functions above, or one of their approximations
+/// @note  builtin functions are pure: they always give the same output for the same inputs
+template <size_t args_num>
+bool is_builtin(CppFunction<args_num> f)
+{
+  const auto& builtins = [&]() -> const auto& {
+    if constexpr (args_num == 1)
+      return builtin_unary_functions;
+    else return builtin_binary_functions;
+  }();
+
+  if constexpr (args_num == 1)
+    if (approx::is_approximation(f))
+      return true;
+
+  return std::ranges::any_of(builtins, [&](const auto& name_f) { return name_f.second == f; });
+}
+
 }
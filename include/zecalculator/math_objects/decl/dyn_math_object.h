@@ -34,15 +34,28 @@ namespace zc {
 template <parsing::Type type>
 class MathWorld;
 
+struct Dual;
+
+namespace eval {
+  class ThreadPool;
+  struct BatchWorkspace;
+  struct GradientWorkspace;
+}
+
 namespace parsing {
   template <Type>
   struct make_fast;
 
+  template <Type>
+  struct differentiate;
+
   template <parsing::Type>
   struct FunctionVisiter;
 
   template <parsing::Type>
   struct VariableVisiter;
+
+  struct compile_rpn;
 }
 
 enum ObjectType {BAD_EQUATION, CONSTANT, CPP_FUNCTION, FUNCTION, SEQUENCE, DATA};
@@ -130,6 +143,61 @@ public:
   std::expected<double, Error> operator () (std::initializer_list<double> vals = {}, eval::Cache* cache = nullptr) const;
   std::expected<double, Error> evaluate(std::initializer_list<double> vals = {}, eval::Cache* cache = nullptr) const;
 
+  /// @brief evaluates the object over many inputs at once
+  /// @param input_vars: one span per input variable of the object, each span containing one value per evaluation
+  /// @param out: where to write the results, its size gives the number of evaluations
+  /// @param workspace: storage reused across evaluations, passing one avoids allocating each time
+  /// @note every span in 'input_vars' must have the same size as 'out'
+  /// @note evaluation stops at the first error, in which case 'out' is only partially written
+  /// @note only functions with the RPN representation use 'workspace'
+  std::expected<Ok, Error> evaluate_batch(std::span<const std::span<const double>> input_vars,
+                                          std::span<double> out,
+                                          eval::Cache* cache = nullptr,
+                                          eval::BatchWorkspace* workspace = nullptr) const;
+
+  /// @brief evaluates a single input variable object over many inputs at once
+  /// @param xs: values of the input variable, one per evaluation
+  /// @param out: where to write the results, must have the same size as 'xs'
+  std::expected<Ok, Error> evaluate_batch(std::span<const double> xs,
+                                          std::span<double> out,
+                                          eval::Cache* cache = nullptr,
+                                          eval::BatchWorkspace* workspace = nullptr) const;
+
+  /// @brief evaluates the object over many inputs at once, split in chunks that run on the threads of 'pool'
+  /// @param input_vars: one span per input variable of the object, each span containing one value per evaluation
+  /// @param out: where to write the results, its size gives the number of evaluations
+  /// @note  only functions with the RPN representation run in parallel, the other objects use evaluate_batch()
+  /// @note  on error, 'out' is only partially written
+  std::expected<Ok, Error> evaluate_parallel(std::span<const std::span<const double>> input_vars,
+                                             std::span<double> out,
+                                             eval::ThreadPool& pool) const;
+
+  /// @brief evaluates a single input variable object over many inputs at once, with the threads of 'pool'
+  /// @param xs: values of the input variable, one per evaluation
+  /// @param out: where to write the results, must have the same size as 'xs'
+  std::expected<Ok, Error> evaluate_parallel(std::span<const double> xs,
+                                             std::span<double> out,
+                                             eval::ThreadPool& pool) const;
+
+  /// @brief evaluates the object along with its derivative with respect to one of its input variables
+  /// @param var_index: index, within 'vals', of the variable to differentiate with respect to
+  /// @note  sequences and data are only defined over integers: their derivative is zero
+  /// @note  only FAST and RPN representations can be differentiated
+  std::expected<Dual, Error> evaluate_dual(std::initializer_list<double> vals,
+                                           size_t var_index,
+                                           eval::Cache* cache = nullptr) const;
+
+  /// @brief evaluates the object along with its derivatives with respect to all of its input variables
+  /// @param gradient: where to write the derivatives, must have the same size as 'vals'
+  /// @param workspace: storage reused across evaluations, passing one avoids allocating each time
+  /// @returns the value of the object
+  /// @note  functions are differentiated in a single backward sweep, whatever their number of inputs
+  /// @note  only the RPN representation can be differentiated
+  std::expected<double, Error> evaluate_gradient(std::initializer_list<double> vals,
+                                                 std::span<double> gradient,
+                                                 eval::Cache* cache = nullptr,
+                                                 eval::GradientWorkspace* workspace = nullptr) const;
+
   /// @brief returns the currently set name, regardless of the validity of the object
   /// @note returns non-empty string only if the object has been assigned a valid unique name
   std::string_view get_name() const;
@@ -204,12 +272,21 @@ protected:
     std::optional<std::string> rhs_str = {};
   };
 
+  /// @brief function and input variable a function is the derivative of, see MathWorld::derivative()
+  struct DerivativeOf {
+    std::string function;
+    std::string variable;
+  };
+
   struct FuncObj {
     /// @brief the string also contains the equal sign that acts as a separator
     std::string rhs_str;
     parsing::AST rhs;
     std::expected<parsing::LinkedFunc<type>, zc::Error> linked_rhs = std::unexpected(
       zc::Error::empty_expression());
+
+    /// @brief set when the equation is derived from another function, and follows its changes
+    std::optional<DerivativeOf> derivative_of = {};
   };
 
   struct SeqObj {
@@ -235,17 +312,32 @@ protected:
 
   /// @brief updates the name of the object without notifying the MathWorld instance about it
   template <class T>
-    requires (std::is_same_v<T, parsing::AST> or std::is_convertible_v<T, std::string_view>)
+    requires (std::is_same_v<T, parsing::AST::Ref> or std::is_convertible_v<T, std::string_view>)
   void set_name_internal(const T& name, std::string_view full_expr);
 
+  /// @brief defines the object as the derivative of 'function' with respect to its input variable 'variable'
+  /// @note  the equation gets derived again each time 'function' or one of its dependencies changes
+  DynMathObject& set_derivative(std::string_view name, std::string_view function, std::string_view variable);
+
+  /// @brief derives again the equation of 'f_obj' from the function it is the derivative of
+  /// @returns the error that prevents writing the derivative, if any
+  std::optional<zc::Error> update_derivative(FuncObj& f_obj);
+
   /// @brief sets the data strings without notifying the MathWorld instance about it
   DynMathObject& set_data_internal(std::vector<std::string> data);
 
   template <bool insert>
   DynMathObject& bulk_data_input(size_t index, std::vector<std::string> data);
 
+  /// @param ast: tree whose texts are positions in 'rhs'
+  /// @param lhs: text that precedes 'rhs' in the equation, errors being reported against 'lhs' + 'rhs'
   std::expected<zc::parsing::Parsing<type>, zc::Error> get_final_repr(const parsing::AST& ast,
-                                                                     std::string_view equation);
+                                                                     std::string_view lhs,
+                                                                     std::string_view rhs);
+
+  /// @brief makes the max stack depth of 'data' cover 'repr' too, only used by the RPN representation
+  static void update_stack_depth(parsing::LinkedData<type>& data,
+                                 const std::expected<parsing::Parsing<type>, zc::Error>& repr);
 
   /// @tparam linked: link with other math objects, otherwise assigns unlinked alternative
   template <bool link = true>
@@ -253,11 +345,23 @@ protected:
 
   void increment_revision();
 
+  /// @brief updates the purity of the linked function held by this object, see parsing::LinkedFunc::pure
+  /// @note  uses the equations of the objects it calls, rather than their linked forms,
+  ///        so it is right even when they did not get relinked yet
+  void update_purity();
+
+  /// @brief compiles the linked function held by this object to native code, RPN only
+  /// @returns true if it got compiled by this call, false if it already was or cannot be
+  /// @note  a function cannot be compiled before the functions it calls are
+  bool jit_compile();
+
   friend MathWorld<type>;
 
   friend struct parsing::FunctionVisiter<type>;
   friend struct parsing::VariableVisiter<type>;
   friend struct parsing::make_fast<type>;
+  friend struct parsing::differentiate<type>;
+  friend struct parsing::compile_rpn;
 };
 
 } // namespace zc
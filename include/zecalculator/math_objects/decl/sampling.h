@@ -0,0 +1,87 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <zecalculator/error.h>
+#include <zecalculator/evaluation/decl/cache.h>
+#include <zecalculator/math_objects/decl/dyn_math_object.h>
+
+#include <cstddef>
+#include <expected>
+#include <vector>
+
+/// @brief adaptive sampling of single input variable objects, to plot them as curves
+
+namespace zc {
+
+struct SamplingOptions
+{
+  /// @brief width and height of a pixel, in the units of the input and of the output of the object
+  double pixel_width;
+  double pixel_height;
+
+  /// @brief biggest distance, in pixels, allowed between the curve and the polyline that draws it
+  double tolerance = 0.5;
+
+  /// @brief number of evenly spaced points the interval gets sampled with before any refinement
+  /// @note  details narrower than the spacing of these points may be missed
+  size_t initial_samples = 64;
+
+  /// @brief how many times the segments between the initial points can be split in two
+  size_t max_depth = 12;
+};
+
+struct SampledCurve
+{
+  struct Point
+  {
+    double x;
+    double y;
+
+    bool operator == (const Point&) const = default;
+  };
+
+  /// @brief points of the polyline, sorted by increasing x
+  /// @note  the curve is broken at points whose y is NaN or infinite
+  std::vector<Point> points;
+
+  /// @brief number of times the object got evaluated
+  size_t evaluations = 0;
+
+  /// @brief number of batches the evaluations were grouped in
+  size_t batches = 0;
+};
+
+/// @brief samples 'obj' over [x_min, x_max], more densely where the curve bends or gets undefined
+/// @note  a segment of the polyline gets split in two, with all the others of the same depth in a
+///        single batch, when its middle point is more than 'tolerance' pixels away from it, or when
+///        its ends and middle are not all finite or all not finite: discontinuities and the bounds of
+///        the domain of definition get located up to a fraction of a pixel
+/// @note  'obj' must have a single input variable, see DynMathObject::evaluate_batch()
+template <parsing::Type type>
+std::expected<SampledCurve, Error> sample_adaptive(const DynMathObject<type>& obj,
+                                                   double x_min,
+                                                   double x_max,
+                                                   const SamplingOptions& options,
+                                                   eval::Cache* cache = nullptr);
+
+} // namespace zc
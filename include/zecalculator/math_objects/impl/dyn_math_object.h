@@ -20,7 +20,10 @@
 **
 ****************************************************************************/
 
+#include <zecalculator/evaluation/impl/dual.h>
 #include <zecalculator/evaluation/impl/evaluation.h>
+#include <zecalculator/evaluation/impl/gradient.h>
+#include <zecalculator/evaluation/impl/parallel.h>
 #include <zecalculator/math_objects/decl/dyn_math_object.h>
 #include <zecalculator/math_objects/impl/cpp_function.h>
 #include <zecalculator/parsing/impl/utils.h>
@@ -51,25 +54,29 @@ DynMathObject<type>& DynMathObject<type>::set_name(std::string_view name)
 
 template <parsing::Type type>
 template <class T>
-  requires (std::is_same_v<T, parsing::AST> or std::is_convertible_v<T, std::string_view>)
+  requires (std::is_same_v<T, parsing::AST::Ref> or std::is_convertible_v<T, std::string_view>)
 void DynMathObject<type>::set_name_internal(const T& name, std::string_view full_expr)
 {
   std::string old_name(get_name());
 
   lhs_str = std::string(full_expr);
-  exp_lhs = parsing::parse_lhs(name, full_expr);
+
+  // the texts of the lhs are positions in 'lhs_str'
+  if constexpr (std::is_same_v<T, parsing::AST::Ref>)
+    exp_lhs = parsing::parse_lhs(name, lhs_str);
+  else exp_lhs = parsing::parse_lhs(lhs_str, lhs_str);
 
   if (bool(exp_lhs))
   {
-    exp_lhs->name_already_taken = (old_name != exp_lhs->name.substr
-                                and mathworld.contains(exp_lhs->name.substr));
+    const std::string_view new_name = exp_lhs->name.in(lhs_str);
+    exp_lhs->name_already_taken = (old_name != new_name and mathworld.contains(new_name));
 
     if ((holds(SEQUENCE) or holds(DATA)) and exp_lhs->input_vars.size() > 1)
       exp_lhs = std::unexpected(
-        zc::Error::unexpected(exp_lhs->input_vars[1], std::string(full_expr)));
+        zc::Error::unexpected(exp_lhs->input_vars[1], lhs_str));
     else if ((holds(CONSTANT) or holds(CPP_FUNCTION)) and not exp_lhs->input_vars.empty())
       exp_lhs = std::unexpected(
-        zc::Error::unexpected(exp_lhs->input_vars[0], std::string(full_expr)));
+        zc::Error::unexpected(exp_lhs->input_vars[0], lhs_str));
   }
 }
 
@@ -99,7 +106,14 @@ std::expected<double, Error> DynMathObject<type>::evaluate(std::initializer_list
           return std::unexpected(f_obj.linked_rhs.error());
         else if (f_obj.linked_rhs->args_num != vals.size())
           return std::unexpected(zc::Error::cpp_incorrect_argnum());
-        return zc::evaluate(f_obj.linked_rhs->repr, vals, cache);
+
+        if constexpr (type == parsing::Type::RPN)
+        {
+          if (f_obj.linked_rhs->jit and f_obj.linked_rhs->jit.fits(0))
+            return f_obj.linked_rhs->jit(vals.begin());
+          else return zc::evaluate(f_obj.linked_rhs->repr, f_obj.linked_rhs->stack_depth, vals, 0, cache);
+        }
+        else return zc::evaluate(f_obj.linked_rhs->repr, vals, cache);
       },
       [&](const ConstObj& cst) -> Ret
       {
@@ -126,6 +140,272 @@ std::expected<double, Error> DynMathObject<type>::evaluate(std::initializer_list
   );
 }
 
+template <parsing::Type type>
+std::expected<Ok, Error>
+  DynMathObject<type>::evaluate_batch(std::span<const std::span<const double>> input_vars,
+                                      std::span<double> out,
+                                      eval::Cache* cache,
+                                      eval::BatchWorkspace* workspace) const
+{
+  using Ret = std::expected<Ok, Error>;
+  if (auto err = error())
+    return std::unexpected(*err);
+
+  if (std::ranges::any_of(input_vars, [&](auto vals) { return vals.size() != out.size(); }))
+    return std::unexpected(Error::cpp_incorrect_argnum());
+
+  return std::visit(
+    utils::overloaded{
+      [&](zc::Error err) -> Ret
+      {
+        return std::unexpected(err);
+      },
+      [&]<size_t args_num>(CppFunction<args_num> cpp_f) -> Ret
+      {
+        if (input_vars.size() != args_num)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        std::array<double, args_num> vals;
+        for (size_t i = 0; i < out.size(); i++)
+        {
+          for (size_t j = 0; j < args_num; j++)
+            vals[j] = input_vars[j][i];
+          out[i] = cpp_f(vals);
+        }
+        return Ok{};
+      },
+      [&](const FuncObj& f_obj) -> Ret
+      {
+        if (not bool(f_obj.linked_rhs))
+          return std::unexpected(f_obj.linked_rhs.error());
+        else if (f_obj.linked_rhs->args_num != input_vars.size())
+          return std::unexpected(zc::Error::cpp_incorrect_argnum());
+
+        if constexpr (type == parsing::Type::RPN)
+          return zc::evaluate_batch(
+            f_obj.linked_rhs->repr, f_obj.linked_rhs->stack_depth, input_vars, out, 0, cache, workspace);
+        else
+        {
+          std::vector<double> vals(input_vars.size());
+          for (size_t i = 0; i < out.size(); i++)
+          {
+            for (size_t j = 0; j < vals.size(); j++)
+              vals[j] = input_vars[j][i];
+
+            auto exp_res = zc::evaluate(f_obj.linked_rhs->repr, vals, cache);
+            if (not exp_res)
+              return std::unexpected(std::move(exp_res.error()));
+            out[i] = *exp_res;
+          }
+          return Ok{};
+        }
+      },
+      [&](const ConstObj& cst) -> Ret
+      {
+        if (input_vars.size() != 0)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        std::ranges::fill(out, cst.val);
+        return Ok{};
+      },
+      [&]<class T>(const T& obj) -> Ret
+        requires utils::is_any_of<T, SeqObj, DataObj>
+      {
+        if (input_vars.size() != 1)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        if constexpr (std::is_same_v<T, SeqObj>)
+          if (not bool(obj.linked_rhs))
+            return std::unexpected(obj.linked_rhs.error());
+
+        const auto& linked_rhs = [&]() -> const auto& {
+          if constexpr (std::is_same_v<T, SeqObj>)
+            return *obj.linked_rhs;
+          else return obj.linked_rhs;
+        }();
+
+        for (size_t i = 0; i < out.size(); i++)
+        {
+          auto exp_res = zc::evaluate(linked_rhs, input_vars.front()[i], cache);
+          if (not exp_res)
+            return std::unexpected(std::move(exp_res.error()));
+          out[i] = *exp_res;
+        }
+        return Ok{};
+      }
+    },
+    parsed_data
+  );
+}
+
+template <parsing::Type type>
+std::expected<Dual, Error> DynMathObject<type>::evaluate_dual(std::initializer_list<double> vals,
+                                                              size_t var_index,
+                                                              eval::Cache* cache) const
+{
+  using Ret = std::expected<Dual, Error>;
+  if (auto err = error())
+    return std::unexpected(*err);
+
+  if (var_index >= vals.size())
+    return std::unexpected(Error::cpp_incorrect_argnum());
+
+  std::vector<Dual> dual_vals;
+  dual_vals.reserve(vals.size());
+  for (double val: vals)
+    dual_vals.push_back({val, dual_vals.size() == var_index ? 1. : 0.});
+
+  return std::visit(
+    utils::overloaded{
+      [&](zc::Error err) -> Ret
+      {
+        return std::unexpected(err);
+      },
+      [&]<size_t args_num>(CppFunction<args_num> cpp_f) -> Ret
+      {
+        if (vals.size() != args_num)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        return eval::DualEvaluator<parsing::Type::FAST>{.input_vars = {}, .subnodes = dual_vals}(cpp_f);
+      },
+      [&](const FuncObj& f_obj) -> Ret
+      {
+        if (not bool(f_obj.linked_rhs))
+          return std::unexpected(f_obj.linked_rhs.error());
+        else if (f_obj.linked_rhs->args_num != vals.size())
+          return std::unexpected(zc::Error::cpp_incorrect_argnum());
+
+        if constexpr (type == parsing::Type::RPN)
+          return zc::evaluate_dual(f_obj.linked_rhs->repr, f_obj.linked_rhs->stack_depth, dual_vals, 0, cache);
+        else if constexpr (type == parsing::Type::FAST)
+          return zc::evaluate_dual(f_obj.linked_rhs->repr, dual_vals, cache);
+        else return std::unexpected(Error::not_implemented());
+      },
+      [&](const ConstObj&) -> Ret
+      {
+        // constants have no input variable to differentiate with respect to
+        return std::unexpected(Error::cpp_incorrect_argnum());
+      },
+      [&]<class T>(const T&) -> Ret
+        requires utils::is_any_of<T, SeqObj, DataObj>
+      {
+        if (vals.size() != 1)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        auto exp_res = evaluate(vals, cache);
+        if (not exp_res)
+          return std::unexpected(std::move(exp_res.error()));
+        else return Dual{*exp_res, 0};
+      }
+    },
+    parsed_data
+  );
+}
+
+template <parsing::Type type>
+std::expected<double, Error> DynMathObject<type>::evaluate_gradient(std::initializer_list<double> vals,
+                                                                    std::span<double> gradient,
+                                                                    eval::Cache* cache,
+                                                                    eval::GradientWorkspace* workspace) const
+{
+  using Ret = std::expected<double, Error>;
+  if (auto err = error())
+    return std::unexpected(*err);
+
+  if (gradient.size() != vals.size())
+    return std::unexpected(Error::cpp_incorrect_argnum());
+
+  return std::visit(
+    utils::overloaded{
+      [&](zc::Error err) -> Ret
+      {
+        return std::unexpected(err);
+      },
+      [&]<size_t args_num>(CppFunction<args_num> cpp_f) -> Ret
+      {
+        if (vals.size() != args_num)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        const auto partial_derivatives = builtin_gradient(cpp_f);
+        if (not partial_derivatives)
+          return std::unexpected(Error::not_implemented());
+
+        std::array<double, args_num> args;
+        std::ranges::copy(vals, args.begin());
+        for (size_t i = 0; i < args_num; i++)
+          gradient[i] = (*partial_derivatives)[i](args);
+
+        return cpp_f(args);
+      },
+      [&](const FuncObj& f_obj) -> Ret
+      {
+        if (not bool(f_obj.linked_rhs))
+          return std::unexpected(f_obj.linked_rhs.error());
+        else if (f_obj.linked_rhs->args_num != vals.size())
+          return std::unexpected(zc::Error::cpp_incorrect_argnum());
+
+        if constexpr (type == parsing::Type::RPN)
+          return zc::evaluate_gradient(
+            f_obj.linked_rhs->repr, f_obj.linked_rhs->stack_depth, vals, gradient, 0, cache, workspace);
+        else return std::unexpected(Error::not_implemented());
+      },
+      [&](const ConstObj& cst) -> Ret
+      {
+        if (vals.size() != 0)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        return cst.val;
+      },
+      [&]<class T>(const T&) -> Ret
+        requires utils::is_any_of<T, SeqObj, DataObj>
+      {
+        if (vals.size() != 1)
+          return std::unexpected(Error::cpp_incorrect_argnum());
+
+        // sequences and data are only defined over integers
+        gradient.front() = 0;
+        return evaluate(vals, cache);
+      }
+    },
+    parsed_data
+  );
+}
+
+template <parsing::Type type>
+std::expected<Ok, Error> DynMathObject<type>::evaluate_batch(std::span<const double> xs,
+                                                             std::span<double> out,
+                                                             eval::Cache* cache,
+                                                             eval::BatchWorkspace* workspace) const
+{
+  return evaluate_batch(std::array{xs}, out, cache, workspace);
+}
+
+template <parsing::Type type>
+std::expected<Ok, Error>
+  DynMathObject<type>::evaluate_parallel(std::span<const std::span<const double>> input_vars,
+                                         std::span<double> out,
+                                         eval::ThreadPool& pool) const
+{
+  if constexpr (type == parsing::Type::RPN)
+  {
+    const FuncObj* f_obj = std::get_if<FuncObj>(&parsed_data);
+    if (has_value() and f_obj and f_obj->linked_rhs and f_obj->linked_rhs->args_num == input_vars.size()
+        and std::ranges::all_of(input_vars, [&](auto vals) { return vals.size() == out.size(); }))
+      return zc::evaluate_parallel(f_obj->linked_rhs->repr, input_vars, out, pool);
+  }
+
+  // errors get reported by evaluate_batch() too
+  return evaluate_batch(input_vars, out);
+}
+
+template <parsing::Type type>
+std::expected<Ok, Error> DynMathObject<type>::evaluate_parallel(std::span<const double> xs,
+                                                                std::span<double> out,
+                                                                eval::ThreadPool& pool) const
+{
+  return evaluate_parallel(std::array{xs}, out, pool);
+}
+
 template <parsing::Type type>
 template <size_t args_num>
 DynMathObject<type>& DynMathObject<type>::set(std::string_view name, CppFunction<args_num> cpp_f)
@@ -243,30 +523,37 @@ DynMathObject<type>& DynMathObject<type>::operator = (std::string definition)
     parsed_data = ast.error();
 
   // the root node of the tree must be the equal sign
-  else if (not (ast->is_func() and ast->func_data().type == parsing::AST::Func::OP_ASSIGN))
+  else if (not ((*ast)->is_func() and (*ast)->func_data().type == parsing::AST::Func::OP_ASSIGN))
     parsed_data = Error::not_math_object_definition();
 
   else
   {
-    auto& funcop_data = ast->func_data();
+    const size_t assign_pos = (*ast)->name.begin;
 
-    assert(funcop_data.subnodes.size() == 2);
+    assert(ast->subnodes().size() == 2);
 
-    auto& rhs = funcop_data.subnodes[1];
-    parsing::offset_tokens(rhs, -int(ast->name.begin));
+    // the rhs is copied in a tree of its own, that the object owns
+    parsing::AST rhs(*ast, *ast->subnodes()[1].entry);
+    parsing::offset_tokens(rhs, -int(assign_pos));
 
-    if (rhs.is_func() and rhs.func_data().type == parsing::AST::Func::SEPARATOR)
-      parsed_data = SeqObj{.rhs_str = definition.substr(ast->name.begin),
-                           .rhs = std::move(rhs.func_data().subnodes)};
+    // the texts of the ASTs stored in the object are positions in its own 'rhs_str'
+    if (rhs->is_func() and rhs->func_data().type == parsing::AST::Func::SEPARATOR)
+    {
+      parsed_data = SeqObj{.rhs_str = definition.substr(assign_pos)};
+      SeqObj& seq_obj = std::get<SeqObj>(parsed_data);
+      seq_obj.rhs.reserve(rhs.subnodes().size());
+      for (parsing::AST::Ref seq_ast: rhs.subnodes())
+        seq_obj.rhs.emplace_back(rhs, *seq_ast.entry);
+    }
 
-    else if (rhs.is_number())
-      parsed_data = ConstObj{.val = rhs.number_data().value,
-                             .rhs_str = definition.substr(ast->name.begin)};
+    else if (rhs->is_number())
+      parsed_data = ConstObj{.val = rhs->number_data().value,
+                             .rhs_str = definition.substr(assign_pos)};
 
     else
-      parsed_data = FuncObj{.rhs_str = definition.substr(ast->name.begin), .rhs = std::move(rhs)};
+      parsed_data = FuncObj{.rhs_str = definition.substr(assign_pos), .rhs = std::move(rhs)};
 
-    set_name_internal(funcop_data.subnodes[0], definition.substr(0, ast->name.begin));
+    set_name_internal(ast->subnodes()[0], definition.substr(0, assign_pos));
   }
 
   finalize_asts();
@@ -276,6 +563,88 @@ DynMathObject<type>& DynMathObject<type>::operator = (std::string definition)
   return *this;
 }
 
+template <parsing::Type type>
+DynMathObject<type>& DynMathObject<type>::set_derivative(std::string_view name,
+                                                         std::string_view function,
+                                                         std::string_view variable)
+{
+  std::string old_name(get_name());
+
+  parsed_data = FuncObj{.rhs_str = {},
+                        .rhs = {},
+                        .derivative_of = DerivativeOf{.function = std::string(function),
+                                                      .variable = std::string(variable)}};
+
+  // the name is set alone first, then along with the input variables of 'function'
+  set_name_internal(name, name);
+
+  finalize_asts();
+
+  mathworld.object_updated(slot, old_name, std::string(get_name()));
+
+  return *this;
+}
+
+template <parsing::Type type>
+std::optional<zc::Error> DynMathObject<type>::update_derivative(FuncObj& f_obj)
+{
+  assert(f_obj.derivative_of);
+  const auto& [function, variable] = *f_obj.derivative_of;
+
+  // the equation stays empty as long as the derivative cannot be written
+  f_obj.rhs_str.clear();
+  f_obj.rhs = {};
+
+  if (not exp_lhs)
+    return exp_lhs.error();
+
+  const DynMathObject* source = mathworld.get(function);
+  if (not source)
+    return Error::undefined_function(parsing::tokens::Text(function, 0), function);
+
+  const FuncObj* source_f_obj = std::get_if<FuncObj>(&source->parsed_data);
+  if (not source_f_obj)
+    return Error::wrong_object_type(parsing::tokens::Text(function, 0), function);
+
+  const std::vector<std::string> var_names = source->get_input_var_names();
+  auto var_it = std::ranges::find(var_names, variable);
+  if (var_it == var_names.end())
+    return Error::undefined_variable(parsing::tokens::Text(variable, 0), variable);
+
+  // the texts of the body are positions in 'rhs_str', they become positions in the whole equation
+  parsing::AST body = parsing::mark_input_vars{source_f_obj->rhs_str, var_names}(source_f_obj->rhs);
+  parsing::offset_tokens(body, int(source->lhs_str.size()));
+
+  parsing::differentiate<type> differentiator{source->lhs_str + source_f_obj->rhs_str, mathworld};
+  auto exp_derivative = differentiator(body, std::distance(var_names.begin(), var_it));
+  if (not exp_derivative)
+    return exp_derivative.error();
+
+  // the derivative is written back as an equation, that gets parsed like any other,
+  // so the object can be printed, and the offsets of its errors match its equation
+  std::string definition = std::string(exp_lhs->name.in(lhs_str)) + "(";
+  for (size_t i = 0; i != var_names.size(); i++)
+    definition += (i == 0 ? "" : ", ") + var_names[i];
+  definition += ") = " + parsing::to_expression(*exp_derivative, differentiator.source);
+
+  auto ast = parsing::tokenize(definition)
+               .and_then(parsing::make_ast{definition})
+               .transform(parsing::flatten_separators);
+  if (not ast)
+    return ast.error();
+
+  const size_t assign_pos = (*ast)->name.begin;
+  assert((*ast)->func_data().type == parsing::AST::Func::OP_ASSIGN and ast->subnodes().size() == 2);
+
+  f_obj.rhs = parsing::AST(*ast, *ast->subnodes()[1].entry);
+  parsing::offset_tokens(f_obj.rhs, -int(assign_pos));
+  f_obj.rhs_str = definition.substr(assign_pos);
+
+  set_name_internal(ast->subnodes()[0], definition.substr(0, assign_pos));
+
+  return {};
+}
+
 template <parsing::Type type>
 DynMathObject<type>::operator bool () const
 {
@@ -288,7 +657,7 @@ std::expected<Ok, zc::Error> DynMathObject<type>::name_status() const
   if (bool(exp_lhs))
   {
     if (exp_lhs->name_already_taken)
-      return std::unexpected(Error::name_already_taken(exp_lhs->name, exp_lhs->substr.substr));
+      return std::unexpected(Error::name_already_taken(exp_lhs->name, lhs_str));
     else return Ok{};
   }
   else return std::unexpected(exp_lhs.error());
@@ -314,9 +683,6 @@ std::expected<Ok, zc::Error> DynMathObject<type>::object_status() const
     parsed_data
   );
 
-  if (not bool(status) and not status.error().token.substr.empty() and (holds(FUNCTION) or holds(SEQUENCE)))
-    status.error().token.begin += lhs_str.size();
-
   return status;
 }
 
@@ -525,8 +891,9 @@ DynMathObject<type>& DynMathObject<type>::bulk_data_input(size_t index, std::vec
     data_obj.linked_rhs.repr[i] = data_obj.rhs[i].and_then(
       [&](auto&& ast)
       {
-        return get_final_repr(ast, data_obj.data[i]);
+        return get_final_repr(ast, {}, data_obj.data[i]);
       });
+    update_stack_depth(data_obj.linked_rhs, data_obj.linked_rhs.repr[i]);
     i++;
   }
 
@@ -596,23 +963,40 @@ std::optional<std::string> DynMathObject<type>::get_data_point(size_t index) con
 
 template <parsing::Type type>
 std::expected<parsing::Parsing<type>, zc::Error>
-  DynMathObject<type>::get_final_repr(const parsing::AST& ast, std::string_view equation)
+  DynMathObject<type>::get_final_repr(const parsing::AST& ast, std::string_view lhs, std::string_view rhs)
 {
   std::vector<std::string> var_names;
   if (bool(exp_lhs))
   {
     var_names.reserve(exp_lhs->input_vars.size());
-    std::ranges::transform(exp_lhs->input_vars,
-                           std::back_inserter(var_names),
-                           &parsing::tokens::Text::substr);
+    for (const parsing::tokens::Text& input_var: exp_lhs->input_vars)
+      var_names.emplace_back(input_var.in(lhs_str));
   }
 
-  auto final_ast = parsing::mark_input_vars{var_names}(ast);
+  // the texts of the final tree are positions in the whole equation, that its errors get built against
+  auto final_ast = parsing::mark_input_vars{rhs, var_names}(ast);
+  parsing::offset_tokens(final_ast, int(lhs.size()));
+  auto exp_fast = parsing::make_fast<type>{std::string(lhs) + std::string(rhs), mathworld}(final_ast);
+  if (exp_fast)
+    *exp_fast = mathworld.optimize(std::move(*exp_fast));
+
   if constexpr (type == parsing::Type::FAST)
-    return parsing::make_fast<type>{std::string(equation), mathworld}(final_ast);
+    return exp_fast;
+  else if constexpr (type == parsing::Type::RPN)
+    return exp_fast.transform(parsing::make_RPN)
+                   .transform([&](parsing::RPN rpn) { return mathworld.optimize(std::move(rpn)); });
   else
-    return parsing::make_fast<type>{std::string(equation), mathworld}(final_ast).transform(
-      parsing::make_RPN);
+    return exp_fast.transform(parsing::make_bytecode);
+}
+
+template <parsing::Type type>
+void DynMathObject<type>::update_stack_depth(
+  [[maybe_unused]] parsing::LinkedData<type>& data,
+  [[maybe_unused]] const std::expected<parsing::Parsing<type>, zc::Error>& repr)
+{
+  if constexpr (type == parsing::Type::RPN)
+    if (repr)
+      data.stack_depth = std::max(data.stack_depth, parsing::max_stack_depth(*repr));
 }
 
 template <parsing::Type type>
@@ -632,17 +1016,29 @@ DynMathObject<type>& DynMathObject<type>::finalize_asts()
       },
       [&](FuncObj& f_obj)
       {
+        if (f_obj.derivative_of)
+          if (auto error = update_derivative(f_obj))
+          {
+            f_obj.linked_rhs = std::unexpected(*error);
+            return;
+          }
+
         f_obj.linked_rhs =
           parsing::LinkedFunc<type>{.repr = {},
                                     .args_num = exp_lhs
                                                 ? exp_lhs->input_vars.size()
                                                 : 0
           };
+        update_purity();
         if constexpr (linked)
         {
-          auto exp_repr = get_final_repr(f_obj.rhs, lhs_str + f_obj.rhs_str);
+          auto exp_repr = get_final_repr(f_obj.rhs, lhs_str, f_obj.rhs_str);
           if (bool(exp_repr))
+          {
             f_obj.linked_rhs->repr = std::move(*exp_repr);
+            if constexpr (type == parsing::Type::RPN)
+              f_obj.linked_rhs->stack_depth = parsing::max_stack_depth(f_obj.linked_rhs->repr);
+          }
           else
             f_obj.linked_rhs = std::unexpected(exp_repr.error());
         }
@@ -658,15 +1054,21 @@ DynMathObject<type>& DynMathObject<type>::finalize_asts()
           values.reserve(seq_obj.rhs.size());
           for (const parsing::AST& ast : seq_obj.rhs)
           {
-            auto exp_linked = get_final_repr(ast, lhs_str + seq_obj.rhs_str);
+            auto exp_linked = get_final_repr(ast, lhs_str, seq_obj.rhs_str);
             if (bool(exp_linked))
+            {
+              if constexpr (type == parsing::Type::RPN)
+                seq_obj.linked_rhs->stack_depth = std::max(seq_obj.linked_rhs->stack_depth,
+                                                           parsing::max_stack_depth(*exp_linked));
               values.push_back(std::move(*exp_linked));
+            }
             else
             {
               seq_obj.linked_rhs = std::unexpected(exp_linked.error());
               return;
             }
           }
+          seq_obj.linked_rhs->recursive = direct_dependencies().contains(get_name());
         }
       },
       [&](DataObj& data_obj)
@@ -675,24 +1077,88 @@ DynMathObject<type>& DynMathObject<type>::finalize_asts()
         data_obj.linked_rhs.repr.reserve(data_obj.rhs.size());
         data_obj.linked_rhs.slot = slot;
         data_obj.linked_rhs.object_revision = revision;
+        data_obj.linked_rhs.stack_depth = 0;
 
         for (size_t i = 0; i != data_obj.rhs.size(); i++)
+        {
           data_obj.linked_rhs.repr.push_back(data_obj.rhs[i].and_then(
             [&](auto&& val)
             {
-              return get_final_repr(val, data_obj.data[i]);
+              return get_final_repr(val, {}, data_obj.data[i]);
             }));
+          update_stack_depth(data_obj.linked_rhs, data_obj.linked_rhs.repr.back());
+        }
       }},
     parsed_data);
 
   return *this;
 }
 
+template <parsing::Type type>
+void DynMathObject<type>::update_purity()
+{
+  auto* f_obj = std::get_if<FuncObj>(&parsed_data);
+  if (not f_obj or not f_obj->linked_rhs)
+    return;
+
+  auto is_pure_object = [&](const DynMathObject<type>& obj)
+  {
+    return std::visit(
+      utils::overloaded{
+        [](const ConstObj&) { return true; },
+        [](const FuncObj&) { return true; },
+        []<size_t args_num>(CppFunction<args_num> f) { return is_builtin(f); },
+        [](const auto&) { return false; },
+      },
+      obj.parsed_data);
+  };
+
+  // depth first search over the objects called, directly or not
+  // an object is mapped to false while its callees are being explored: meeting it again means recursion
+  std::unordered_map<std::string, bool> explored;
+
+  auto is_pure_callee = [&](auto& is_pure_callee, const std::string& name) -> bool
+  {
+    if (auto it = explored.find(name); it != explored.end())
+      return it->second;
+
+    const DynMathObject<type>* obj = mathworld.get(name);
+    if (not obj or not is_pure_object(*obj))
+      return false;
+
+    explored[name] = false;
+    for (auto&& [dep_name, dep]: obj->direct_dependencies())
+      if (not is_pure_callee(is_pure_callee, dep_name))
+        return false;
+
+    explored[name] = true;
+    return true;
+  };
+
+  f_obj->linked_rhs->pure = is_pure_callee(is_pure_callee, std::string(get_name()));
+}
+
+template <parsing::Type type>
+bool DynMathObject<type>::jit_compile()
+{
+  if constexpr (type == parsing::Type::RPN)
+  {
+    FuncObj* f_obj = std::get_if<FuncObj>(&parsed_data);
+    if (not f_obj or not f_obj->linked_rhs or f_obj->linked_rhs->jit)
+      return false;
+
+    f_obj->linked_rhs->jit = eval::jit::compile(f_obj->linked_rhs->repr,
+                                                f_obj->linked_rhs->stack_depth);
+    return bool(f_obj->linked_rhs->jit);
+  }
+  else return false;
+}
+
 template <parsing::Type type>
 std::string_view DynMathObject<type>::get_name() const
 {
   if (exp_lhs and not exp_lhs->name_already_taken)
-    return exp_lhs->name.substr;
+    return exp_lhs->name.in(lhs_str);
   else return std::string_view();
 }
 
@@ -703,9 +1169,8 @@ std::vector<std::string> DynMathObject<type>::get_input_var_names() const
   if (exp_lhs)
   {
     var_names.reserve(exp_lhs->input_vars.size());
-    std::ranges::transform(exp_lhs->input_vars,
-                           std::back_inserter(var_names),
-                           &parsing::tokens::Text::substr);
+    for (const parsing::tokens::Text& input_var: exp_lhs->input_vars)
+      var_names.emplace_back(input_var.in(lhs_str));
   }
   return var_names;
 }
@@ -743,23 +1208,26 @@ std::optional<std::string> DynMathObject<type>::get_equation() const
 template <parsing::Type type>
 Deps DynMathObject<type>::direct_dependencies() const
 {
+  const std::vector<std::string> input_vars = get_input_var_names();
   return std::visit(utils::overloaded{
     [&](const zc::Error&) { return Deps(); },
     [&](const ConstObj&) { return Deps(); },
     [&]<size_t args_num>(CppFunction<args_num>) { return Deps(); },
     [&](const FuncObj& f_obj)
     {
-      auto var_names = exp_lhs->input_vars | std::views::transform(&parsing::tokens::Text::substr);
-      auto deps = parsing::direct_dependencies(parsing::mark_input_vars{var_names}(f_obj.rhs));
+      auto deps = f_obj.rhs_str.empty()
+                    ? Deps()
+                    : parsing::direct_dependencies(f_obj.rhs, f_obj.rhs_str, input_vars);
+      if (f_obj.derivative_of)
+        deps.insert({f_obj.derivative_of->function, Dep{Dep::FUNCTION}});
       return deps;
     },
     [&](const SeqObj& seq_obj)
     {
       auto deps = Deps();
-      auto var_names = exp_lhs->input_vars | std::views::transform(&parsing::tokens::Text::substr);
       for (const parsing::AST& ast: seq_obj.rhs)
       {
-        auto extra_deps = parsing::direct_dependencies(parsing::mark_input_vars{var_names}(ast));
+        auto extra_deps = parsing::direct_dependencies(ast, seq_obj.rhs_str, input_vars);
         deps.insert(extra_deps.begin(), extra_deps.end());
       }
       return deps;
@@ -767,13 +1235,12 @@ Deps DynMathObject<type>::direct_dependencies() const
     [&](const DataObj& data_obj)
     {
       auto deps = Deps();
-      auto var_names = exp_lhs->input_vars | std::views::transform(&parsing::tokens::Text::substr);
-      for (const auto& exp_ast: data_obj.rhs)
+      for (size_t i = 0; i != data_obj.rhs.size(); i++)
       {
-        if (not bool(exp_ast))
+        if (not bool(data_obj.rhs[i]))
           continue;
 
-        auto extra_deps = parsing::direct_dependencies(parsing::mark_input_vars{var_names}(*exp_ast));
+        auto extra_deps = parsing::direct_dependencies(*data_obj.rhs[i], data_obj.data[i], input_vars);
         deps.insert(extra_deps.begin(), extra_deps.end());
       }
       return deps;
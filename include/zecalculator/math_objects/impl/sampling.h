@@ -0,0 +1,140 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include <zecalculator/math_objects/decl/sampling.h>
+#include <zecalculator/math_objects/impl/dyn_math_object.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace zc {
+
+namespace internal {
+
+  /// @brief segment of the polyline whose middle point is being evaluated
+  struct SampledSegment
+  {
+    SampledCurve::Point left, right;
+    size_t depth;
+  };
+
+  /// @brief says if the segment needs the points on both sides of its middle point 'mid'
+  inline bool needs_refinement(const SampledSegment& segment,
+                               const SampledCurve::Point& mid,
+                               const SamplingOptions& options)
+  {
+    // narrower segments can't be drawn any better
+    if (segment.depth >= options.max_depth
+        or segment.right.x - segment.left.x <= options.tolerance * options.pixel_width)
+      return false;
+
+    const bool left_finite = std::isfinite(segment.left.y);
+    const bool mid_finite = std::isfinite(mid.y);
+    const bool right_finite = std::isfinite(segment.right.y);
+
+    // locate where the curve becomes undefined or infinite
+    if (left_finite != mid_finite or mid_finite != right_finite)
+      return true;
+    else if (not mid_finite)
+      return false;
+
+    // distance, in pixels, of the middle point to the segment: the curve bends here
+    const double chord_y = std::midpoint(segment.left.y, segment.right.y);
+    return std::abs(mid.y - chord_y) > options.tolerance * options.pixel_height;
+  }
+
+} // namespace internal
+
+template <parsing::Type type>
+std::expected<SampledCurve, Error> sample_adaptive(const DynMathObject<type>& obj,
+                                                   double x_min,
+                                                   double x_max,
+                                                   const SamplingOptions& options,
+                                                   eval::Cache* cache)
+{
+  using Point = SampledCurve::Point;
+  using internal::SampledSegment;
+
+  assert(x_min < x_max and options.pixel_width > 0 and options.pixel_height > 0);
+
+  SampledCurve curve;
+
+  std::vector<double> xs, ys;
+  auto evaluate = [&]() -> std::expected<Ok, Error>
+  {
+    ys.resize(xs.size());
+    curve.evaluations += xs.size();
+    curve.batches++;
+    return obj.evaluate_batch(xs, ys, cache);
+  };
+
+  const size_t initial_samples = std::max(options.initial_samples, size_t(2));
+  xs.resize(initial_samples);
+  for (size_t i = 0; i != initial_samples; i++)
+    xs[i] = std::lerp(x_min, x_max, double(i) / double(initial_samples - 1));
+
+  if (auto res = evaluate(); not res)
+    return std::unexpected(std::move(res.error()));
+
+  std::vector<SampledSegment> segments;
+  for (size_t i = 0; i != initial_samples; i++)
+  {
+    curve.points.push_back(Point{xs[i], ys[i]});
+    if (i != 0)
+      segments.push_back(SampledSegment{curve.points[i - 1], curve.points[i], 0});
+  }
+
+  // every round evaluates the middle points of the segments of the same depth in one batch
+  std::vector<SampledSegment> next_segments;
+  while (not segments.empty())
+  {
+    xs.clear();
+    for (const SampledSegment& segment: segments)
+      xs.push_back(std::midpoint(segment.left.x, segment.right.x));
+
+    if (auto res = evaluate(); not res)
+      return std::unexpected(std::move(res.error()));
+
+    next_segments.clear();
+    for (size_t i = 0; i != segments.size(); i++)
+    {
+      const Point mid{xs[i], ys[i]};
+      curve.points.push_back(mid);
+
+      if (internal::needs_refinement(segments[i], mid, options))
+      {
+        const size_t depth = segments[i].depth + 1;
+        next_segments.push_back(SampledSegment{segments[i].left, mid, depth});
+        next_segments.push_back(SampledSegment{mid, segments[i].right, depth});
+      }
+    }
+    std::swap(segments, next_segments);
+  }
+
+  std::ranges::sort(curve.points, {}, &Point::x);
+
+  return curve;
+}
+
+} // namespace zc
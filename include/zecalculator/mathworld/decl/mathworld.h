@@ -24,17 +24,21 @@
 #include <zecalculator/math_objects/builtin.h>
 #include <zecalculator/math_objects/decl/dyn_math_object.h>
 #include <zecalculator/math_objects/object_list.h>
+#include <zecalculator/mathworld/decl/prepared_expression.h>
 #include <zecalculator/parsing/data_structures/ast.h>
 #include <zecalculator/parsing/data_structures/deps.h>
+#include <zecalculator/parsing/data_structures/token.h>
 #include <zecalculator/utils/name_map.h>
 #include <zecalculator/utils/refs.h>
 #include <zecalculator/utils/slotted_deque.h>
 #include <zecalculator/utils/tuple.h>
 #include <zecalculator/utils/utils.h>
 
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_set>
+#include <vector>
 
 namespace zc {
 
@@ -54,6 +58,10 @@ namespace rpn {
   using MathWorld = zc::MathWorld<parsing::Type::RPN>;
 }
 
+namespace bytecode {
+  using MathWorld = zc::MathWorld<parsing::Type::BYTECODE>;
+}
+
 template <parsing::Type type>
 class MathWorld
 {
@@ -100,8 +108,85 @@ public:
   Deps direct_dependencies(std::string_view name) const;
 
   /// @brief evaluates a given expression within this world
+  /// @note  in RPN worlds, the expression is compiled straight from its tokens, see parsing::compile_rpn,
+  ///        then gets the same RPN passes as linked objects: superinstructions and vector math.
+  ///        The usual pipeline only runs when compile_rpn cannot give its results, or with fma contraction
   std::expected<double, Error> evaluate(std::string expr) const;
 
+  /// @brief parses and links 'expr' once, to evaluate it many times with different inputs
+  /// @param input_vars: names of the input variables of 'expr', in the order their values will be given
+  /// @note  the handle holds the linked expression along with the revision of the world it got linked against,
+  ///        it relinks transparently when it gets called after the world changed, see get_revision()
+  /// @note  the handle is in an error state if 'expr' cannot be linked, see PreparedExpression::error()
+  /// @note  the handle must not outlive this world
+  PreparedExpression<type> compile(std::string expr, std::vector<std::string> input_vars = {}) const;
+
+  /// @brief returns the number of changes this world went through so far
+  /// @note  every object update, e.g. a new definition, a rename or a deletion, and every change
+  ///        of the optimization options increments it
+  size_t get_revision() const;
+
+  /// @brief defines the function 'name' as the derivative of the function 'function'
+  ///        with respect to its input variable 'variable', e.g. "df(x) = -sin(x)" from "f(x) = cos(x)"
+  /// @note  the derivative is written symbolically then linked like any other function:
+  ///        it follows the changes of 'function' and of the functions 'function' calls
+  /// @note  redefines the object named 'name' if there is one, otherwise creates a new one
+  /// @note  the returned object is in an error state if 'function' cannot be differentiated,
+  ///        e.g. when it calls a recursive function, "min", "max" or a non builtin C++ function
+  DynMathObject<type>& derivative(std::string_view function, std::string_view variable, std::string_view name);
+
+  /// @brief enables or disables the folding of constant subexpressions, e.g. "2*3+cos(0)" into "7"
+  /// @note  enabled by default, disable it to evaluate expressions exactly as they are written
+  ///        e.g. when the floating point environment gets changed between evaluations
+  /// @note  relinks every object of this world
+  void set_constant_folding(bool enabled);
+
+  /// @brief says if constant subexpressions are folded when linking math objects
+  bool get_constant_folding() const;
+
+  /// @brief enables or disables algebraic simplifications, e.g. "x*1" into "x" or "x^3" into "x*x*x"
+  /// @note  enabled by default, see parsing::simplify(): results of powers with constant positive
+  ///        integer exponents may change in the last bits
+  /// @note  relinks every object of this world
+  void set_simplification(bool enabled);
+
+  /// @brief says if expressions are simplified when linking math objects
+  bool get_simplification() const;
+
+  /// @brief enables or disables the inlining of function calls, e.g. "g(2*x)" into "2*x+1" when "g(x) = x+1"
+  /// @note  enabled by default, recursive calls are never inlined, see parsing::make_fast::inline_call()
+  /// @note  relinks every object of this world
+  void set_inlining(bool enabled);
+
+  /// @brief says if function calls are inlined when linking math objects
+  bool get_inlining() const;
+
+  /// @brief enables or disables superinstructions in RPN programs, see parsing::fuse_nodes()
+  /// @note  enabled by default, results do not change
+  /// @note  relinks every object of this world
+  void set_node_fusion(bool enabled);
+
+  /// @brief says if RPN programs get superinstructions when linking math objects
+  bool get_node_fusion() const;
+
+  /// @brief enables or disables the contraction of multiplications followed by additions into std::fma
+  /// @note  disabled by default: fused multiply-adds round only once, so results may change in the last bits
+  /// @note  only used by RPN programs, when node fusion is enabled
+  /// @note  relinks every object of this world
+  void set_fma_contraction(bool enabled);
+
+  /// @brief says if multiplications followed by additions get contracted into std::fma
+  bool get_fma_contraction() const;
+
+  /// @brief enables or disables the approximations of cos, sin, exp and ln that have vectorized kernels
+  /// @note  disabled by default: results differ from libm's in the last bits, see zc::approx
+  /// @note  only used by RPN programs, where every evaluation path then gives the same results
+  /// @note  relinks every object of this world
+  void set_vector_math(bool enabled);
+
+  /// @brief says if cos, sin, exp and ln get replaced with their vectorized approximations
+  bool get_vector_math() const;
+
   /// @brief return the direct reverse dependencies, aka objects that depend directly on 'name'
   Deps direct_revdeps(std::string_view name) const;
 
@@ -139,12 +224,45 @@ protected:
   /// @brief go through all functions that depend on 'old_name' or 'new_name' and rebind them
   void rebind_dependent_functions(const std::unordered_set<std::string>& names);
 
+  /// @brief compiles the linked functions of 'objs' to native code, RPN only
+  /// @note  callees get compiled before their callers, objects that cannot be compiled keep RPN
+  void jit_compile(const std::unordered_set<DynMathObject<type>*>& objs);
+
+  /// @brief relinks every object, e.g. when the optimizations change
+  void relink_all();
+
+  /// @brief applies the enabled optimization passes on 'tree'
+  parsing::FAST<type> optimize(parsing::FAST<type> tree) const;
+
+  /// @brief applies the enabled optimization passes on 'rpn'
+  parsing::RPN optimize(parsing::RPN rpn) const;
+
+  /// @brief parses 'expr' then links it against the current state of this world, with all the enabled optimizations
+  std::expected<parsing::Parsing<type>, Error> link(std::string_view expr,
+                                                    const std::vector<std::string>& input_vars) const;
+
+  /// @brief same as above, for an 'expr' that is already tokenized
+  std::expected<parsing::Parsing<type>, Error> link(std::string_view expr,
+                                                    std::span<const parsing::Token> tokens,
+                                                    const std::vector<std::string>& input_vars) const;
+
   /// @brief maps an object name to its slot
   name_map<size_t> inventory;
 
+  bool constant_folding = true;
+  bool simplification = true;
+  bool inlining = true;
+  bool node_fusion = true;
+  bool fma_contraction = false;
+  bool vector_math = false;
+
+  /// @brief see get_revision()
+  size_t revision = 0;
+
   SlottedDeque<DynMathObject<type>> math_objects;
 
   friend DynMathObject<type>;
+  friend PreparedExpression<type>;
 
   template <parsing::Type>
   friend struct parsing::make_fast;
@@ -0,0 +1,93 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/error.h>
+#include <zecalculator/evaluation/decl/cache.h>
+#include <zecalculator/parsing/data_structures/decl/utils.h>
+
+#include <cstddef>
+#include <expected>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+/// @brief expressions that get parsed and linked once, then evaluated many times with different inputs
+
+namespace zc {
+
+template <parsing::Type type>
+class MathWorld;
+
+/// @brief handle on an expression linked within a math world, see MathWorld::compile()
+/// @note  the world must outlive the handle
+/// @note  the handle relinks the expression when the world changed since it was last linked:
+///        calling it may modify it, give each thread its own copy when the world can change
+template <parsing::Type type>
+class PreparedExpression
+{
+public:
+
+  /// @brief evaluates the expression
+  /// @param input_vars: values of the input variables, in the order they were given to MathWorld::compile()
+  /// @note  relinks the expression first if it is stale, see is_stale()
+  std::expected<double, Error> operator () (std::span<const double> input_vars, eval::Cache* cache = nullptr);
+
+  /// @note initializer list version
+  std::expected<double, Error> operator () (std::initializer_list<double> input_vars = {},
+                                            eval::Cache* cache = nullptr);
+
+  /// @brief says if the world changed since the expression was last linked
+  /// @note  any change makes it stale, even to objects the expression does not use
+  bool is_stale() const;
+
+  /// @brief parses and links the expression again, against the current state of the world
+  void relink();
+
+  /// @brief returns the error the expression was in when it was last linked, if any
+  std::optional<Error> error() const;
+
+  const std::string& get_expression() const;
+
+  const std::vector<std::string>& get_input_var_names() const;
+
+  /// @brief revision of the world the expression was last linked against, see MathWorld::get_revision()
+  size_t get_world_revision() const;
+
+protected:
+  PreparedExpression(const MathWorld<type>& world, std::string expression, std::vector<std::string> input_vars);
+
+  const MathWorld<type>* world;
+  std::string expression;
+  std::vector<std::string> input_vars;
+
+  size_t world_revision = 0;
+  std::expected<parsing::Parsing<type>, Error> repr = std::unexpected(Error::empty_expression());
+
+  /// @brief max stack depth of 'repr', only used by the RPN representation
+  size_t stack_depth = 0;
+
+  friend MathWorld<type>;
+};
+
+} // namespace zc
@@ -22,6 +22,7 @@
 
 #include <zecalculator/math_objects/impl/dyn_math_object.h>
 #include <zecalculator/mathworld/decl/mathworld.h>
+#include <zecalculator/mathworld/impl/prepared_expression.h>
 #include <zecalculator/parsing/data_structures/decl/ast.h>
 #include <zecalculator/parsing/data_structures/token.h>
 #include <zecalculator/parsing/parser.h>
@@ -170,6 +171,9 @@ void MathWorld<type>::rebind_dependent_functions(const std::unordered_set<std::s
 
     dyn_obj->increment_revision();
 
+    // the purity of the functions is read when linking the ones that call them
+    dyn_obj->update_purity();
+
     /// try rebind if in error state
     if (not dyn_obj->has_value())
     {
@@ -219,6 +223,25 @@ void MathWorld<type>::rebind_dependent_functions(const std::unordered_set<std::s
       invalid_functions.insert(affected_func_name);
     }
   }
+
+  jit_compile(dep_eq_objs);
+}
+
+template <parsing::Type type>
+void MathWorld<type>::jit_compile(const std::unordered_set<DynMathObject<type>*>& objs)
+{
+  if (not eval::jit::enabled)
+    return;
+
+  // a function compiles only once all the functions it calls are compiled
+  // so go through the objects until none of the remaining ones can be compiled
+  bool compiled_any = true;
+  while (compiled_any)
+  {
+    compiled_any = false;
+    for (DynMathObject<type>* obj: objs)
+      compiled_any = obj->jit_compile() or compiled_any;
+  }
 }
 
 template <parsing::Type type>
@@ -232,6 +255,8 @@ void MathWorld<type>::object_updated(size_t slot,
                                      std::string old_name,
                                      std::string new_name)
 {
+  revision++;
+
   if (math_objects.is_assigned(slot))
     math_objects[slot].increment_revision();
 
@@ -246,7 +271,7 @@ void MathWorld<type>::object_updated(size_t slot,
     // old_name got freed
     // check if an object is actually waiting to have that name
     for (DynMathObject<type>& obj: math_objects)
-    if (obj.exp_lhs and obj.exp_lhs->name_already_taken and obj.exp_lhs->name.substr == old_name)
+    if (obj.exp_lhs and obj.exp_lhs->name_already_taken and obj.exp_lhs->name.in(obj.lhs_str) == old_name)
     {
       obj.exp_lhs->name_already_taken = false;
       inventory[old_name] = obj.slot;
@@ -254,6 +279,9 @@ void MathWorld<type>::object_updated(size_t slot,
     }
   }
 
+  if (math_objects.is_assigned(slot))
+    jit_compile({&math_objects[slot]});
+
   if (not old_name.empty() or not new_name.empty())
     rebind_dependent_functions({old_name, new_name});
 }
@@ -283,29 +311,225 @@ Deps MathWorld<type>::direct_revdeps(std::string_view name) const
 }
 
 template <parsing::Type type>
-std::expected<double, Error> MathWorld<type>::evaluate(std::string expr) const
+void MathWorld<type>::set_constant_folding(bool enabled)
+{
+  if (constant_folding == enabled)
+    return;
+
+  constant_folding = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_constant_folding() const
+{
+  return constant_folding;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::set_simplification(bool enabled)
+{
+  if (simplification == enabled)
+    return;
+
+  simplification = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_simplification() const
+{
+  return simplification;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::set_inlining(bool enabled)
+{
+  if (inlining == enabled)
+    return;
+
+  inlining = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_inlining() const
+{
+  return inlining;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::set_node_fusion(bool enabled)
+{
+  if (node_fusion == enabled)
+    return;
+
+  node_fusion = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_node_fusion() const
+{
+  return node_fusion;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::set_fma_contraction(bool enabled)
+{
+  if (fma_contraction == enabled)
+    return;
+
+  fma_contraction = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_fma_contraction() const
+{
+  return fma_contraction;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::set_vector_math(bool enabled)
+{
+  if (vector_math == enabled)
+    return;
+
+  vector_math = enabled;
+  relink_all();
+}
+
+template <parsing::Type type>
+bool MathWorld<type>::get_vector_math() const
+{
+  return vector_math;
+}
+
+template <parsing::Type type>
+void MathWorld<type>::relink_all()
+{
+  revision++;
+
+  std::unordered_set<DynMathObject<type>*> objs;
+  for (DynMathObject<type>& obj: math_objects)
+  {
+    obj.finalize_asts();
+    objs.insert(&obj);
+  }
+
+  jit_compile(objs);
+}
+
+template <parsing::Type type>
+parsing::FAST<type> MathWorld<type>::optimize(parsing::FAST<type> tree) const
+{
+  if (constant_folding)
+    tree = parsing::fold_constants(std::move(tree));
+
+  if (simplification)
+    tree = parsing::simplify(std::move(tree));
+
+  return tree;
+}
+
+template <parsing::Type type>
+parsing::RPN MathWorld<type>::optimize(parsing::RPN rpn) const
+{
+  if (vector_math)
+    rpn = parsing::use_vector_math(std::move(rpn));
+
+  if (node_fusion)
+    rpn = parsing::fuse_nodes(rpn, fma_contraction);
+
+  return rpn;
+}
+
+template <parsing::Type type>
+DynMathObject<type>& MathWorld<type>::derivative(std::string_view function,
+                                                 std::string_view variable,
+                                                 std::string_view name)
+{
+  DynMathObject<type>* obj = get(name);
+  if (not obj)
+    obj = &new_object();
+
+  return obj->set_derivative(name, function, variable);
+}
+
+template <parsing::Type type>
+std::expected<parsing::Parsing<type>, Error>
+  MathWorld<type>::link(std::string_view expr, const std::vector<std::string>& input_vars) const
 {
   if (expr.empty()) [[unlikely]]
     return std::unexpected(Error::empty_expression());
 
-  auto evaluate = [](const parsing::Parsing<type>& repr)
+  return parsing::tokenize(expr).and_then([&](const std::vector<parsing::Token>& tokens) {
+    return link(expr, tokens, input_vars);
+  });
+}
+
+template <parsing::Type type>
+std::expected<parsing::Parsing<type>, Error>
+  MathWorld<type>::link(std::string_view expr,
+                        std::span<const parsing::Token> tokens,
+                        const std::vector<std::string>& input_vars) const
+{
+  auto optimize = [&]<class Repr>(Repr repr)
   {
-    return zc::evaluate(repr);
+    return this->optimize(std::move(repr));
   };
 
+  auto exp_fast = parsing::make_ast{expr, input_vars}(tokens)
+                    .transform(parsing::flatten_separators)
+                    .and_then(parsing::make_fast<type>{std::string(expr), *this})
+                    .transform(optimize);
+
   if constexpr (type == parsing::Type::FAST)
-    return parsing::tokenize(expr)
-      .and_then(parsing::make_ast{expr})
-      .transform(parsing::flatten_separators)
-      .and_then(parsing::make_fast<type>{expr, *this})
-      .and_then(evaluate);
+    return exp_fast;
+  else if constexpr (type == parsing::Type::RPN)
+    return exp_fast.transform(parsing::make_RPN).transform(optimize);
   else
-    return parsing::tokenize(expr)
-      .and_then(parsing::make_ast{expr})
-      .transform(parsing::flatten_separators)
-      .and_then(parsing::make_fast<type>{expr, *this})
-      .transform(parsing::make_RPN)
-      .and_then(evaluate);
+    return exp_fast.transform(parsing::make_bytecode);
+}
+
+template <parsing::Type type>
+std::expected<double, Error> MathWorld<type>::evaluate(std::string expr) const
+{
+  if (expr.empty()) [[unlikely]]
+    return std::unexpected(Error::empty_expression());
+
+  auto evaluate_repr = [](const parsing::Parsing<type>& repr) { return zc::evaluate(repr); };
+
+  if constexpr (type == parsing::Type::RPN)
+  {
+    auto exp_tokens = parsing::tokenize(expr);
+    if (not exp_tokens)
+      return std::unexpected(exp_tokens.error());
+
+    // compiled straight from the tokens, with the results of the usual pipeline: that one only runs
+    // on what compile_rpn leaves to it, e.g. to tell what went wrong. Evaluation errors do not depend
+    // on the pipeline, the expression is not evaluated twice
+    // note: contracted into fma, the products constant folding computes first would give other results
+    if (not (node_fusion and fma_contraction and constant_folding))
+      if (auto rpn = parsing::compile_rpn{expr, *this}(*exp_tokens))
+        return zc::evaluate(optimize(std::move(*rpn)));
+
+    return link(expr, *exp_tokens, {}).and_then(evaluate_repr);
+  }
+  else return link(expr, {}).and_then(evaluate_repr);
+}
+
+template <parsing::Type type>
+PreparedExpression<type> MathWorld<type>::compile(std::string expr, std::vector<std::string> input_vars) const
+{
+  return PreparedExpression<type>(*this, std::move(expr), std::move(input_vars));
+}
+
+template <parsing::Type type>
+size_t MathWorld<type>::get_revision() const
+{
+  return revision;
 }
 
 template <parsing::Type type>
@@ -0,0 +1,106 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/evaluation/impl/evaluation.h>
+#include <zecalculator/mathworld/decl/mathworld.h>
+#include <zecalculator/mathworld/decl/prepared_expression.h>
+
+namespace zc {
+
+template <parsing::Type type>
+PreparedExpression<type>::PreparedExpression(const MathWorld<type>& world,
+                                             std::string expression,
+                                             std::vector<std::string> input_vars)
+  : world(&world), expression(std::move(expression)), input_vars(std::move(input_vars))
+{
+  relink();
+}
+
+template <parsing::Type type>
+void PreparedExpression<type>::relink()
+{
+  world_revision = world->get_revision();
+  repr = world->link(expression, input_vars);
+
+  if constexpr (type == parsing::Type::RPN)
+    stack_depth = repr ? parsing::max_stack_depth(*repr) : 0;
+}
+
+template <parsing::Type type>
+bool PreparedExpression<type>::is_stale() const
+{
+  return world_revision != world->get_revision();
+}
+
+template <parsing::Type type>
+std::expected<double, Error> PreparedExpression<type>::operator () (std::span<const double> input_vals,
+                                                                   eval::Cache* cache)
+{
+  // the linked expression may point to objects that got redefined or deleted since
+  if (is_stale()) [[unlikely]]
+    relink();
+
+  if (not repr) [[unlikely]]
+    return std::unexpected(repr.error());
+
+  if (input_vals.size() != input_vars.size()) [[unlikely]]
+    return std::unexpected(Error::cpp_incorrect_argnum());
+
+  if constexpr (type == parsing::Type::RPN)
+    return zc::evaluate(*repr, stack_depth, input_vals, 0, cache);
+  else return zc::evaluate(*repr, input_vals, cache);
+}
+
+template <parsing::Type type>
+std::expected<double, Error> PreparedExpression<type>::operator () (std::initializer_list<double> input_vals,
+                                                                   eval::Cache* cache)
+{
+  return (*this)(std::span<const double>(input_vals.begin(), input_vals.size()), cache);
+}
+
+template <parsing::Type type>
+std::optional<Error> PreparedExpression<type>::error() const
+{
+  if (repr)
+    return {};
+  else return repr.error();
+}
+
+template <parsing::Type type>
+const std::string& PreparedExpression<type>::get_expression() const
+{
+  return expression;
+}
+
+template <parsing::Type type>
+const std::vector<std::string>& PreparedExpression<type>::get_input_var_names() const
+{
+  return input_vars;
+}
+
+template <parsing::Type type>
+size_t PreparedExpression<type>::get_world_revision() const
+{
+  return world_revision;
+}
+
+} // namespace zc
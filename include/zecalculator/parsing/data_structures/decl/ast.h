@@ -23,6 +23,7 @@
 #include <variant>
 #include <vector>
 
+#include <zecalculator/parsing/data_structures/decl/flat_tree.h>
 #include <zecalculator/parsing/data_structures/decl/shared.h>
 #include <zecalculator/parsing/data_structures/token.h>
 #include <zecalculator/utils/utils.h>
@@ -52,11 +53,9 @@ namespace zc {
 
           /// @brief full expression of the operation of the function/operation,
           ///        including arguments/operands
+          /// @note  a position in the expression, like every text in the tree: nested nodes don't copy it
           parsing::tokens::Text full_expr;
 
-          /// @brief arguments to operator or to function
-          std::vector<Node> subnodes;
-
           bool operator == (const Func&) const = default;
         };
 
@@ -84,14 +83,6 @@ namespace zc {
         /// @brief data that depends on the type of the node
         std::variant<Variable, InputVariable, Number, Func> dyn_data = {};
 
-        static Node make_func(Func::Type type,
-                              parsing::tokens::Text name,
-                              parsing::tokens::Text full_expr,
-                              std::vector<Node> subnodes);
-        static Node make_input_var(parsing::tokens::Text name, size_t index);
-        static Node make_number(parsing::tokens::Text name, double value);
-        static Node make_var(parsing::tokens::Text name);
-
         bool is_func() const;
         bool is_input_var() const;
         bool is_number() const;
@@ -106,7 +97,6 @@ namespace zc {
         Number& number_data();
 
         tokens::Text args_token() const;
-        size_t args_num() const;
 
         bool operator == (const Node&) const = default;
       };
@@ -114,7 +104,24 @@ namespace zc {
     } // namespace ast
 
     /// @brief Unbound AST : a generic tree that only keeps string names of objects
-    using AST = ast::Node;
+    /// @note  arguments to operators and functions are the subnodes of their node
+    struct AST: FlatTree<ast::Node>
+    {
+      using Func = ast::Node::Func;
+      using InputVariable = ast::Node::InputVariable;
+      using Number = ast::Node::Number;
+      using Variable = ast::Node::Variable;
+
+      using FlatTree::FlatTree;
+
+      static AST make_func(Func::Type type,
+                           parsing::tokens::Text name,
+                           parsing::tokens::Text full_expr,
+                           std::vector<AST> subnodes);
+      static AST make_input_var(parsing::tokens::Text name, size_t index);
+      static AST make_number(parsing::tokens::Text name, double value);
+      static AST make_var(parsing::tokens::Text name);
+    };
 
   } // namespace parsing
 } // namespace zc
@@ -0,0 +1,100 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <cstdint>
+#include <vector>
+
+#include <zecalculator/math_objects/decl/cpp_function.h>
+#include <zecalculator/parsing/data_structures/decl/shared.h>
+
+namespace zc {
+namespace parsing {
+
+  namespace bytecode {
+
+    /// @brief operation performed by an instruction
+    /// @note 'r' refers to the registers of the frame the program is evaluated in
+    enum struct OpCode: uint32_t
+    {
+      ADD,          ///< r[dst] = r[a] + r[b]
+      SUBTRACT,     ///< r[dst] = r[a] - r[b]
+      MULTIPLY,     ///< r[dst] = r[a] * r[b]
+      DIVIDE,       ///< r[dst] = r[a] / r[b]
+      POWER,        ///< r[dst] = r[a] ^ r[b]
+      NEGATE,       ///< r[dst] = - r[a]
+      MOVE,         ///< r[dst] = r[a]
+      CALL_CPP_1,   ///< r[dst] = cpp_functions_1[b](r[a])
+      CALL_CPP_2,   ///< r[dst] = cpp_functions_2[b](r[a], r[a+1])
+      CALL_FUNC,    ///< r[dst] = functions[b](r[a], ..., r[a + args_num - 1])
+      CALL_SEQ,     ///< r[dst] = sequences[b](r[a])
+      CALL_DATA,    ///< r[dst] = data[b](r[a])
+    };
+
+    /// @brief fixed width instruction, operands being register indices
+    ///        or indices in one of the callee pools of the program
+    struct Instruction
+    {
+      OpCode op;
+      uint32_t dst;
+      uint32_t a;
+      uint32_t b = 0;
+
+      bool operator == (const Instruction&) const = default;
+    };
+
+  } // namespace bytecode
+
+  /// @brief register based program
+  /// @note the registers of the frame the program is evaluated in are laid out as
+  ///       [ input variables | constants | global constants | temporaries ]
+  ///       so operands can refer to any of them without copying them first
+  struct Bytecode
+  {
+    std::vector<bytecode::Instruction> instructions = {};
+
+    /// @brief number of input variables the program reads, i.e. max input variable index + 1
+    uint32_t input_vars_num = 0;
+
+    /// @brief constant pool: values of the numbers found in the expression
+    std::vector<double> constants = {};
+
+    /// @brief global constants the program reads, their values are loaded when the evaluation starts
+    std::vector<const double*> global_constants = {};
+
+    /// @brief callee pools, referred to by the call instructions
+    std::vector<CppFunction<1>> cpp_functions_1 = {};
+    std::vector<CppFunction<2>> cpp_functions_2 = {};
+    std::vector<const LinkedFunc<Type::BYTECODE>*> functions = {};
+    std::vector<const LinkedSeq<Type::BYTECODE>*> sequences = {};
+    std::vector<const LinkedData<Type::BYTECODE>*> data = {};
+
+    /// @brief total number of registers needed to evaluate the program
+    uint32_t registers_num = 0;
+
+    /// @brief register that holds the result once every instruction has been executed
+    uint32_t result = 0;
+
+    bool operator == (const Bytecode&) const = default;
+  };
+
+} // namespace parsing
+} // namespace zc
@@ -20,6 +20,7 @@
 **
 ****************************************************************************/
 
+#include <zecalculator/parsing/data_structures/decl/flat_tree.h>
 #include <zecalculator/parsing/data_structures/decl/shared.h>
 #include <zecalculator/math_objects/forward_declares.h>
 #include <zecalculator/parsing/types.h>
@@ -32,13 +33,16 @@ namespace parsing {
   /// @brief A tree representation in an AST or RPN world
   /// @note when the math world is RPN based, this AST is simply an intermediate form
   ///       before being transformed into an RPN representation
+  /// @note operands and arguments are the subnodes of their node
   template <parsing::Type world_type>
-  struct FAST
+  struct FAST: FlatTree<shared::Node<world_type>>
   {
-    shared::Node<world_type> node;
-    std::vector<FAST> subnodes = {};
+    using FlatTree<shared::Node<world_type>>::FlatTree;
 
-    bool operator == (const FAST&) const;
+    FAST() = default;
+
+    /// @brief tree with 'node' at its root, and copies of 'subnodes' below it
+    FAST(shared::Node<world_type> node, const std::vector<FAST>& subnodes);
   };
 
   } // namespace parsing
@@ -0,0 +1,135 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace zc {
+namespace parsing {
+
+  /// @brief tree whose nodes are stored in a single contiguous pool, where the subnodes
+  ///        of each node are consecutive and referred to by their index range
+  /// @note  the pool is an arena owned by the tree: nodes only ever get appended to it,
+  ///        the ones a rewrite unlinks stay there until the tree is destroyed
+  /// @note  the root is kept out of the pool, so single node trees do not allocate
+  /// @note  subtrees can be shared by several nodes: rewrites replace a node with
+  ///        an equivalent one, they never change the subnodes of a node in place
+  template <class NodeData>
+  struct FlatTree
+  {
+    /// @brief node of the tree, whose subnodes are in the pool
+    /// @note  entries are also handles on subtrees being built: they are copied
+    ///        to the pool as the subnodes of another node, or as the root
+    struct Entry
+    {
+      NodeData data = {};
+
+      /// @brief index, in the pool, of the first subnode, and number of subnodes
+      uint32_t first_subnode = 0, subnodes_num = 0;
+    };
+
+    /// @brief read only view on a node and on the subtree below it
+    /// @note  invalidated when the pool grows
+    struct Ref
+    {
+      const Entry* entry;
+      const Entry* pool;
+
+      const NodeData& node() const;
+      const NodeData* operator -> () const;
+
+      /// @brief random access range of the subnodes, as Ref instances
+      auto subnodes() const
+      {
+        return std::span(pool + entry->first_subnode, entry->subnodes_num)
+               | std::views::transform([pool = pool](const Entry& subnode) { return Ref{&subnode, pool}; });
+      }
+
+      /// @brief compares the subtrees, whatever their layout in their pools
+      bool operator == (const Ref& other) const;
+    };
+
+    /// @brief index that designates the root, see at()
+    static constexpr uint32_t root_index = std::numeric_limits<uint32_t>::max();
+
+    Entry root = {};
+    std::vector<Entry> pool = {};
+
+    FlatTree() = default;
+
+    FlatTree(NodeData data);
+
+    /// @brief tree with 'data' at its root, and copies of 'subnodes' below it
+    template <std::derived_from<FlatTree> Tree>
+    FlatTree(NodeData data, const std::vector<Tree>& subnodes);
+
+    /// @brief copy of the subtree of 'other' below 'node', without the nodes it does not reach
+    FlatTree(const FlatTree& other, const Entry& node);
+
+    FlatTree(const FlatTree&) = default;
+    FlatTree(FlatTree&&) = default;
+    FlatTree& operator = (const FlatTree&) = default;
+    FlatTree& operator = (FlatTree&&) = default;
+
+    /// @brief node at 'index' in the pool, or the root when 'index' is root_index
+    Entry& at(uint32_t index);
+    const Entry& at(uint32_t index) const;
+
+    /// @brief view on 'node', that is either in the pool or has its subnodes there
+    Ref ref(const Entry& node) const;
+    Ref ref() const;
+    operator Ref () const;
+
+    const NodeData& node() const;
+    NodeData& node();
+
+    const NodeData* operator -> () const;
+    NodeData* operator -> ();
+
+    auto subnodes() const { return ref().subnodes(); }
+
+    /// @brief appends copies of 'subnodes' to the pool, as consecutive nodes,
+    ///        and returns a node that holds 'data' and has them as subnodes
+    /// @note  'subnodes' must not view the pool itself, they are copied as the pool grows
+    Entry make_node(NodeData data, std::span<const Entry> subnodes = {});
+    Entry make_node(NodeData data, std::initializer_list<Entry> subnodes);
+
+    /// @brief appends to the pool a copy of the subtree of 'other' below 'node', returns its root
+    /// @note  'other' can be this tree
+    Entry import(const FlatTree& other, Entry node);
+
+    /// @brief compares the trees, whatever their layout in their pools
+    bool operator == (const FlatTree& other) const;
+
+  private:
+    /// @brief copies from the pool of 'other' the subtree below 'node' in this pool,
+    ///        then updates the index of its subnodes
+    void copy_subnodes(const FlatTree& other, Entry& node);
+  };
+
+} // namespace parsing
+} // namespace zc
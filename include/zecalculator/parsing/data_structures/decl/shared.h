@@ -72,6 +72,61 @@ struct LinkedData;
 
         bool operator == (const InputVariable&) const = default;
       };
+
+      /// @brief pushes a copy of the value of a common subexpression, only in RPN programs
+      /// @note  common subexpressions are computed at the beginning of the program, and their
+      ///        values stay at the bottom of the stack: 'index' is the position in the stack
+      struct LoadLocal {
+        size_t index;
+
+        bool operator == (const LoadLocal&) const = default;
+      };
+
+      /// @brief superinstructions: each one does the work of a frequent sequence of nodes,
+      ///        only in RPN programs, see parsing::fuse_nodes()
+
+      /// @brief adds 'value' to the top of the stack, replaces "Number, Add" and "Number, Subtract"
+      struct AddNumber {
+        double value;
+
+        bool operator == (const AddNumber&) const = default;
+      };
+
+      /// @brief multiplies the top of the stack by 'value', replaces "Number, Multiply"
+      struct MultiplyNumber {
+        double value;
+
+        bool operator == (const MultiplyNumber&) const = default;
+      };
+
+      /// @brief adds the global constant to the top of the stack, replaces "const double*, Add"
+      struct AddGlobalConstant {
+        const double* constant;
+
+        bool operator == (const AddGlobalConstant&) const = default;
+      };
+
+      /// @brief multiplies the top of the stack by the global constant, replaces "const double*, Multiply"
+      struct MultiplyGlobalConstant {
+        const double* constant;
+
+        bool operator == (const MultiplyGlobalConstant&) const = default;
+      };
+
+      /// @brief pushes the input variable 'index' multiplied by 'factor',
+      ///        replaces "InputVariable, Number, Multiply" and "Number, InputVariable, Multiply"
+      struct ScaledInput {
+        size_t index;
+        double factor;
+
+        bool operator == (const ScaledInput&) const = default;
+      };
+
+      /// @brief pops 'c', 'a' and 'b' then pushes std::fma(a, b, c), replaces "Multiply, Add"
+      /// @note  rounds only once, unlike the nodes it replaces
+      struct MultiplyAdd {
+        bool operator == (const MultiplyAdd&) const = default;
+      };
     } // namespace node
 
     template <parsing::Type world_type>
@@ -88,7 +143,28 @@ struct LinkedData;
                               const double *,
                               const LinkedFunc<world_type> *,
                               const LinkedSeq<world_type> *,
-                              const LinkedData<world_type> *>;
+                              const LinkedData<world_type> *,
+                              node::LoadLocal,
+                              node::AddNumber,
+                              node::MultiplyNumber,
+                              node::AddGlobalConstant,
+                              node::MultiplyGlobalConstant,
+                              node::ScaledInput,
+                              node::MultiplyAdd>;
+
+    /// @brief superinstruction nodes, see parsing::fuse_nodes()
+    template <class T>
+    concept is_superinstruction = utils::is_any_of<T,
+                                                   node::AddNumber,
+                                                   node::MultiplyNumber,
+                                                   node::AddGlobalConstant,
+                                                   node::MultiplyGlobalConstant,
+                                                   node::ScaledInput,
+                                                   node::MultiplyAdd>;
+
+    /// @brief nodes that only RPN programs contain
+    template <class T>
+    concept is_rpn_only = std::is_same_v<T, node::LoadLocal> or is_superinstruction<T>;
 
   } // namespace shared
 
@@ -20,8 +20,10 @@
 
 #pragma once
 
+#include <zecalculator/evaluation/decl/jit.h>
 #include <zecalculator/parsing/types.h>
 #include <zecalculator/utils/utils.h>
+#include <zecalculator/parsing/data_structures/decl/bytecode.h>
 #include <zecalculator/parsing/data_structures/decl/fast.h>
 #include <zecalculator/parsing/data_structures/decl/rpn.h>
 
@@ -29,12 +31,27 @@ namespace zc {
 namespace parsing {
 
 template <parsing::Type type>
-using Parsing = std::conditional_t<type == parsing::Type::FAST, FAST<parsing::Type::FAST>, RPN>;
+using Parsing = std::conditional_t<type == parsing::Type::FAST,
+                                   FAST<parsing::Type::FAST>,
+                                   std::conditional_t<type == parsing::Type::RPN, RPN, Bytecode>>;
 
 template <parsing::Type type>
 struct LinkedFunc {
   Parsing<type> repr;
   size_t args_num;
+
+  /// @brief max stack depth of 'repr', only used by the RPN representation
+  size_t stack_depth = 0;
+
+  /// @brief native code compiled from 'repr', only used by the RPN representation
+  /// @note  empty when 'repr' is not compiled: it is then evaluated as RPN
+  eval::jit::Function jit = {};
+
+  /// @brief true when calling the function more than once, or not at all, is harmless: it does not call
+  ///        sequences, data or user defined C++ functions, not even through other functions, and is not
+  ///        recursive, as it could overflow the recursion depth
+  /// @note  computed from the equations of the world, see DynMathObject::update_purity()
+  bool pure = false;
 };
 
 template <parsing::Type type>
@@ -43,6 +60,13 @@ struct LinkedSeq
   std::vector<Parsing<type>> repr;
   size_t slot;
   size_t object_revision;
+
+  /// @brief max stack depth over the elements of 'repr', only used by the RPN representation
+  size_t stack_depth = 0;
+
+  /// @brief true when the sequence calls itself, its terms then get evaluated bottom-up when top-down
+  ///        evaluation gets too deep, see zc::evaluate()
+  bool recursive = false;
 };
 
 template <parsing::Type type>
@@ -51,6 +75,9 @@ struct LinkedData
   std::vector<std::expected<Parsing<type>, zc::Error>> repr;
   size_t slot;
   size_t object_revision;
+
+  /// @brief max stack depth over the elements of 'repr', only used by the RPN representation
+  size_t stack_depth = 0;
 };
 
 } // namespace parsing
@@ -23,6 +23,7 @@
 #include <utility>
 #include <variant>
 #include <zecalculator/parsing/data_structures/decl/ast.h>
+#include <zecalculator/parsing/data_structures/impl/flat_tree.h>
 #include <zecalculator/parsing/data_structures/impl/shared.h>
 #include <zecalculator/parsing/data_structures/token.h>
 
@@ -63,51 +64,17 @@ namespace zc {
         return const_cast<Number&>(std::as_const(*this).number_data());
       }
 
-      inline Node Node::make_func(Node::Func::Type type,
-                              parsing::tokens::Text name,
-                              parsing::tokens::Text full_expr,
-                              std::vector<Node> subnodes)
-      {
-        return Node{.name = std::move(name),
-                    .dyn_data = Func{.type = type,
-                                     .full_expr = std::move(full_expr),
-                                     .subnodes = std::move(subnodes)}};
-      }
-
-      inline Node Node::make_input_var(parsing::tokens::Text name, size_t index)
-      {
-        return Node{.name = name, .dyn_data = InputVariable{index}};
-      }
-
-      inline Node Node::make_number(parsing::tokens::Text name, double value)
-      {
-        return Node{.name = name, .dyn_data = Number{value}};
-      }
-
-      inline Node Node::make_var(parsing::tokens::Text name)
-      {
-        return Node{.name = name};
-      }
-
       inline tokens::Text Node::args_token() const
       {
         assert(std::holds_alternative<Func>(dyn_data) and func_data().type == Func::FUNCTION);
 
         tokens::Text args_token;
         // remove the function name and the opening parenthesis and the last parenthesis
-        args_token.begin = func_data().full_expr.begin + name.substr.size() + 1;
-        args_token.substr = func_data().full_expr.substr.substr(name.substr.size() + 1,
-                                                                func_data().full_expr.substr.size() - name.substr.size() - 2);
+        args_token.begin = func_data().full_expr.begin + name.size + 1;
+        args_token.size = func_data().full_expr.size - name.size - 2;
         return args_token;
       }
 
-      inline size_t Node::args_num() const
-      {
-        if (is_func())
-          return func_data().subnodes.size();
-        else return 0;
-      }
-
       inline bool Node::is_func() const
       {
         return std::holds_alternative<Func>(dyn_data);
@@ -129,5 +96,31 @@ namespace zc {
       }
 
     } // namespace ast
+
+    inline AST AST::make_func(Func::Type type,
+                              parsing::tokens::Text name,
+                              parsing::tokens::Text full_expr,
+                              std::vector<AST> subnodes)
+    {
+      return AST(ast::Node{.name = std::move(name),
+                           .dyn_data = Func{.type = type, .full_expr = std::move(full_expr)}},
+                 subnodes);
+    }
+
+    inline AST AST::make_input_var(parsing::tokens::Text name, size_t index)
+    {
+      return AST(ast::Node{.name = name, .dyn_data = InputVariable{index}});
+    }
+
+    inline AST AST::make_number(parsing::tokens::Text name, double value)
+    {
+      return AST(ast::Node{.name = name, .dyn_data = Number{value}});
+    }
+
+    inline AST AST::make_var(parsing::tokens::Text name)
+    {
+      return AST(ast::Node{.name = name});
+    }
+
   } // namespace parsing
 } // namespace zc
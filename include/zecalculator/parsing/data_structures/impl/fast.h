@@ -22,6 +22,7 @@
 
 #include <zecalculator/math_objects/cpp_function.h>
 #include <zecalculator/parsing/data_structures/decl/fast.h>
+#include <zecalculator/parsing/data_structures/impl/flat_tree.h>
 #include <zecalculator/parsing/data_structures/impl/shared.h>
 #include <zecalculator/parsing/data_structures/token.h>
 
@@ -29,10 +30,9 @@ namespace zc {
   namespace parsing {
 
     template <parsing::Type type>
-    bool FAST<type>::operator == (const FAST& other) const
-    {
-      return node == other.node && subnodes == other.subnodes;
-    }
+    FAST<type>::FAST(shared::Node<type> node, const std::vector<FAST>& subnodes)
+      : FlatTree<shared::Node<type>>(std::move(node), subnodes)
+    {}
 
   } // namespace parsing
 } // namespace zc
@@ -0,0 +1,180 @@
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <zecalculator/parsing/data_structures/decl/flat_tree.h>
+
+namespace zc {
+  namespace parsing {
+
+    template <class NodeData>
+    const NodeData& FlatTree<NodeData>::Ref::node() const
+    {
+      return entry->data;
+    }
+
+    template <class NodeData>
+    const NodeData* FlatTree<NodeData>::Ref::operator -> () const
+    {
+      return &entry->data;
+    }
+
+    template <class NodeData>
+    bool FlatTree<NodeData>::Ref::operator == (const Ref& other) const
+    {
+      return node() == other.node() and entry->subnodes_num == other.entry->subnodes_num
+             and std::ranges::equal(subnodes(), other.subnodes());
+    }
+
+    template <class NodeData>
+    FlatTree<NodeData>::FlatTree(NodeData data)
+      : root{.data = std::move(data)}
+    {}
+
+    template <class NodeData>
+    template <std::derived_from<FlatTree<NodeData>> Tree>
+    FlatTree<NodeData>::FlatTree(NodeData data, const std::vector<Tree>& subnodes)
+    {
+      std::vector<Entry> entries;
+      entries.reserve(subnodes.size());
+      for (const Tree& subnode: subnodes)
+        entries.push_back(import(subnode, subnode.root));
+
+      root = make_node(std::move(data), entries);
+    }
+
+    template <class NodeData>
+    FlatTree<NodeData>::FlatTree(const FlatTree& other, const Entry& node)
+    {
+      root = import(other, node);
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Entry& FlatTree<NodeData>::at(uint32_t index)
+    {
+      assert(index == root_index or index < pool.size());
+      return index == root_index ? root : pool[index];
+    }
+
+    template <class NodeData>
+    const typename FlatTree<NodeData>::Entry& FlatTree<NodeData>::at(uint32_t index) const
+    {
+      assert(index == root_index or index < pool.size());
+      return index == root_index ? root : pool[index];
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Ref FlatTree<NodeData>::ref(const Entry& node) const
+    {
+      return Ref{&node, pool.data()};
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Ref FlatTree<NodeData>::ref() const
+    {
+      return ref(root);
+    }
+
+    template <class NodeData>
+    FlatTree<NodeData>::operator Ref () const
+    {
+      return ref();
+    }
+
+    template <class NodeData>
+    const NodeData& FlatTree<NodeData>::node() const
+    {
+      return root.data;
+    }
+
+    template <class NodeData>
+    NodeData& FlatTree<NodeData>::node()
+    {
+      return root.data;
+    }
+
+    template <class NodeData>
+    const NodeData* FlatTree<NodeData>::operator -> () const
+    {
+      return &root.data;
+    }
+
+    template <class NodeData>
+    NodeData* FlatTree<NodeData>::operator -> ()
+    {
+      return &root.data;
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Entry FlatTree<NodeData>::make_node(NodeData data,
+                                                                     std::span<const Entry> subnodes)
+    {
+      const uint32_t first_subnode = uint32_t(pool.size());
+      pool.insert(pool.end(), subnodes.begin(), subnodes.end());
+      return Entry{.data = std::move(data),
+                   .first_subnode = first_subnode,
+                   .subnodes_num = uint32_t(subnodes.size())};
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Entry FlatTree<NodeData>::make_node(NodeData data,
+                                                                     std::initializer_list<Entry> subnodes)
+    {
+      return make_node(std::move(data), std::span<const Entry>(subnodes.begin(), subnodes.size()));
+    }
+
+    template <class NodeData>
+    typename FlatTree<NodeData>::Entry FlatTree<NodeData>::import(const FlatTree& other, Entry node)
+    {
+      copy_subnodes(other, node);
+      return node;
+    }
+
+    template <class NodeData>
+    void FlatTree<NodeData>::copy_subnodes(const FlatTree& other, Entry& node)
+    {
+      const uint32_t first_subnode = uint32_t(pool.size());
+
+      // copied one by one, as 'other' can be this tree
+      for (uint32_t i = 0; i != node.subnodes_num; i++)
+        pool.push_back(Entry(other.pool[node.first_subnode + i]));
+
+      node.first_subnode = first_subnode;
+
+      // the subnodes of the copies still index the pool of 'other'
+      for (uint32_t i = 0; i != node.subnodes_num; i++)
+      {
+        Entry subnode = pool[first_subnode + i];
+        copy_subnodes(other, subnode);
+        pool[first_subnode + i] = std::move(subnode);
+      }
+    }
+
+    template <class NodeData>
+    bool FlatTree<NodeData>::operator == (const FlatTree& other) const
+    {
+      return ref() == other.ref();
+    }
+
+  } // namespace parsing
+} // namespace zc
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <optional>
@@ -38,22 +39,57 @@ namespace parsing {
 
 namespace tokens {
 
+/// @brief piece of text of an expression, given by its position in it
+/// @note  does not hold the text: it is read from the expression it comes from with in()
 struct Text
 {
+  constexpr Text() = default;
+
+  constexpr Text(size_t begin, size_t size): begin(begin), size(size) {}
+
+  /// @brief text of 'substr', that starts at 'begin' in its expression
+  constexpr Text(std::string_view substr, size_t begin): begin(begin), size(substr.size()) {}
 
   static Text from_views(std::string_view substr, std::string_view full_str)
   {
-    return Text{.substr = std::string(substr), .begin = utils::begin_index(substr, full_str)};
+    return Text(utils::begin_index(substr, full_str), substr.size());
   };
 
-  /// @brief name of the token, can different from what appears in the expressions
-  /// @example '+' is replaced with 'internal::plus' (a valid function name)
+  /// @brief the text, read from 'expression'
+  /// @note  'expression' is the string the text comes from, or any string that holds the same
+  ///        characters at the same position, e.g. a copy of it
+  std::string_view in(std::string_view expression) const
+  {
+    assert(begin + size <= expression.size());
+    return expression.substr(begin, size);
+  }
+
+  ///@brief begin position of the text in the original string
+  size_t begin = 0;
+
+  ///@brief number of characters of the text
+  size_t size = 0;
+
+  bool operator == (const Text& other) const = default;
+};
+
+/// @brief copy of a piece of text of an expression, for when it needs to outlive its expression
+/// @example the token an Error is about
+struct OwnedText
+{
+  OwnedText() = default;
+
+  OwnedText(std::string substr, size_t begin): substr(std::move(substr)), begin(begin) {}
+
+  /// @brief copy of 'text', read from the 'expression' it comes from
+  OwnedText(const Text& text, std::string_view expression): substr(text.in(expression)), begin(text.begin) {}
+
   std::string substr = {};
 
   ///@brief begin position of 'substr' in the original string
   size_t begin = 0;
 
-  bool operator == (const Text& other) const = default;
+  bool operator == (const OwnedText& other) const = default;
 };
 
 enum Type: size_t
@@ -163,26 +199,26 @@ struct Token: tokens::Text
   {}
 
   static Token OpeningParenthesis(std::string_view name, size_t start) {
-    return Token(tokens::OPENING_PARENTHESIS, Text{std::string(name), start});
+    return Token(tokens::OPENING_PARENTHESIS, Text{name, start});
   }
 
   static Token Function(std::string_view name, size_t start) {
-    return Token(tokens::FUNCTION, Text{std::string(name), start});
+    return Token(tokens::FUNCTION, Text{name, start});
   }
 
   static Token FunctionCallStart(std::string_view name, size_t start) {
-    return Token(tokens::FUNCTION_CALL_START, Text{std::string(name), start});
+    return Token(tokens::FUNCTION_CALL_START, Text{name, start});
   }
 
   static Token Variable(std::string_view name, size_t start) {
-    return Token(tokens::VARIABLE, Text{std::string(name), start});
+    return Token(tokens::VARIABLE, Text{name, start});
   }
   static Token FunctionCallEnd(std::string_view name, size_t start) {
-    return Token(tokens::FUNCTION_CALL_END, Text{std::string(name), start});
+    return Token(tokens::FUNCTION_CALL_END, Text{name, start});
   }
 
   static Token Number(double value, std::string_view name, size_t start) {
-    return Token(value, Text{std::string(name), start});
+    return Token(value, Text{name, start});
   }
 
   static Token Number(double value, tokens::Text token) {
@@ -190,43 +226,43 @@ struct Token: tokens::Text
   }
 
   static Token Separator(std::string_view name, size_t start) {
-    return Token(tokens::SEPARATOR, Text{std::string(name), start});
+    return Token(tokens::SEPARATOR, Text{name, start});
   }
 
   static Token ClosingParenthesis(std::string_view name, size_t start) {
-    return Token(tokens::CLOSING_PARENTHESIS, Text{std::string(name), start});
+    return Token(tokens::CLOSING_PARENTHESIS, Text{name, start});
   }
 
   static Token Assign(std::string_view name, size_t start) {
-    return Token(tokens::OP_ASSIGN, Text{std::string(name), start});
+    return Token(tokens::OP_ASSIGN, Text{name, start});
   }
 
   static Token Add(std::string_view name, size_t start) {
-    return Token(tokens::OP_ADD, Text{std::string(name), start});
+    return Token(tokens::OP_ADD, Text{name, start});
   }
 
   static Token Subtract(std::string_view name, size_t start) {
-    return Token(tokens::OP_SUBTRACT, Text{std::string(name), start});
+    return Token(tokens::OP_SUBTRACT, Text{name, start});
   }
 
   static Token Multiply(std::string_view name, size_t start) {
-    return Token(tokens::OP_MULTIPLY, Text{std::string(name), start});
+    return Token(tokens::OP_MULTIPLY, Text{name, start});
   }
 
   static Token Divide(std::string_view name, size_t start) {
-    return Token(tokens::OP_DIVIDE, Text{std::string(name), start});
+    return Token(tokens::OP_DIVIDE, Text{name, start});
   }
 
   static Token UnaryMinus(std::string_view name, size_t start) {
-    return Token(tokens::OP_UNARY_MINUS, Text{std::string(name), start});
+    return Token(tokens::OP_UNARY_MINUS, Text{name, start});
   }
 
   static Token UnaryPlus(std::string_view name, size_t start) {
-    return Token(tokens::OP_UNARY_MINUS, Text{std::string(name), start});
+    return Token(tokens::OP_UNARY_MINUS, Text{name, start});
   }
 
   static Token Power(std::string_view name, size_t start) {
-    return Token(tokens::OP_POWER, Text{std::string(name), start});
+    return Token(tokens::OP_POWER, Text{name, start});
   }
 
   tokens::Type type = tokens::UNKNOWN;
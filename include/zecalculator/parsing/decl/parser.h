@@ -23,6 +23,7 @@
 #include <zecalculator/error.h>
 #include <zecalculator/mathworld/decl/mathworld.h>
 #include <zecalculator/parsing/data_structures/decl/ast.h>
+#include <zecalculator/parsing/data_structures/decl/bytecode.h>
 #include <zecalculator/parsing/data_structures/decl/fast.h>
 #include <zecalculator/parsing/data_structures/decl/rpn.h>
 #include <zecalculator/parsing/data_structures/decl/utils.h>
@@ -30,6 +31,7 @@
 #include <zecalculator/parsing/data_structures/token.h>
 
 #include <span>
+#include <unordered_map>
 
 /* TODO: update approach as the following:
     - Parse: aka cut each atom in a formula
@@ -37,7 +39,6 @@
     - Treat number in a special as to make 1.2E+33 as one atom
     - Check for validity
     - Enable setting custom names for functions and variables
-    - Performance improvement: flatten trees
 */
 
 namespace zc {
@@ -77,19 +78,23 @@ template <std::ranges::viewable_range Range>
   requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
 struct mark_input_vars
 {
+  /// @brief expression the texts of the trees come from
+  std::string_view expression;
   const Range& input_vars;
 
-  /// @brief returns a copy of 'tre' where 'ast::node::Variable' instances are replaced
+  /// @brief returns 'tree' where 'ast::node::Variable' instances are replaced
   ///         with ast::node::InputVariable when name is in 'input_vars'
-  AST operator () (const AST& tree);
+  /// @note  'tree' is rewritten in place: passing it as an rvalue avoids any copy
+  AST operator () (AST tree);
 };
 
 /// @brief transform nested two-argument separator nodes into a single separator nodes with many subnodes
-AST flatten_separators(const AST& tree);
+/// @note  'tree' is rewritten in place: passing it as an rvalue avoids any copy
+AST flatten_separators(AST tree);
 
 // user deduction guide for clang-16 that is stupid
 template <class T>
-mark_input_vars(T) -> mark_input_vars<T>;
+mark_input_vars(std::string_view, T) -> mark_input_vars<T>;
 
 /// @brief functor that transforms an AST to an FAST<type> by doing object name lookup within
 ///        a MathWorld instance and binding to objects with references
@@ -99,11 +104,118 @@ struct make_fast
   std::string expression;
   const MathWorld<type>& math_world;
 
+  /// @brief bodies of the functions met so far, by slot, empty when a function cannot be inlined
+  std::unordered_map<size_t, std::optional<FAST<type>>> inlined_bodies = {};
+
   std::expected<FAST<type>, Error> operator () (const AST& ast);
+
+  /// @brief returns the node 'ast' gets bound to, whose subnodes are appended to the pool of 'tree'
+  std::expected<typename FAST<type>::Entry, Error> make_node(FAST<type>& tree, AST::Ref ast);
+
+  /// @brief returns the body of the function 'callee' where its input variables are replaced with 'args',
+  ///        copied in the pool of 'tree' where 'args' are
+  /// @note  returns nothing when the call is kept: inlining is disabled, 'callee' is recursive,
+  ///        an impure argument would be duplicated or dropped, or the result is bigger than max_inlined_size
+  std::optional<typename FAST<type>::Entry> inline_call(const DynMathObject<type>& callee,
+                                                        FAST<type>& tree,
+                                                        std::span<const typename FAST<type>::Entry> args);
+
+  /// @brief says if the function 'callee' ends up calling itself through other functions
+  bool is_recursive(const DynMathObject<type>& callee) const;
+};
+
+/// @brief biggest number of nodes a function call gets replaced with when it is inlined
+inline constexpr size_t max_inlined_size = 64;
+
+/// @brief functor that differentiates, with respect to one of its input variables, an AST
+///        whose input variables are marked, see mark_input_vars
+/// @note  function calls are differentiated with the chain rule: builtin functions have their
+///        derivatives written with other builtin functions, and the bodies of the functions
+///        defined in 'math_world' get differentiated in turn
+/// @note  only trivial terms are simplified, e.g. "0*x" or "1*x": folding constants and the other
+///        simplifications are left to the optimization passes applied when linking
+/// @note  the texts of the derivative are read from 'source': the nodes that do not come from
+///        'expression', e.g. the derivatives of builtin functions, get their text appended to it
+template <Type type>
+struct differentiate
+{
+  std::string expression;
+  const MathWorld<type>& math_world;
+
+  /// @brief names of the functions whose bodies are being differentiated, to detect recursion
+  std::vector<std::string> callers = {};
+
+  /// @brief 'expression', followed by the texts of the nodes imported in the last derivative
+  std::string source = {};
+
+  std::expected<AST, Error> operator () (const AST& tree, size_t var_index);
+
+  /// @brief returns the derivative of 'node', built in the pool of 'tree' that has its subnodes
+  std::expected<AST::Entry, Error> derive(AST& tree, AST::Entry node, size_t var_index);
+
+  /// @brief makes the texts of 'tree', that come from 'text', read from 'source' instead
+  void import(AST& tree, std::string_view text);
 };
 
+/// @brief writes 'tree', whose texts come from 'expression', back as an expression that parses into the same tree
+/// @note  only the parentheses needed by the operators' priorities are written
+/// @note  infinities and NaNs are written as "(1/0)", "(-1/0)" and "(0/0)"
+std::string to_expression(const AST& tree, std::string_view expression);
+
+/// @brief folds every subtree made only of numbers, operators and builtin functions into a single number
+/// @note  folded values are computed the same way evaluation does, so results do not change
+template <Type type>
+FAST<type> fold_constants(FAST<type> tree);
+
+/// @brief rewrites 'tree' with cheaper but equivalent operations
+/// @note  removes exact identities: x*1, x/1, x-0, --x, x/c into x*(1/c) when c is a power of two
+/// @note  power operators with a constant positive integer exponent, up to max_reduced_exponent,
+///        become multiplications: results may differ from std::pow in the last bits. Zeros and
+///        infinities, signed or not, give the same results as std::pow
+template <Type type>
+FAST<type> simplify(FAST<type> tree);
+
+/// @brief biggest constant exponent that simplify() turns into multiplications
+inline constexpr double max_reduced_exponent = 8;
+
 /// @brief transforms a syntax tree to a flat Reverse Polish / postfix notation representation
 RPN make_RPN(const FAST<Type::RPN>& tree);
 
+/// @brief compiles a sequence of tokens straight into a linked RPN program, with the shunting-yard
+///        algorithm: no tree gets built in between, and no optimization is done
+/// @note  the program gives the results of the usual pipeline with the settings of 'math_world', without
+///        its passes: powers of a single node get the multiplications of simplify(), and the powers that
+///        would change otherwise, e.g. with a constant exponent that is not a number, are not handled
+/// @note  meant for expressions that are evaluated once, returns nothing on anything it does not
+///        handle: invalid expressions, separators outside of function calls, assignments.
+///        The usual pipeline then tells what the error is
+struct compile_rpn
+{
+  std::string_view expression;
+  const MathWorld<Type::RPN>& math_world;
+
+  /// @brief names of the input variables, in order
+  std::span<const std::string> input_vars = {};
+
+  std::optional<RPN> operator () (std::span<const Token> tokens) const;
+};
+
+/// @brief replaces frequent sequences of nodes of 'rpn' with superinstructions that do the same work in one node
+/// @param fma: also replace "Multiply, Add" with MultiplyAdd, that rounds only once:
+///             results may then differ in the last bits
+/// @note  the other superinstructions give the exact same results as the nodes they replace
+RPN fuse_nodes(const RPN& rpn, bool fma = false);
+
+/// @brief replaces the calls to cos, sin, exp and ln in 'rpn' with their approximations
+///        that have vectorized kernels, see zc::approx
+/// @note  results differ from libm's in the last bits
+RPN use_vector_math(RPN rpn);
+
+/// @brief returns the maximum number of values an RPN program holds on its stack during evaluation
+size_t max_stack_depth(const RPN& rpn);
+
+/// @brief transforms a syntax tree to a register based program
+Bytecode make_bytecode(const FAST<Type::BYTECODE>& tree);
+
 } // namespace parsing
 } // namespace zc
@@ -20,6 +20,11 @@
 
 #pragma once
 
+#include <array>
+#include <ranges>
+#include <span>
+#include <string_view>
+
 #include <zecalculator/parsing/decl/parser.h>
 #include <zecalculator/parsing/data_structures/decl/ast.h>
 
@@ -31,11 +36,16 @@ namespace parsing {
 inline bool is_valid_name(std::string_view name);
 
 /// @brief gives the Function and Variable names that intervene in this AST
-inline Deps direct_dependencies(const AST& ast);
+/// @param expression: the expression the texts of 'ast' come from
+/// @param input_vars: names of the input variables of the expression, that are not dependencies
+template <std::ranges::viewable_range Range = std::array<std::string_view, 0>>
+  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
+Deps direct_dependencies(const AST& ast, std::string_view expression, const Range& input_vars = {});
 
 /// @brief represents the left hand side of a mathematical definition through an equation
 /// @example "var" in "var = cos(x)" -> {.name = "var", .input_vars = {}}
 /// @example "f(x,y)" in "f(x,y) = 1+ cos(x)*cos(y)" -> {.name = "f", .input_vars = {"x", "y"}}
+/// @note  its texts are positions in the string it got parsed from
 struct LHS
 {
   tokens::Text name;
@@ -50,17 +60,18 @@ struct LHS
 };
 
 /// @brief changes the begin position of every token within the ast by 'offset'
+/// @note  every node of the pool gets changed, the ones a rewrite unlinked included
 void offset_tokens(AST& ast, int offset);
 
 /// @brief create LHS instance from a string representing the left hand side
-/// @arg lhs: substring where lhs is defined
+/// @arg lhs: substring where lhs is defined, the texts of the result are positions in it
 /// @arg full_expr: full expression where 'lhs' appears, only used for errors
 std::expected<LHS, zc::Error> parse_lhs(std::string_view lhs, std::string_view full_expr);
 
 /// @brief create LHS instance from an already parsed string
 /// @arg lhs: the parsed lhs to use
 /// @arg full_expr: full expression where 'lhs' appears, only used for errors
-std::expected<LHS, zc::Error> parse_lhs(const AST& lhs, std::string_view full_expr);
+std::expected<LHS, zc::Error> parse_lhs(AST::Ref lhs, std::string_view full_expr);
 
 } // namespace parsing
 } // namespace zc
@@ -21,6 +21,7 @@
 ****************************************************************************/
 
 #include <zecalculator/error.h>
+#include <zecalculator/math_objects/approx.h>
 #include <zecalculator/mathworld/impl/mathworld.h>
 #include <zecalculator/parsing/data_structures/decl/ast.h>
 #include <zecalculator/parsing/data_structures/impl/ast.h>
@@ -29,13 +30,17 @@
 #include <zecalculator/parsing/data_structures/impl/shared.h>
 #include <zecalculator/parsing/data_structures/token.h>
 #include <zecalculator/parsing/decl/parser.h>
+#include <zecalculator/parsing/decl/utils.h>
 
 #include <cmath>
 #include <optional>
+#include <bit>
 #include <charconv>
 #include <string_view>
 #include <utility>
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace zc {
 namespace parsing {
@@ -237,51 +242,122 @@ inline std::expected<std::vector<Token>, Error> tokenize(std::string_view expres
   return parsing;
 }
 
-inline std::expected<std::vector<std::span<const Token>::iterator>, Error>
-  get_non_pth_enclosed_tokens(std::span<const Token> tokens, std::string_view expression)
-{
-  std::vector<std::span<const Token>::iterator> non_pth_enclosed_tokens;
+namespace internal {
 
-  enum : bool { FUNCTION_CALL_PTH, NORMAL_PTH};
-  std::stack<bool> last_opened_pth;
+  /// @brief says if evaluating 'node' more than once, or not at all, is harmless, i.e. it is not a call to
+  ///        sequences, data, user defined C++ functions, or to impure functions, see LinkedFunc::pure
+  template <Type type>
+  bool is_pure_node(const shared::Node<type>& node)
+  {
+    return std::visit(
+      utils::overloaded{
+        [](const LinkedSeq<type>*) { return false; },
+        [](const LinkedData<type>*) { return false; },
+        [](const LinkedFunc<type>* f) { return f->pure; },
+        []<size_t args_num>(CppFunction<args_num> f) { return is_builtin(f); },
+        [](const auto&) { return true; },
+      },
+      node);
+  }
 
-  // search for parentheses
-  for (auto tokenIt = tokens.begin() ; tokenIt != tokens.end() ; tokenIt++)
+  /// @brief says if evaluating 'tree' more than once, or not at all, is harmless, see is_pure_node()
+  template <Type type>
+  bool is_pure(typename FAST<type>::Ref tree)
   {
-    if (tokenIt->type == tokens::OPENING_PARENTHESIS)
-    {
-      last_opened_pth.push(NORMAL_PTH);
-    }
-    else if (tokenIt->type == tokens::FUNCTION_CALL_START)
-    {
-      last_opened_pth.push(FUNCTION_CALL_PTH);
-    }
-    else if (tokenIt->type == tokens::FUNCTION_CALL_END)
+    return is_pure_node<type>(tree.node()) and std::ranges::all_of(tree.subnodes(), is_pure<type>);
+  }
+
+  /// @brief returns a node of 'tree' that raises 'base' to the power 'n' with multiplications only
+  /// @note  'base' gets duplicated in the result
+  template <Type type>
+  typename FAST<type>::Entry power_chain(FAST<type>& tree, const typename FAST<type>::Entry& base, unsigned n)
+  {
+    assert(n >= 1);
+    if (n == 1)
+      return base;
+
+    auto half = power_chain(tree, base, n / 2);
+    auto res = tree.make_node(shared::node::Multiply{}, {half, half});
+    if (n % 2 == 1)
+      return tree.make_node(shared::node::Multiply{}, {res, base});
+    else return res;
+  }
+
+  /// @brief appends to 'rpn' the multiplications of power_chain(), for a 'base' that is a leaf
+  inline void power_chain(RPN& rpn, const RPN::value_type& base, unsigned n)
+  {
+    assert(n >= 1);
+    if (n == 1)
     {
-      if (not last_opened_pth.empty() and last_opened_pth.top() == FUNCTION_CALL_PTH)
-        last_opened_pth.pop();
-      else return std::unexpected(Error::unexpected(*tokenIt, std::string(expression)));
+      rpn.push_back(base);
+      return;
     }
-    else if (tokenIt->type == tokens::CLOSING_PARENTHESIS)
+
+    power_chain(rpn, base, n / 2);
+    power_chain(rpn, base, n / 2);
+    rpn.push_back(shared::node::Multiply{});
+    if (n % 2 == 1)
     {
-      if (not last_opened_pth.empty() and last_opened_pth.top() == NORMAL_PTH)
-        last_opened_pth.pop();
-      else return std::unexpected(Error::unexpected(*tokenIt, std::string(expression)));
+      rpn.push_back(base);
+      rpn.push_back(shared::node::Multiply{});
     }
-    // if not a parenthesis, and the token is not enclosed within parentheses, push it
-    else if (last_opened_pth.empty())
-      non_pth_enclosed_tokens.push_back(tokenIt);
   }
 
-  return non_pth_enclosed_tokens;
-}
+  /// @brief says if simplify() turns powers with the constant exponent 'n' into multiplications
+  /// @note  half-integer exponents are left to std::pow, sqrt differs from it for -0 and -inf,
+  ///        and so are negative ones: 1/(x*...*x) gives 0 when x*...*x overflows, not std::pow
+  inline bool is_reduced_exponent(double n)
+  {
+    return n > 0 and n <= max_reduced_exponent and std::trunc(n) == n;
+  }
+
+  /// @brief number of nodes in 'tree'
+  template <Type type>
+  size_t tree_size(typename FAST<type>::Ref tree)
+  {
+    size_t size = 1;
+    for (auto subnode: tree.subnodes())
+      size += tree_size<type>(subnode);
+    return size;
+  }
+
+  /// @brief counts in 'uses' the occurrences of each input variable of 'tree'
+  template <Type type>
+  void count_input_vars(typename FAST<type>::Ref tree, std::vector<size_t>& uses)
+  {
+    if (auto* var = std::get_if<shared::node::InputVariable>(&tree.node()))
+      uses[var->index]++;
+
+    for (auto subnode: tree.subnodes())
+      count_input_vars<type>(subnode, uses);
+  }
+
+  /// @brief copies 'body' in the pool of 'tree', where every input variable is replaced with its value in 'args'
+  /// @note  'args' are nodes of 'tree', they must not view its pool
+  template <Type type>
+  typename FAST<type>::Entry substitute_input_vars(FAST<type>& tree,
+                                                   typename FAST<type>::Ref body,
+                                                   std::span<const typename FAST<type>::Entry> args)
+  {
+    if (auto* var = std::get_if<shared::node::InputVariable>(&body.node()))
+      return args[var->index];
+
+    std::vector<typename FAST<type>::Entry> subnodes;
+    subnodes.reserve(body.subnodes().size());
+    for (auto subnode: body.subnodes())
+      subnodes.push_back(substitute_input_vars<type>(tree, subnode, args));
+
+    return tree.make_node(body.node(), subnodes);
+  }
+
+} // namespace internal
 
 /// @brief functor that maps a MathWorld::ConstDynMathObject to std::expected<fast::fast, Error>
 template <parsing::Type world_type>
 struct VariableVisiter
 {
-  using Ret = std::expected<parsing::FAST<world_type>, Error>;
-  using T = parsing::FAST<world_type>;
+  using T = typename parsing::FAST<world_type>::Entry;
+  using Ret = std::expected<T, Error>;
 
   std::string expression;
   const tokens::Text& var_txt_token;
@@ -309,12 +385,14 @@ struct VariableVisiter
 template <parsing::Type world_type>
 struct FunctionVisiter
 {
-  using Ret = std::expected<FAST<world_type>, Error>;
-  using T = FAST<world_type>;
+  using Ret = std::expected<typename FAST<world_type>::Entry, Error>;
 
   std::string expression;
-  const AST& func;
-  std::vector<FAST<world_type>> subnodes;
+  const ast::Node& func;
+
+  /// @brief tree whose pool gets the subnodes
+  FAST<world_type>& tree;
+  std::vector<typename FAST<world_type>::Entry> subnodes;
 
   template <size_t args_num>
   Ret operator()(CppFunction<args_num> f)
@@ -322,7 +400,7 @@ struct FunctionVisiter
     if (subnodes.size() != args_num) [[unlikely]]
       return std::unexpected(Error::mismatched_fun_args(func.args_token(), expression));
 
-    return T{f, std::move(subnodes)};
+    return tree.make_node(f, subnodes);
   }
   Ret operator()(const zc::DynMathObject<world_type>::FuncObj& f)
   {
@@ -332,7 +410,7 @@ struct FunctionVisiter
     else if (subnodes.size() != f.linked_rhs->args_num) [[unlikely]]
       return std::unexpected(Error::mismatched_fun_args(func.args_token(), expression));
 
-    return T{&(*f.linked_rhs), std::move(subnodes)};
+    return tree.make_node(&(*f.linked_rhs), subnodes);
   }
   Ret operator()(const zc::DynMathObject<world_type>::SeqObj& u)
   {
@@ -342,14 +420,14 @@ struct FunctionVisiter
     else if (not bool(u.linked_rhs))
       return std::unexpected(zc::Error::object_in_invalid_state(func.name, expression));
 
-    return T{&(*u.linked_rhs), std::move(subnodes)};
+    return tree.make_node(&(*u.linked_rhs), subnodes);
   }
   Ret operator()(const zc::DynMathObject<world_type>::DataObj& d)
   {
     if (subnodes.size() != 1) [[unlikely]]
       return std::unexpected(Error::mismatched_fun_args(func.args_token(), expression));
 
-    return T{&d.linked_rhs, std::move(subnodes)};
+    return tree.make_node(&d.linked_rhs, subnodes);
   }
   Ret operator()(auto&&)
   {
@@ -360,15 +438,29 @@ struct FunctionVisiter
 template <Type type>
 std::expected<FAST<type>, Error> make_fast<type>::operator () (const AST& ast)
 {
-  using Ret = std::expected<FAST<type>, Error>;
+  FAST<type> tree;
+  auto exp_root = make_node(tree, ast);
+  if (not exp_root) [[unlikely]]
+    return std::unexpected(std::move(exp_root.error()));
+
+  tree.root = std::move(*exp_root);
+  return tree;
+}
+
+template <Type type>
+std::expected<typename FAST<type>::Entry, Error> make_fast<type>::make_node(FAST<type>& tree, AST::Ref ast)
+{
+  using Entry = typename FAST<type>::Entry;
+  using Ret = std::expected<Entry, Error>;
   return std::visit(
     utils::overloaded{
       [&](const AST::Func& func) -> Ret
       {
-        std::vector<FAST<type>> operands;
-        for (auto&& operand: func.subnodes)
+        std::vector<Entry> operands;
+        operands.reserve(ast.subnodes().size());
+        for (auto operand: ast.subnodes())
         {
-          auto expected_bound_node = (*this)(operand);
+          auto expected_bound_node = make_node(tree, operand);
           if (expected_bound_node) [[likely]]
             operands.push_back(std::move(*expected_bound_node));
           else return std::unexpected(expected_bound_node.error());
@@ -377,44 +469,47 @@ std::expected<FAST<type>, Error> make_fast<type>::operator () (const AST& ast)
         switch (func.type)
         {
           case AST::Func::OP_ASSIGN:
-            return std::unexpected(Error::not_implemented(ast.name, expression));
+            return std::unexpected(Error::not_implemented(ast->name, expression));
 
           case AST::Func::OP_ADD:
-            assert(func.subnodes.size() == 2);
-            return FAST<type>{.node = shared::node::Add{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 2);
+            return tree.make_node(shared::node::Add{}, operands);
 
           case AST::Func::OP_SUBTRACT:
-            assert(func.subnodes.size() == 2);
-            return FAST<type>{.node = shared::node::Subtract{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 2);
+            return tree.make_node(shared::node::Subtract{}, operands);
 
           case AST::Func::OP_MULTIPLY:
-            assert(func.subnodes.size() == 2);
-            return FAST<type>{.node = shared::node::Multiply{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 2);
+            return tree.make_node(shared::node::Multiply{}, operands);
 
           case AST::Func::OP_DIVIDE:
-            assert(func.subnodes.size() == 2);
-            return FAST<type>{.node = shared::node::Divide{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 2);
+            return tree.make_node(shared::node::Divide{}, operands);
 
           case AST::Func::OP_POWER:
-            assert(func.subnodes.size() == 2);
-            return FAST<type>{.node = shared::node::Power{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 2);
+            return tree.make_node(shared::node::Power{}, operands);
 
           case AST::Func::OP_UNARY_MINUS:
-            assert(func.subnodes.size() == 1);
-            return FAST<type>{.node = shared::node::UnaryMinus{}, .subnodes = std::move(operands)};
+            assert(operands.size() == 1);
+            return tree.make_node(shared::node::UnaryMinus{}, operands);
 
           case AST::Func::FUNCTION:
           {
-            auto* dyn_obj = math_world.get(ast.name.substr);
+            auto* dyn_obj = math_world.get(ast->name.in(expression));
             if (not dyn_obj) [[unlikely]]
-              return std::unexpected(Error::undefined_function(ast.name, expression));
+              return std::unexpected(Error::undefined_function(ast->name, expression));
 
             if (not dyn_obj->has_value()) [[unlikely]]
-              return std::unexpected(Error::object_in_invalid_state(ast.name, expression));
-            else return std::visit(FunctionVisiter<type>{expression, ast, std::move(operands)}, dyn_obj->parsed_data);
+              return std::unexpected(Error::object_in_invalid_state(ast->name, expression));
+            else if (auto inlined = inline_call(*dyn_obj, tree, operands))
+              return std::move(*inlined);
+            else return std::visit(FunctionVisiter<type>{expression, ast.node(), tree, std::move(operands)},
+                                   dyn_obj->parsed_data);
           }
           case AST::Func::SEPARATOR:
-            return std::unexpected(Error::unexpected(ast.name, expression));
+            return std::unexpected(Error::unexpected(ast->name, expression));
 
           default:
             [[unlikely]] throw std::runtime_error("Problem in ZeCalculator library");
@@ -422,302 +517,1768 @@ std::expected<FAST<type>, Error> make_fast<type>::operator () (const AST& ast)
       },
       [&](const AST::InputVariable& input_var) -> Ret
       {
-        return FAST<type>{shared::node::InputVariable{input_var.index}};
+        return Entry{shared::node::InputVariable{input_var.index}};
       },
       [&](const AST::Number& number) -> Ret
       {
-        return FAST<type>{shared::node::Number{number.value}};
+        return Entry{shared::node::Number{number.value}};
       },
       [&](AST::Variable) -> Ret
       {
-        auto* dyn_obj = math_world.get(ast.name.substr);
+        auto* dyn_obj = math_world.get(ast->name.in(expression));
         if (not dyn_obj) [[unlikely]]
-          return std::unexpected(Error::undefined_variable(ast.name, expression));
+          return std::unexpected(Error::undefined_variable(ast->name, expression));
         if (not dyn_obj->has_value())
-          return std::unexpected(Error::object_in_invalid_state(ast.name, expression));
-        else return std::visit(VariableVisiter<type>{expression, ast.name}, dyn_obj->parsed_data);
+          return std::unexpected(Error::object_in_invalid_state(ast->name, expression));
+        else if (auto inlined = inline_call(*dyn_obj, tree, {}))
+          return std::move(*inlined);
+        else return std::visit(VariableVisiter<type>{expression, ast->name}, dyn_obj->parsed_data);
       }
     },
-    ast.dyn_data);
+    ast->dyn_data);
 }
 
-template <std::ranges::viewable_range Range>
-  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
-std::expected<AST, Error> make_ast<Range>::operator () (std::span<const parsing::Token> tokens)
+template <Type type>
+std::optional<typename FAST<type>::Entry>
+  make_fast<type>::inline_call(const DynMathObject<type>& callee,
+                               FAST<type>& tree,
+                               std::span<const typename FAST<type>::Entry> args)
 {
-  using Ret = std::expected<AST, Error>;
+  using FuncObj = typename DynMathObject<type>::FuncObj;
+  const FuncObj* f_obj = std::get_if<FuncObj>(&callee.parsed_data);
 
-  if (tokens.empty()) [[unlikely]]
-    return std::unexpected(Error::empty_expression());
+  if (not math_world.get_inlining() or not f_obj or not f_obj->linked_rhs
+      or f_obj->linked_rhs->args_num != args.size())
+    return {};
 
-  auto get_current_sub_expr = [&](){
-    const auto& end_token = tokens.back();
-    size_t start = tokens.front().begin;
-    size_t end = end_token.begin + end_token.substr.size();
+  // each body is built once, then copied at every call site
+  auto it = inlined_bodies.find(callee.slot);
+  if (it == inlined_bodies.end())
+  {
+    std::optional<FAST<type>> body;
+    if (not is_recursive(callee))
+    {
+      // the body is built again from the callee's equation, so it is up to date
+      // even when the callee itself did not get relinked yet
+      const std::vector<std::string> var_names = callee.get_input_var_names();
+      make_fast<type> body_maker{f_obj->rhs_str, math_world, std::move(inlined_bodies)};
+      auto exp_body = body_maker(mark_input_vars{f_obj->rhs_str, var_names}(f_obj->rhs));
+      inlined_bodies = std::move(body_maker.inlined_bodies);
+
+      if (exp_body)
+        body = std::move(*exp_body);
+    }
+    it = inlined_bodies.emplace(callee.slot, std::move(body)).first;
+  }
 
-    return tokens::Text{std::string(expression.substr(start, end - start)), start};
-  };
+  if (not it->second)
+    return {};
+
+  const FAST<type>& body = *it->second;
+
+  std::vector<size_t> uses(args.size(), 0);
+  internal::count_input_vars<type>(body, uses);
+
+  // the size of the result is known before it gets copied in the pool of 'tree'
+  size_t size = internal::tree_size<type>(body);
+  for (size_t i = 0; i != args.size(); i++)
+  {
+    size += uses[i] * (internal::tree_size<type>(tree.ref(args[i])) - 1);
+
+    if (uses[i] == 1)
+      continue;
+
+    // impure arguments must be evaluated exactly once, as in the call: they may give an error,
+    // e.g. a sequence evaluated too deep, or have side effects, e.g. user defined C++ functions.
+    // Leaves can be impure too: calls to functions without arguments that did not get inlined
+    const bool pure = internal::is_pure<type>(tree.ref(args[i]));
+    if (not pure)
+      return {};
+
+    // arguments used more than once get duplicated: only RPN computes the pure ones once,
+    // thanks to common subexpression elimination
+    if (uses[i] > 1 and type != Type::RPN)
+      return {};
+  }
+
+  if (size > max_inlined_size)
+    return {};
+
+  return internal::substitute_input_vars<type>(tree, body, args);
+}
+
+template <Type type>
+bool make_fast<type>::is_recursive(const DynMathObject<type>& callee) const
+{
+  const std::string_view name = callee.get_name();
 
-  tokens::Text current_sub_expr = get_current_sub_expr();
+  std::vector<std::string> names = {std::string(name)};
+  std::unordered_set<std::string> explored;
 
-  // when there's only a single token, it can only be number or a variable
-  if (tokens.size() == 1)
+  // only calls between functions get inlined, sequences and data break the cycles
+  while (not names.empty())
   {
-    const auto& back = tokens.back();
-    switch(tokens.back().type)
+    const DynMathObject<type>* obj = math_world.get(names.back());
+    names.pop_back();
+
+    if (not obj or not obj->holds(zc::FUNCTION))
+      continue;
+
+    for (auto&& [dep_name, dep]: obj->direct_dependencies())
     {
-      case tokens::NUMBER:
-        return AST::make_number(back, back.value);
-        break;
-      case tokens::VARIABLE:
-      {
-        auto it = std::ranges::find(input_vars, back.substr);
-        if (it != input_vars.end())
-        {
-          // the index is computed with the distance between begin() and 'it'
-          return AST::make_input_var(back, std::distance(input_vars.begin(), it));
-        }
-        else return AST::make_var(back);
-        break;
-      }
-      default: [[unlikely]]
-        // cannot be anything else
-        return std::unexpected(Error::unexpected(back, std::string(expression)));
-        break;
+      if (dep_name == name)
+        return true;
+      else if (explored.insert(dep_name).second)
+        names.push_back(dep_name);
     }
   }
 
-  auto expected_non_pth_wrapped_tokens = get_non_pth_enclosed_tokens(tokens, expression);
-  if (not expected_non_pth_wrapped_tokens.has_value())
-    return std::unexpected(expected_non_pth_wrapped_tokens.error());
+  return false;
+}
 
-  const auto& non_pth_enclosed_tokens = expected_non_pth_wrapped_tokens.value();
+namespace internal {
 
-  // expression of the type "(...)"
-  if (non_pth_enclosed_tokens.empty() and tokens.size() > 2 and
-      tokens.front().type == tokens::OPENING_PARENTHESIS and
-      tokens.back().type == tokens::CLOSING_PARENTHESIS)
+  /// @brief says if 'tree' depends on the input variable at 'var_index'
+  inline bool depends_on(AST::Ref tree, size_t var_index)
   {
-    return (*this)(std::span(tokens.begin()+1, tokens.end()-1));
+    if (tree->is_input_var())
+      return tree->input_var_data().index == var_index;
+    else return std::ranges::any_of(tree.subnodes(),
+                                    [&](AST::Ref subnode) { return depends_on(subnode, var_index); });
   }
 
-  // expression of the type "function(...)"
-  else if (non_pth_enclosed_tokens.size() == 1 and tokens.size() > 3
-           and tokens.front().type == tokens::FUNCTION
-           and (tokens.begin() + 1)->type == tokens::FUNCTION_CALL_START
-           and tokens.back().type == tokens::FUNCTION_CALL_END)
+  /// @brief copies 'body' in the pool of 'tree', where every input variable is replaced with its value in 'args'
+  /// @note  'args' are nodes of 'tree', they must not view its pool
+  inline AST::Entry substitute_input_vars(AST& tree, AST::Ref body, std::span<const AST::Entry> args)
   {
-    auto subnode = (*this)(std::span(tokens.begin()+2, tokens.end()-1));
+    if (body->is_input_var())
+      return args[body->input_var_data().index];
+
+    std::vector<AST::Entry> subnodes;
+    subnodes.reserve(body.subnodes().size());
+    for (AST::Ref subnode: body.subnodes())
+      subnodes.push_back(substitute_input_vars(tree, subnode, args));
 
-    if (bool(subnode))
-      return AST::make_func(AST::Func::FUNCTION,
-                            tokens.front(),
-                            current_sub_expr,
-                            {std::move(*subnode)});
-    else return std::unexpected(std::move(subnode.error()));
+    return tree.make_node(body.node(), subnodes);
   }
 
-  // there are tokens that are not within parentheses
-  else if (not non_pth_enclosed_tokens.empty())
+  inline bool is_number(const AST::Entry& node, double value)
   {
-    // test, from right to left, within tokens that are not enclosed within parentheses
-    // for operators in increasing order of priority. As soon as one is found, we take it
-    std::optional<Ret> res;
-    auto test_operator_priority = [&]<uint8_t priority>(std::integral_constant<uint8_t, priority>)
-    {
-      if (res)
-        return;
-      // we reverse the view, so the actual evaluation of the tree amounts of taking
-      // left to right priority
-      for (const auto& tok: non_pth_enclosed_tokens | std::views::reverse)
-      {
-        if (res)
-          break;
+    return node.data.is_number() and node.data.number_data().value == value;
+  }
 
-        for (const tokens::Operator op: tokens::get_operators<priority>())
-        {
-          if (res)
-            break;
+  inline AST::Entry number(double value)
+  {
+    return AST::Entry{.data = {.name = tokens::Text{}, .dyn_data = AST::Number{value}}};
+  }
 
-          if (tok->type != op.type)
-            continue;
+  /// @brief builders of the operations of a derivative, in the pool of 'tree', that skip the trivial terms
+  inline AST::Entry operation(AST& tree, AST::Func::Type type, std::initializer_list<AST::Entry> subnodes)
+  {
+    return tree.make_node(ast::Node{.name = tokens::Text{}, .dyn_data = AST::Func{.type = type, .full_expr = {}}},
+                          subnodes);
+  }
 
-          auto right_hand_side = (*this)(std::span(tok + 1, tokens.end()));
-          if (not right_hand_side.has_value()) [[unlikely]]
-          {
-            res = std::unexpected(right_hand_side.error());
-            return;
-          }
+  inline bool is_negation(const AST::Entry& node)
+  {
+    return node.data.is_func() and node.data.func_data().type == AST::Func::OP_UNARY_MINUS;
+  }
 
-          if (op.desc == parsing::tokens::Operator::BINARY_INFIX)
-          {
-            // since we are dealing with infix binary operators, they can't be
-            // at either the very beginning or the very end of the token list
-            if (tok == tokens.begin() or tok + 1 == tokens.end()) [[unlikely]]
-            {
-              res = std::unexpected(Error::unexpected(*tok, std::string(expression)));
-              return;
-            }
+  inline AST::Entry negate(AST& tree, AST::Entry a)
+  {
+    if (a.data.is_number())
+      return number(-a.data.number_data().value);
+    else if (is_negation(a))
+      return tree.pool[a.first_subnode];
+    else return operation(tree, AST::Func::OP_UNARY_MINUS, {a});
+  }
 
-            std::vector<AST> subnodes;
-            subnodes.reserve(2);
+  inline AST::Entry subtract(AST& tree, AST::Entry a, AST::Entry b);
 
-            auto left_hand_side = (*this)(std::span(tokens.begin(), tok));
-            if (not left_hand_side.has_value()) [[unlikely]]
-            {
-              res = std::unexpected(left_hand_side.error());
-              return;
-            }
-            else if (op.type != tokens::Type::SEPARATOR and op.type != tokens::Type::OP_ASSIGN
-                     and left_hand_side->is_func()
-                     and left_hand_side->func_data().type == AST::Func::SEPARATOR) [[unlikely]]
-            {
-              // only separators and assignment can have separators as subnodes
-              res = std::unexpected(Error::unexpected(left_hand_side->name, std::string(expression)));
-              return ;
-            }
-            else subnodes.push_back(std::move(*left_hand_side));
+  inline AST::Entry add(AST& tree, AST::Entry a, AST::Entry b)
+  {
+    if (is_number(a, 0))
+      return b;
+    else if (is_number(b, 0))
+      return a;
+    else if (a.data.is_number() and b.data.is_number())
+      return number(a.data.number_data().value + b.data.number_data().value);
+    else if (is_negation(b) or (b.data.is_number() and b.data.number_data().value < 0))
+      return subtract(tree, a, negate(tree, b));
+    else return operation(tree, AST::Func::OP_ADD, {a, b});
+  }
 
-            if (op.type != tokens::Type::SEPARATOR and op.type != tokens::Type::OP_ASSIGN
-                     and right_hand_side->is_func()
-                     and right_hand_side->func_data().type == AST::Func::SEPARATOR) [[unlikely]]
-            {
-              // only separators can have separators as subnodes
-              res = std::unexpected(
-                Error::unexpected(right_hand_side->name, std::string(expression)));
-              return ;
-            }
-            else subnodes.push_back(std::move(right_hand_side.value()));
+  inline AST::Entry subtract(AST& tree, AST::Entry a, AST::Entry b)
+  {
+    if (is_number(a, 0))
+      return negate(tree, b);
+    else if (is_number(b, 0))
+      return a;
+    else if (a.data.is_number() and b.data.is_number())
+      return number(a.data.number_data().value - b.data.number_data().value);
+    else if (is_negation(b) or (b.data.is_number() and b.data.number_data().value < 0))
+      return add(tree, a, negate(tree, b));
+    else return operation(tree, AST::Func::OP_SUBTRACT, {a, b});
+  }
 
-            res = AST::make_func(AST::Func::Type(op.type),
-                                 *tok,
-                                 current_sub_expr,
-                                 std::move(subnodes));
-          }
-          else if (op.desc == parsing::tokens::Operator::UNARY_PREFIX
-                   and tok == non_pth_enclosed_tokens.front())
-          {
-            if (op.type == tokens::Type::OP_UNARY_PLUS)
-              // optimization: just skip entirely unary plus
-              res = std::move(*right_hand_side);
-            else res = AST::make_func(AST::Func::Type(op.type),
-                                 *tok,
-                                 current_sub_expr,
-                                 {std::move(*right_hand_side)});
-          }
-        }
-      }
-    };
-    constexpr_for(test_operator_priority,
-                  std::make_integer_sequence<uint8_t, tokens::max_priority + 1>());
+  inline AST::Entry multiply(AST& tree, AST::Entry a, AST::Entry b)
+  {
+    if (is_number(a, 0) or is_number(b, 0))
+      return number(0);
+    else if (is_number(a, 1))
+      return b;
+    else if (is_number(b, 1))
+      return a;
+    else if (is_number(a, -1))
+      return negate(tree, b);
+    else if (is_number(b, -1))
+      return negate(tree, a);
+    else if (a.data.is_number() and b.data.is_number())
+      return number(a.data.number_data().value * b.data.number_data().value);
+    else if (is_negation(a))
+      return negate(tree, multiply(tree, negate(tree, a), b));
+    else if (is_negation(b))
+      return negate(tree, multiply(tree, a, negate(tree, b)));
+    else return operation(tree, AST::Func::OP_MULTIPLY, {a, b});
+  }
 
-    if (res)
-      return std::move(*res);
+  inline AST::Entry divide(AST& tree, AST::Entry a, AST::Entry b)
+  {
+    if (is_number(a, 0))
+      return number(0);
+    else if (is_number(b, 1))
+      return a;
+    else if (is_negation(a))
+      return negate(tree, divide(tree, negate(tree, a), b));
+    else if (is_negation(b))
+      return negate(tree, divide(tree, a, negate(tree, b)));
+    else return operation(tree, AST::Func::OP_DIVIDE, {a, b});
   }
 
-  return std::unexpected(Error::unexpected(current_sub_expr, std::string(expression)));
-}
+  inline AST::Entry power(AST& tree, AST::Entry a, AST::Entry b)
+  {
+    if (is_number(b, 1))
+      return a;
+    else if (is_number(b, 0))
+      return number(1);
+    else return operation(tree, AST::Func::OP_POWER, {a, b});
+  }
 
-template <std::ranges::viewable_range Range>
-  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
-AST mark_input_vars<Range>::operator () (const AST& tree)
+} // namespace internal
+
+template <Type type>
+std::expected<AST, Error> differentiate<type>::operator () (const AST& tree, size_t var_index)
 {
-  return std::visit(
-    utils::overloaded{
-      [&](const AST::Func& func) -> AST
-      {
-        std::vector<AST> subnodes;
-        for (const AST& subnode: func.subnodes)
-          subnodes.push_back((*this)(subnode));
-
-        return AST::make_func(func.type,
-                              tree.name,
-                              func.full_expr,
-                              std::move(subnodes));
-      },
-      [&](const AST::InputVariable&) -> AST
-      {
-        return tree;
-      },
-      [&](const AST::Number&) -> AST
-      {
-        return tree;
-      },
-      [&](AST::Variable) -> AST
-      {
-        auto it = std::ranges::find(input_vars, tree.name.substr);
-        if (it != input_vars.end())
-          return AST::make_input_var(tree.name, std::distance(input_vars.begin(), it));
-        else return AST::make_var(tree.name);
-      }
-    },
-    tree.dyn_data);
+  source = expression;
+
+  // the derivative gets built in a copy of 'tree', with which it shares the subtrees it keeps
+  AST res = tree;
+  auto exp_root = derive(res, res.root, var_index);
+  if (not exp_root) [[unlikely]]
+    return std::unexpected(std::move(exp_root.error()));
+
+  res.root = std::move(*exp_root);
+  return res;
 }
 
-/// @brief transform nested two-argument separator nodes into a single separator nodes with many subnodes
-inline AST flatten_separators(const AST& tree)
+template <Type type>
+std::expected<AST::Entry, Error> differentiate<type>::derive(AST& tree, AST::Entry node, size_t var_index)
 {
-  return std::visit(
-    utils::overloaded{
-      [&](const AST::Func& func) -> AST
+  using Ret = std::expected<AST::Entry, Error>;
+
+  if (not internal::depends_on(tree.ref(node), var_index))
+    return internal::number(0);
+
+  // only function nodes and the input variable itself depend on it
+  if (node.data.is_input_var())
+    return internal::number(1);
+
+  const AST::Func& func = node.data.func_data();
+
+  // copied, as the pool grows with the derivative
+  const std::vector<AST::Entry> subnodes(tree.pool.begin() + node.first_subnode,
+                                         tree.pool.begin() + node.first_subnode + node.subnodes_num);
+
+  std::vector<AST::Entry> derivatives;
+  for (const AST::Entry& subnode: subnodes)
+  {
+    auto exp_derivative = derive(tree, subnode, var_index);
+    if (not exp_derivative) [[unlikely]]
+      return exp_derivative;
+    derivatives.push_back(std::move(*exp_derivative));
+  }
+
+  switch (func.type)
+  {
+    case AST::Func::OP_ADD:
+      return internal::add(tree, derivatives[0], derivatives[1]);
+
+    case AST::Func::OP_SUBTRACT:
+      return internal::subtract(tree, derivatives[0], derivatives[1]);
+
+    case AST::Func::OP_UNARY_MINUS:
+      return internal::negate(tree, derivatives[0]);
+
+    case AST::Func::OP_MULTIPLY:
+    {
+      const AST::Entry& a = subnodes[0];
+      const AST::Entry& b = subnodes[1];
+      return internal::add(tree,
+                           internal::multiply(tree, derivatives[0], b),
+                           internal::multiply(tree, a, derivatives[1]));
+    }
+
+    case AST::Func::OP_DIVIDE:
+    {
+      const AST::Entry& a = subnodes[0];
+      const AST::Entry& b = subnodes[1];
+      if (not internal::depends_on(tree.ref(b), var_index))
+        return internal::divide(tree, derivatives[0], b);
+
+      return internal::divide(tree,
+                              internal::subtract(tree,
+                                                 internal::multiply(tree, derivatives[0], b),
+                                                 internal::multiply(tree, a, derivatives[1])),
+                              internal::power(tree, b, internal::number(2)));
+    }
+
+    case AST::Func::OP_POWER:
+    {
+      const AST::Entry& a = subnodes[0];
+      const AST::Entry& b = subnodes[1];
+
+      // a^n -> n * a^(n-1) * a'
+      if (not internal::depends_on(tree.ref(b), var_index))
       {
-        std::vector<AST> subnodes;
-        for (const AST& subnode: func.subnodes)
-          subnodes.push_back(flatten_separators(subnode));
+        AST::Entry exponent = b.data.is_number()
+                                ? internal::number(b.data.number_data().value - 1)
+                                : internal::subtract(tree, b, internal::number(1));
+        return internal::multiply(tree,
+                                  internal::multiply(tree, b, internal::power(tree, a, exponent)),
+                                  derivatives[0]);
+      }
 
-        if (func.type == AST::Func::FUNCTION or func.type == AST::Func::SEPARATOR)
-        {
-          std::vector<AST> final_subnodes;
-          final_subnodes.reserve(subnodes.size());
+      const tokens::Text ln_name(source.size(), 2);
+      source += "ln";
+
+      const AST::Entry ln_a = tree.make_node(
+        ast::Node{.name = ln_name, .dyn_data = AST::Func{.type = AST::Func::FUNCTION, .full_expr = {}}},
+        {a});
+
+      // c^b -> c^b * ln(c) * b'
+      if (not internal::depends_on(tree.ref(a), var_index))
+        return internal::multiply(tree, internal::multiply(tree, node, ln_a), derivatives[1]);
+
+      // a^b -> a^b * (b' * ln(a) + b * a' / a)
+      return internal::multiply(
+        tree,
+        node,
+        internal::add(tree,
+                      internal::multiply(tree, derivatives[1], ln_a),
+                      internal::divide(tree, internal::multiply(tree, b, derivatives[0]), a)));
+    }
+
+    case AST::Func::FUNCTION:
+    {
+      const DynMathObject<type>* dyn_obj = math_world.get(node.data.name.in(expression));
+      if (not dyn_obj) [[unlikely]]
+        return std::unexpected(Error::undefined_function(node.data.name, expression));
 
-          for (AST& n: subnodes)
+      using FuncObj = typename DynMathObject<type>::FuncObj;
+      using SeqObj = typename DynMathObject<type>::SeqObj;
+      using DataObj = typename DynMathObject<type>::DataObj;
+
+      return std::visit(
+        utils::overloaded{
+          [&](CppFunction<1> f) -> Ret
+          {
+            if (subnodes.size() != 1) [[unlikely]]
+              return std::unexpected(Error::mismatched_fun_args(node.data.args_token(), expression));
+
+            const std::optional<std::string_view> derivative_expr = builtin_derivative_expression(f);
+            if (not derivative_expr)
+              return std::unexpected(Error::not_implemented(node.data.name, expression));
+
+            static constexpr std::array<std::string_view, 1> builtin_var = {"x"};
+            return tokenize(*derivative_expr)
+              .and_then(make_ast{*derivative_expr})
+              .transform(
+                [&](AST derivative)
+                {
+                  derivative = mark_input_vars{*derivative_expr, builtin_var}(std::move(derivative));
+                  import(derivative, *derivative_expr);
+                  return internal::multiply(tree,
+                                            internal::substitute_input_vars(tree, derivative, subnodes),
+                                            derivatives[0]);
+                });
+          },
+          [&](CppFunction<2>) -> Ret
           {
-            if (n.is_func() and n.func_data().type == AST::Func::SEPARATOR)
+            // the partial derivatives of 'max' and 'min' are not continuous
+            return std::unexpected(Error::not_implemented(node.data.name, expression));
+          },
+          [&](const FuncObj& f_obj) -> Ret
+          {
+            const std::vector<std::string> var_names = dyn_obj->get_input_var_names();
+            if (subnodes.size() != var_names.size()) [[unlikely]]
+              return std::unexpected(Error::mismatched_fun_args(node.data.args_token(), expression));
+
+            if (std::ranges::find(callers, node.data.name.in(expression)) != callers.end())
+              return std::unexpected(Error::not_implemented(node.data.name, expression));
+
+            differentiate body_differentiator{dyn_obj->lhs_str + f_obj.rhs_str, math_world, callers};
+            body_differentiator.callers.emplace_back(node.data.name.in(expression));
+
+            // the texts of the body are positioned in 'f_obj.rhs_str', that comes after the lhs in the equation
+            AST body = mark_input_vars{f_obj.rhs_str, var_names}(f_obj.rhs);
+            offset_tokens(body, int(dyn_obj->lhs_str.size()));
+
+            // f(a, b)' -> ∂f/∂x(a, b) * a' + ∂f/∂y(a, b) * b'
+            AST::Entry res = internal::number(0);
+            for (size_t i = 0; i != var_names.size(); i++)
             {
-              auto& nodes = n.func_data().subnodes;
-              final_subnodes.reserve(final_subnodes.size() + nodes.size());
-              std::ranges::move(nodes, std::back_inserter(final_subnodes));
+              if (internal::is_number(derivatives[i], 0))
+                continue;
+
+              auto exp_partial = body_differentiator(body, i);
+              if (not exp_partial)
+                return std::unexpected(std::move(exp_partial.error()));
+
+              import(*exp_partial, body_differentiator.source);
+
+              res = internal::add(
+                tree,
+                res,
+                internal::multiply(tree,
+                                   internal::substitute_input_vars(tree, *exp_partial, subnodes),
+                                   derivatives[i]));
             }
-            else final_subnodes.push_back(std::move(n));
-          }
+            return res;
+          },
+          [&]<class T>(const T&) -> Ret
+            requires utils::is_any_of<T, SeqObj, DataObj>
+          {
+            // sequences and data are only defined over integers
+            return internal::number(0);
+          },
+          [&](const auto&) -> Ret
+          {
+            return std::unexpected(Error::wrong_object_type(node.data.name, expression));
+          },
+        },
+        dyn_obj->parsed_data);
+    }
 
-          return AST::make_func(func.type, tree.name, func.full_expr, std::move(final_subnodes));
-        }
-        else
-          return AST::make_func(func.type, tree.name, func.full_expr, std::move(subnodes));
+    default:
+      return std::unexpected(Error::unexpected(node.data.name, expression));
+  }
+}
+
+template <Type type>
+void differentiate<type>::import(AST& tree, std::string_view text)
+{
+  offset_tokens(tree, int(source.size()));
+  source += text;
+}
 
+namespace internal {
 
-      },
-      [&](const AST::InputVariable&) -> AST
+  /// @brief priority of the root operation of 'tree', as in make_ast
+  inline int priority(AST::Ref tree)
+  {
+    if (tree->is_number())
+    {
+      const double value = tree->number_data().value;
+      return std::signbit(value) and std::isfinite(value) ? 4 : 6;
+    }
+    else if (not tree->is_func())
+      return 6;
+
+    switch (tree->func_data().type)
+    {
+      case AST::Func::OP_ADD:
+      case AST::Func::OP_SUBTRACT:
+        return 2;
+      case AST::Func::OP_MULTIPLY:
+      case AST::Func::OP_DIVIDE:
+        return 3;
+      case AST::Func::OP_UNARY_MINUS:
+        return 4;
+      case AST::Func::OP_POWER:
+        return 5;
+      default:
+        return 6;
+    }
+  }
+
+  inline void write_expression(AST::Ref tree, std::string_view expression, std::string& out);
+
+  inline void write_operand(AST::Ref operand, std::string_view expression, bool parenthesize, std::string& out)
+  {
+    if (parenthesize)
+      out += '(';
+    write_expression(operand, expression, out);
+    if (parenthesize)
+      out += ')';
+  }
+
+  inline void write_expression(AST::Ref tree, std::string_view expression, std::string& out)
+  {
+    if (tree->is_number())
+    {
+      const double value = tree->number_data().value;
+
+      // "inf" and "nan" would parse as variables
+      if (std::isnan(value))
       {
-        return tree;
-      },
-      [&](const AST::Number&) -> AST
+        out += "(0/0)";
+        return;
+      }
+      else if (std::isinf(value))
       {
-        return tree;
-      },
-      [&](AST::Variable) -> AST
+        out += value > 0 ? "(1/0)" : "(-1/0)";
+        return;
+      }
+
+      std::array<char, 32> buffer;
+      auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+      assert(ec == std::errc());
+      out.append(buffer.data(), end);
+      return;
+    }
+    else if (not tree->is_func())
+    {
+      out += tree->name.in(expression);
+      return;
+    }
+
+    const AST::Func& func = tree->func_data();
+    const auto subnodes = tree.subnodes();
+    const int prio = priority(tree);
+
+    if (func.type == AST::Func::FUNCTION)
+    {
+      out += tree->name.in(expression);
+      out += '(';
+      for (size_t i = 0; i != subnodes.size(); i++)
       {
-        return tree;
+        if (i != 0)
+          out += ", ";
+        write_expression(subnodes[i], expression, out);
       }
-    },
-    tree.dyn_data);
+      out += ')';
+    }
+    else if (func.type == AST::Func::OP_UNARY_MINUS)
+    {
+      out += '-';
+      write_operand(subnodes[0], expression, priority(subnodes[0]) <= prio, out);
+    }
+    else
+    {
+      const char op = [&]{
+        switch (func.type)
+        {
+          case AST::Func::OP_ADD: return '+';
+          case AST::Func::OP_SUBTRACT: return '-';
+          case AST::Func::OP_MULTIPLY: return '*';
+          case AST::Func::OP_DIVIDE: return '/';
+          default: return '^';
+        }
+      }();
+
+      const int lhs_prio = priority(subnodes[0]);
+      const int rhs_prio = priority(subnodes[1]);
+
+      // the left operand of a power is parenthesized, whatever its associativity is,
+      // and so is a negated right operand, e.g. "a+(-b)"
+      write_operand(subnodes[0], expression, lhs_prio < prio or (op == '^' and lhs_prio <= prio), out);
+      out += op;
+      write_operand(subnodes[1], expression, rhs_prio <= prio or rhs_prio == 4, out);
+    }
+  }
+
+} // namespace internal
+
+inline std::string to_expression(const AST& tree, std::string_view expression)
+{
+  std::string out;
+  internal::write_expression(tree, expression, out);
+  return out;
 }
 
 namespace internal {
-  inline void make_RPN(RPN& res, const FAST<zc::parsing::Type::RPN>& tree)
+
+  /// @brief folds in place the subtree below the node at 'index' in the pool of 'tree', see fold_constants()
+  template <Type type>
+  void fold_node(FAST<type>& tree, uint32_t index)
   {
-    for (const auto& node: tree.subnodes)
-      make_RPN(res, node);
+    const typename FAST<type>::Entry node = tree.at(index);
+    for (uint32_t i = 0; i != node.subnodes_num; i++)
+      fold_node(tree, node.first_subnode + i);
+
+    auto subnodes = std::span(tree.pool).subspan(node.first_subnode, node.subnodes_num);
+
+    auto is_number = [](const typename FAST<type>::Entry& subnode)
+    {
+      return std::holds_alternative<shared::node::Number>(subnode.data);
+    };
+
+    if (subnodes.empty() or not std::ranges::all_of(subnodes, is_number))
+      return;
+
+    auto operand = [&](size_t i)
+    {
+      return std::get<shared::node::Number>(subnodes[i].data).value;
+    };
+
+    using Ret = std::optional<double>;
+    const Ret folded = std::visit(
+      utils::overloaded{
+        [&](shared::node::Add) -> Ret { return operand(0) + operand(1); },
+        [&](shared::node::Subtract) -> Ret { return operand(0) - operand(1); },
+        [&](shared::node::Multiply) -> Ret { return operand(0) * operand(1); },
+        [&](shared::node::Divide) -> Ret { return operand(0) / operand(1); },
+        [&](shared::node::Power) -> Ret { return std::pow(operand(0), operand(1)); },
+        [&](shared::node::UnaryMinus) -> Ret { return -operand(0); },
+        [&]<size_t args_num>(CppFunction<args_num> f) -> Ret
+        {
+          // user defined C++ functions may not be pure
+          if (not is_builtin(f))
+            return {};
+
+          std::array<double, args_num> vals;
+          for (size_t i = 0; i < args_num; i++)
+            vals[i] = operand(i);
+          return f(vals);
+        },
+        [&](const auto&) -> Ret { return {}; },
+      },
+      node.data);
 
-    res.push_back(tree.node);
+    if (folded)
+      tree.at(index) = {shared::node::Number{*folded}};
   }
-}
 
-inline RPN make_RPN(const FAST<Type::RPN>& tree)
-{
-  RPN res;
-  internal::make_RPN(res, tree);
+  /// @brief simplifies in place the subtree below the node at 'index' in the pool of 'tree', see simplify()
+  template <Type type>
+  void simplify_node(FAST<type>& tree, uint32_t index)
+  {
+    using namespace shared::node;
+    using Entry = typename FAST<type>::Entry;
+
+    const Entry node = tree.at(index);
+    for (uint32_t i = 0; i != node.subnodes_num; i++)
+      simplify_node(tree, node.first_subnode + i);
+
+    // copied, as the pool can grow
+    auto subnode = [&](uint32_t i) -> Entry
+    {
+      return tree.pool[node.first_subnode + i];
+    };
+
+    auto number = [&](uint32_t i) -> std::optional<double>
+    {
+      if (auto* num = std::get_if<Number>(&tree.pool[node.first_subnode + i].data))
+        return num->value;
+      else return {};
+    };
+
+    // compared bitwise: e.g. x+0 is not x when x is -0
+    auto is = [](std::optional<double> num, double val)
+    {
+      return num and std::bit_cast<uint64_t>(*num) == std::bit_cast<uint64_t>(val);
+    };
+
+    // the node gets replaced, its subnodes are left as they are: they may be shared
+    auto replace = [&](Entry equivalent)
+    {
+      tree.at(index) = std::move(equivalent);
+    };
+
+    if (std::holds_alternative<Multiply>(node.data))
+    {
+      if (is(number(1), 1.))
+        replace(subnode(0));
+      else if (is(number(0), 1.))
+        replace(subnode(1));
+    }
+    else if (std::holds_alternative<Add>(node.data))
+    {
+      if (is(number(1), -0.))
+        replace(subnode(0));
+      else if (is(number(0), -0.))
+        replace(subnode(1));
+    }
+    else if (std::holds_alternative<Subtract>(node.data))
+    {
+      if (is(number(1), 0.))
+        replace(subnode(0));
+    }
+    else if (std::holds_alternative<UnaryMinus>(node.data))
+    {
+      if (std::holds_alternative<UnaryMinus>(subnode(0).data))
+        replace(tree.pool[subnode(0).first_subnode]);
+    }
+    else if (std::holds_alternative<Divide>(node.data))
+    {
+      if (auto c = number(1))
+      {
+        int exponent = 0;
+        if (is(c, 1.))
+          replace(subnode(0));
+
+        // dividing by a power of two is exactly multiplying by its inverse, when that one is normal
+        else if (std::isfinite(*c) and std::fabs(std::frexp(*c, &exponent)) == 0.5
+                 and std::isnormal(1. / *c))
+          replace(tree.make_node(Multiply{}, {subnode(0), Entry{Number{1. / *c}}}));
+      }
+    }
+    else if (std::holds_alternative<Power>(node.data))
+    {
+      const std::optional<double> n = number(1);
+      const Entry base = subnode(0);
+
+      // the base gets duplicated: only RPN computes it once, thanks to common subexpression elimination
+      const bool duplicable = internal::is_pure<type>(tree.ref(base))
+                              and (base.subnodes_num == 0 or type == Type::RPN);
+
+      if (not n or not duplicable or not internal::is_reduced_exponent(*n))
+        return;
+
+      replace(internal::power_chain(tree, base, unsigned(*n)));
+    }
+  }
+
+} // namespace internal
+
+template <Type type>
+FAST<type> fold_constants(FAST<type> tree)
+{
+  internal::fold_node(tree, FAST<type>::root_index);
+  return tree;
+}
+
+template <Type type>
+FAST<type> simplify(FAST<type> tree)
+{
+  internal::simplify_node(tree, FAST<type>::root_index);
+  return tree;
+}
+
+namespace internal {
+
+  /// @returns the priority of the binary infix operator 'type', if it is one
+  constexpr std::optional<uint8_t> binary_infix_priority(tokens::Type type)
+  {
+    for (const tokens::Operator& op: tokens::operators)
+      if (op.desc == tokens::Operator::BINARY_INFIX and op.type == type)
+        return op.priority;
+    return {};
+  }
+
+  inline constexpr uint8_t unary_prefix_priority =
+    tokens::as_unary_prefix_operator('-')->priority;
+
+  /// @brief single pass precedence climbing (Pratt) parser over a sequence of tokens
+  /// @note  binary operators are left associative, and a unary prefix operator applies to what
+  ///        follows up to the next operator of lower priority than '^', which gives the same trees
+  ///        as splitting expressions on their lowest priority operators, from right to left
+  template <std::ranges::viewable_range Range>
+  struct PrattParser
+  {
+    std::string_view expression;
+    const Range& input_vars;
+    std::span<const Token> tokens;
+    size_t pos = 0;
+
+    /// @brief tree whose pool gets the operands, as they get parsed
+    AST tree = {};
+
+    /// @brief parsed subexpression, whose subnodes are in the pool of 'tree', with the indices
+    ///        of the first and last tokens it spans, parentheses included
+    struct Operand
+    {
+      AST::Entry node;
+      size_t first, last;
+    };
+
+    /// @brief text spanned by the tokens from 'first' to 'last', included
+    tokens::Text sub_expr(size_t first, size_t last) const
+    {
+      size_t begin = tokens[first].begin;
+      size_t end = tokens[last].begin + tokens[last].size;
+      return tokens::Text(begin, end - begin);
+    }
+
+    /// @brief node of an operator or of a function call, whose operands get appended to the pool
+    AST::Entry make_func(AST::Func::Type type,
+                         tokens::Text name,
+                         tokens::Text full_expr,
+                         std::initializer_list<AST::Entry> operands)
+    {
+      return tree.make_node(ast::Node{.name = name, .dyn_data = AST::Func{.type = type, .full_expr = full_expr}},
+                            operands);
+    }
+
+    static AST::Entry make_leaf(tokens::Text name, decltype(ast::Node::dyn_data) dyn_data)
+    {
+      return AST::Entry{.data = {.name = name, .dyn_data = std::move(dyn_data)}};
+    }
+
+    std::unexpected<Error> unexpected_token() const
+    {
+      if (pos < tokens.size())
+        return std::unexpected(Error::unexpected(tokens[pos], std::string(expression)));
+      else return std::unexpected(Error::unexpected_end_of_expression(std::string(expression)));
+    }
+
+    /// @brief parses an operand followed by binary operators of priority 'min_priority' or above
+    std::expected<Operand, Error> parse(uint8_t min_priority)
+    {
+      auto lhs = parse_operand(min_priority);
+      if (not lhs) [[unlikely]]
+        return lhs;
+
+      while (pos < tokens.size())
+      {
+        const Token& op = tokens[pos];
+        std::optional<uint8_t> priority = binary_infix_priority(op.type);
+        if (not priority or *priority < min_priority)
+          break;
+
+        pos++;
+        auto rhs = parse(*priority + 1);
+        if (not rhs) [[unlikely]]
+          return rhs;
+
+        lhs->node = make_func(AST::Func::Type(op.type),
+                              op,
+                              sub_expr(lhs->first, rhs->last),
+                              {lhs->node, rhs->node});
+        lhs->last = rhs->last;
+      }
+
+      return lhs;
+    }
+
+    /// @brief parses a number, a variable, a function call, a parenthesized expression,
+    ///        or a unary prefix operator and its operand
+    std::expected<Operand, Error> parse_operand(uint8_t min_priority)
+    {
+      if (pos == tokens.size()) [[unlikely]]
+        return unexpected_token();
+
+      const Token& token = tokens[pos];
+      const size_t first = pos;
+
+      switch (token.type)
+      {
+        case tokens::NUMBER:
+          pos++;
+          return Operand{make_leaf(token, AST::Number{token.value}), first, first};
+
+        case tokens::VARIABLE:
+        {
+          pos++;
+          auto it = std::ranges::find(input_vars, token.in(expression));
+          if (it != input_vars.end())
+            return Operand{make_leaf(token, AST::InputVariable{size_t(std::distance(input_vars.begin(), it))}),
+                           first,
+                           first};
+          else return Operand{make_leaf(token, AST::Variable{}), first, first};
+        }
+
+        case tokens::OP_UNARY_MINUS:
+        case tokens::OP_UNARY_PLUS:
+        {
+          pos++;
+          auto operand = parse(std::max(uint8_t(unary_prefix_priority + 1), min_priority));
+          if (not operand) [[unlikely]]
+            return operand;
+
+          // optimization: just skip entirely unary plus
+          if (token.type == tokens::OP_UNARY_PLUS)
+            return Operand{std::move(operand->node), first, operand->last};
+
+          return Operand{make_func(AST::Func::OP_UNARY_MINUS,
+                                   token,
+                                   sub_expr(first, operand->last),
+                                   {operand->node}),
+                         first,
+                         operand->last};
+        }
+
+        case tokens::OPENING_PARENTHESIS:
+        {
+          pos++;
+          auto inner = parse(0);
+          if (not inner) [[unlikely]]
+            return inner;
+
+          if (pos == tokens.size() or tokens[pos].type != tokens::CLOSING_PARENTHESIS) [[unlikely]]
+            return unexpected_token();
+
+          return Operand{std::move(inner->node), first, pos++};
+        }
+
+        case tokens::FUNCTION:
+        {
+          pos++;
+          if (pos == tokens.size() or tokens[pos].type != tokens::FUNCTION_CALL_START) [[unlikely]]
+            return unexpected_token();
+
+          pos++;
+          auto args = parse(0);
+          if (not args) [[unlikely]]
+            return args;
+
+          if (pos == tokens.size() or tokens[pos].type != tokens::FUNCTION_CALL_END) [[unlikely]]
+            return unexpected_token();
+
+          return Operand{make_func(AST::Func::FUNCTION,
+                                   token,
+                                   sub_expr(first, pos),
+                                   {args->node}),
+                         first,
+                         pos++};
+        }
+
+        default: [[unlikely]]
+          return unexpected_token();
+      }
+    }
+  };
+
+  /// @brief checks that separators are only operands of separators, assignments,
+  ///        unary prefix operators and functions
+  /// @note  the right hand side of an operation is checked before its left hand side, then its operands
+  inline std::optional<Error> check_separators(AST::Ref tree, std::string_view expression)
+  {
+    if (not tree->is_func())
+      return {};
+
+    const AST::Func& func = tree->func_data();
+
+    for (AST::Ref subnode: tree.subnodes() | std::views::reverse)
+      if (auto error = check_separators(subnode, expression))
+        return error;
+
+    if (tree.subnodes().size() == 2 and func.type != AST::Func::SEPARATOR
+        and func.type != AST::Func::OP_ASSIGN)
+      for (AST::Ref operand: tree.subnodes())
+        if (operand->is_func() and operand->func_data().type == AST::Func::SEPARATOR) [[unlikely]]
+          return Error::unexpected(operand->name, std::string(expression));
+
+    return {};
+  }
+
+} // namespace internal
+
+template <std::ranges::viewable_range Range>
+  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
+std::expected<AST, Error> make_ast<Range>::operator () (std::span<const parsing::Token> tokens)
+{
+  if (tokens.empty()) [[unlikely]]
+    return std::unexpected(Error::empty_expression());
+
+  internal::PrattParser<Range> parser{.expression = expression, .input_vars = input_vars, .tokens = tokens};
+
+  auto exp_operand = parser.parse(0);
+  if (not exp_operand) [[unlikely]]
+    return std::unexpected(std::move(exp_operand.error()));
+
+  if (parser.pos != tokens.size()) [[unlikely]]
+    return parser.unexpected_token();
+
+  parser.tree.root = std::move(exp_operand->node);
+
+  if (auto error = internal::check_separators(parser.tree, expression)) [[unlikely]]
+    return std::unexpected(std::move(*error));
+
+  return std::move(parser.tree);
+}
+
+template <std::ranges::viewable_range Range>
+  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
+AST mark_input_vars<Range>::operator () (AST tree)
+{
+  // every node of the pool gets marked, the ones no longer in the tree included
+  auto mark = [&](AST::Entry& node)
+  {
+    if (not node.data.is_var())
+      return;
+
+    auto it = std::ranges::find(input_vars, node.data.name.in(expression));
+    if (it != input_vars.end())
+      node.data.dyn_data = AST::InputVariable{size_t(std::distance(input_vars.begin(), it))};
+  };
+
+  mark(tree.root);
+  std::ranges::for_each(tree.pool, mark);
+
+  return tree;
+}
+
+namespace internal {
+
+  inline bool is_separator(const AST::Entry& node)
+  {
+    return node.data.is_func() and node.data.func_data().type == AST::Func::SEPARATOR;
+  }
+
+  /// @brief appends to 'operands' the subnodes of 'node', where nested separators are replaced with their operands
+  inline void collect_operands(const AST& tree, const AST::Entry& node, std::vector<AST::Entry>& operands)
+  {
+    for (uint32_t i = 0; i != node.subnodes_num; i++)
+    {
+      const AST::Entry& subnode = tree.pool[node.first_subnode + i];
+      if (is_separator(subnode))
+        collect_operands(tree, subnode, operands);
+      else operands.push_back(subnode);
+    }
+  }
+
+  /// @brief flattens in place the separators below the node at 'index' in the pool of 'tree'
+  inline void flatten_separators(AST& tree, uint32_t index)
+  {
+    AST::Entry node = tree.at(index);
+    if (not node.data.is_func())
+      return;
+
+    const AST::Func::Type type = node.data.func_data().type;
+    const auto subnodes = std::span(tree.pool).subspan(node.first_subnode, node.subnodes_num);
+
+    if ((type == AST::Func::FUNCTION or type == AST::Func::SEPARATOR)
+        and std::ranges::any_of(subnodes, is_separator))
+    {
+      // the operands of nested separators are collected all at once,
+      // which keeps flattening long lists linear
+      std::vector<AST::Entry> operands;
+      collect_operands(tree, node, operands);
+      node = tree.make_node(std::move(node.data), operands);
+      tree.at(index) = node;
+    }
+
+    for (uint32_t i = 0; i != node.subnodes_num; i++)
+      flatten_separators(tree, node.first_subnode + i);
+  }
+
+} // namespace internal
+
+inline AST flatten_separators(AST tree)
+{
+  internal::flatten_separators(tree, AST::root_index);
+  return tree;
+}
+
+namespace internal {
+
+  /// @brief generates an RPN program from a tree, where each common subexpression is computed once
+  /// @note  common subexpressions are computed first and their values stay at the bottom of the stack,
+  ///        the rest of the program reads them back with node::LoadLocal
+  /// @note  only pure subtrees are shared: subtrees that call sequences, data or
+  ///        user defined C++ functions, even through the functions they call, are computed wherever they appear
+  struct RPNCompiler
+  {
+    using Tree = FAST<Type::RPN>::Ref;
+
+    RPN& res;
+
+    /// @brief structural hash of each subtree, and if it's pure, by node of the pool
+    std::unordered_map<const FAST<Type::RPN>::Entry*, std::pair<size_t, bool>> infos = {};
+
+    struct TreeHash
+    {
+      const RPNCompiler& compiler;
+      size_t operator () (Tree tree) const { return compiler.infos.at(tree.entry).first; }
+    };
+
+    struct TreeEqual
+    {
+      bool operator () (Tree a, Tree b) const { return same_tree(a, b); }
+    };
+
+    template <class T>
+    using TreeMap = std::unordered_map<Tree, T, TreeHash, TreeEqual>;
+
+    /// @brief number of times each pure subtree needs to be computed
+    TreeMap<size_t> occurrences{0, TreeHash{*this}};
+
+    /// @brief position in the stack of the common subexpressions already computed
+    TreeMap<size_t> locals{0, TreeHash{*this}};
+
+    /// @brief compares nodes the way FAST does, except numbers that are compared bitwise
+    ///        so that e.g. 0 and -0 do not get merged
+    static bool same_tree(Tree a, Tree b)
+    {
+      auto* num_a = std::get_if<shared::node::Number>(&a.node());
+      auto* num_b = std::get_if<shared::node::Number>(&b.node());
+      if (num_a and num_b)
+        return std::bit_cast<uint64_t>(num_a->value) == std::bit_cast<uint64_t>(num_b->value);
+
+      return a.node() == b.node() and a.subnodes().size() == b.subnodes().size()
+             and std::ranges::equal(a.subnodes(), b.subnodes(), same_tree);
+    }
+
+    /// @brief computes the hash of every subtree of 'tree', and if it's pure
+    void fill_infos(Tree tree)
+    {
+      const size_t node_hash = std::visit(
+        utils::overloaded{
+          [](const shared::node::Number& num) { return std::hash<uint64_t>{}(std::bit_cast<uint64_t>(num.value)); },
+          [](const shared::node::InputVariable& var) { return std::hash<size_t>{}(var.index); },
+          []<size_t args_num>(CppFunction<args_num> f) { return std::hash<const void*>{}(reinterpret_cast<const void*>(f.f_ptr)); },
+          [](const auto* ptr) { return std::hash<const void*>{}(ptr); },
+          [](const auto&) { return size_t(0); },
+        },
+        tree.node());
+
+      bool pure = internal::is_pure_node<Type::RPN>(tree.node());
+
+      size_t hash = tree.node().index() ^ (node_hash + 0x9e3779b9);
+      for (Tree subnode: tree.subnodes())
+      {
+        fill_infos(subnode);
+        const auto& [sub_hash, sub_pure] = infos.at(subnode.entry);
+        hash ^= sub_hash + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        pure = pure and sub_pure;
+      }
+
+      infos[tree.entry] = {hash, pure};
+    }
+
+    /// @brief counts the times each pure subtree needs to be computed once common subexpressions are shared
+    /// @note  subtrees within a repeated subtree are counted only in its first occurrence
+    void count(Tree tree)
+    {
+      if (can_share(tree) and ++occurrences[tree] > 1)
+        return;
+
+      for (Tree subnode: tree.subnodes())
+        count(subnode);
+    }
+
+    /// @brief pure subtrees that are not leaves can be shared
+    bool can_share(Tree tree) const
+    {
+      return not tree.subnodes().empty() and infos.at(tree.entry).second;
+    }
+
+    bool is_common(Tree tree) const
+    {
+      auto it = occurrences.find(tree);
+      return it != occurrences.end() and it->second > 1;
+    }
+
+    /// @brief computes the common subexpressions of 'tree', children before parents
+    void emit_locals(Tree tree)
+    {
+      if (locals.contains(tree))
+        return;
+
+      for (Tree subnode: tree.subnodes())
+        emit_locals(subnode);
+
+      if (is_common(tree))
+      {
+        const size_t index = locals.size();
+        emit(tree);
+        locals[tree] = index;
+      }
+    }
+
+    /// @brief computes 'tree', reading back the common subexpressions that have been computed already
+    void emit(Tree tree)
+    {
+      if (auto it = locals.find(tree); it != locals.end())
+      {
+        res.push_back(shared::node::LoadLocal{it->second});
+        return;
+      }
+
+      for (Tree subnode: tree.subnodes())
+        emit(subnode);
+
+      res.push_back(tree.node());
+    }
+
+    void operator () (Tree tree)
+    {
+      fill_infos(tree);
+      count(tree);
+      emit_locals(tree);
+      emit(tree);
+    }
+  };
+}
+
+inline RPN make_RPN(const FAST<Type::RPN>& tree)
+{
+  RPN res;
+  internal::RPNCompiler{res}(tree);
+  return res;
+}
+
+inline std::optional<RPN> compile_rpn::operator () (std::span<const Token> tokens) const
+{
+  using namespace shared::node;
+  using DynObj = DynMathObject<Type::RPN>;
+
+  // operators, parentheses and function calls waiting for their operands
+  struct Pending
+  {
+    tokens::Type type;
+
+    /// @brief operators with a priority greater or equal to the one of an incoming binary operator
+    ///        get emitted before it, this makes them left associative
+    uint8_t priority = 0;
+
+    /// @brief function calls only
+    std::string_view name = {};
+    size_t args_num = 1;
+  };
+
+  // what the usual pipeline can make of the subtree that computes each value of the stack:
+  // CONSTANT ones are made only of numbers, operators and builtin functions, and get folded,
+  // VARIABLE ones never become numbers, UNKNOWN ones call functions that may get inlined
+  enum Fold : uint8_t { CONSTANT, VARIABLE, UNKNOWN };
+
+  RPN rpn;
+  rpn.reserve(tokens.size());
+  std::vector<Fold> folds;
+  std::vector<Pending> pending;
+
+  using Node = RPN::value_type;
+
+  // appends 'node', that takes its 'operands_num' operands from the stack
+  auto emit = [&](Node node, size_t operands_num, Fold fold) -> bool
+  {
+    if (folds.size() < operands_num)
+      return false;
+
+    for (size_t i = 0; i != operands_num; i++)
+    {
+      fold = std::max(fold, folds.back());
+      folds.pop_back();
+    }
+
+    rpn.push_back(std::move(node));
+    folds.push_back(fold);
+    return true;
+  };
+
+  // fold of leaves and function calls
+  auto fold_of = [&](const Node& node) -> Fold
+  {
+    return std::visit(
+      utils::overloaded{
+        [](const Number&) { return CONSTANT; },
+        []<size_t n>(CppFunction<n> f) { return is_builtin(f) ? CONSTANT : VARIABLE; },
+        [&](const LinkedFunc<Type::RPN>*) { return math_world.get_inlining() ? UNKNOWN : VARIABLE; },
+        [](const auto&) { return VARIABLE; },
+      },
+      node);
+  };
+
+  // simplify() turns powers with a small positive integer exponent into multiplications, that do not
+  // give the same results: done here too when the base is a leaf, the other cases are left to the usual pipeline
+  auto emit_power = [&]() -> bool
+  {
+    if (rpn.size() < 2 or not math_world.get_simplification())
+      return emit(Power{}, 2, CONSTANT);
+
+    const Node& exponent = rpn.back();
+    const Node& before_exponent = rpn[rpn.size() - 2];
+
+    if (not std::holds_alternative<Number>(exponent))
+    {
+      // negated numbers are never reduced, whether they get folded or not, and variable exponents are never numbers
+      // note: constant exponents may become numbers, even without folding, e.g. "-(-2)" or "2*1"
+      const bool negated_number = std::holds_alternative<UnaryMinus>(exponent)
+                                  and std::holds_alternative<Number>(before_exponent);
+      return (negated_number or folds.back() == VARIABLE) and emit(Power{}, 2, CONSTANT);
+    }
+
+    const double n = std::get<Number>(exponent).value;
+    const Fold base_fold = folds[folds.size() - 2];
+
+    // constant bases are folded along with the power, with std::pow
+    if (not internal::is_reduced_exponent(n) or (base_fold == CONSTANT and math_world.get_constant_folding()))
+      return emit(Power{}, 2, CONSTANT);
+
+    // the base ends right before the exponent: it is known only when it is a single node
+    const auto* f = std::get_if<const LinkedFunc<Type::RPN>*>(&before_exponent);
+    const bool leaf = std::holds_alternative<InputVariable>(before_exponent)
+                      or std::holds_alternative<const double*>(before_exponent)
+                      or std::holds_alternative<Number>(before_exponent) or (f and (*f)->args_num == 0);
+    if (not leaf or base_fold == UNKNOWN)
+      return false;
+
+    // impure bases are not duplicated
+    if (not internal::is_pure_node<Type::RPN>(before_exponent))
+      return emit(Power{}, 2, CONSTANT);
+
+    const Node base = before_exponent;
+    rpn.resize(rpn.size() - 2);
+    folds.resize(folds.size() - 2);
+    internal::power_chain(rpn, base, unsigned(n));
+    folds.push_back(base_fold);
+    return true;
+  };
+
+  // emits the pending operators down to the first parenthesis or function call
+  auto emit_operators = [&](uint8_t min_priority) -> bool
+  {
+    while (not pending.empty() and pending.back().priority >= min_priority
+           and pending.back().type != tokens::OPENING_PARENTHESIS
+           and pending.back().type != tokens::FUNCTION)
+    {
+      bool emitted = true;
+      switch (pending.back().type)
+      {
+        case tokens::OP_ADD: emitted = emit(Add{}, 2, CONSTANT); break;
+        case tokens::OP_SUBTRACT: emitted = emit(Subtract{}, 2, CONSTANT); break;
+        case tokens::OP_MULTIPLY: emitted = emit(Multiply{}, 2, CONSTANT); break;
+        case tokens::OP_DIVIDE: emitted = emit(Divide{}, 2, CONSTANT); break;
+        case tokens::OP_POWER: emitted = emit_power(); break;
+        case tokens::OP_UNARY_MINUS: emitted = emit(UnaryMinus{}, 1, CONSTANT); break;
+        default: break;
+      }
+      if (not emitted)
+        return false;
+      pending.pop_back();
+    }
+    return true;
+  };
+
+  using Ret = std::optional<Node>;
+
+  // node that reads the object 'name', if it can be used as a variable
+  auto variable_node = [&](std::string_view name) -> Ret
+  {
+    if (auto it = std::ranges::find(input_vars, name); it != input_vars.end())
+      return InputVariable{size_t(std::distance(input_vars.begin(), it))};
+
+    const DynObj* obj = math_world.get(name);
+    if (not obj or not obj->has_value())
+      return {};
+
+    if (const auto* cst = std::get_if<DynObj::ConstObj>(&obj->parsed_data))
+      return &cst->val;
+
+    const auto* f = std::get_if<DynObj::FuncObj>(&obj->parsed_data);
+    if (f and f->linked_rhs and f->linked_rhs->args_num == 0)
+      return &*f->linked_rhs;
+
+    return {};
+  };
+
+  // node that calls the object 'name', if it can be called with 'args_num' arguments
+  auto call_node = [&](std::string_view name, size_t args_num) -> Ret
+  {
+    const DynObj* obj = math_world.get(name);
+    if (not obj or not obj->has_value())
+      return {};
+
+    return std::visit(
+      utils::overloaded{
+        [&]<size_t n>(CppFunction<n> f) -> Ret
+        {
+          if (n == args_num)
+            return f;
+          return {};
+        },
+        [&](const DynObj::FuncObj& f) -> Ret
+        {
+          if (f.linked_rhs and f.linked_rhs->args_num == args_num)
+            return &*f.linked_rhs;
+          return {};
+        },
+        [&](const DynObj::SeqObj& u) -> Ret
+        {
+          if (u.linked_rhs and args_num == 1)
+            return &*u.linked_rhs;
+          return {};
+        },
+        [&](const DynObj::DataObj& d) -> Ret
+        {
+          if (args_num == 1)
+            return &d.linked_rhs;
+          return {};
+        },
+        [](const auto&) -> Ret { return {}; },
+      },
+      obj->parsed_data);
+  };
+
+  for (auto it = tokens.begin(); it != tokens.end(); it++)
+  {
+    const Token& token = *it;
+    switch (token.type)
+    {
+      case tokens::NUMBER:
+        emit(Number{token.value}, 0, CONSTANT);
+        break;
+
+      case tokens::VARIABLE:
+      {
+        Ret node = variable_node(token.in(expression));
+        if (not node)
+          return {};
+        emit(*node, 0, fold_of(*node));
+        break;
+      }
+
+      case tokens::FUNCTION:
+        pending.push_back({.type = tokens::FUNCTION, .name = token.in(expression)});
+        break;
+
+      case tokens::FUNCTION_CALL_START:
+        break;
+
+      case tokens::OPENING_PARENTHESIS:
+        pending.push_back({.type = tokens::OPENING_PARENTHESIS});
+        break;
+
+      case tokens::OP_UNARY_MINUS:
+      case tokens::OP_UNARY_PLUS:
+      {
+        // same trees as make_ast: a unary operator right after '^' only takes the next operand
+        uint8_t priority = internal::unary_prefix_priority;
+        if (it != tokens.begin())
+        {
+          const tokens::Type previous = std::prev(it)->type;
+          if (previous == tokens::OP_UNARY_MINUS or previous == tokens::OP_UNARY_PLUS)
+            priority = pending.back().priority;
+          else if (auto previous_priority = internal::binary_infix_priority(previous))
+            priority = std::max(priority, *previous_priority);
+        }
+        pending.push_back({.type = token.type, .priority = priority});
+        break;
+      }
+
+      case tokens::SEPARATOR:
+        if (not emit_operators(0) or pending.empty() or pending.back().type != tokens::FUNCTION)
+          return {};
+        pending.back().args_num++;
+        break;
+
+      case tokens::CLOSING_PARENTHESIS:
+        if (not emit_operators(0) or pending.empty() or pending.back().type != tokens::OPENING_PARENTHESIS)
+          return {};
+        pending.pop_back();
+        break;
+
+      case tokens::FUNCTION_CALL_END:
+      {
+        if (not emit_operators(0) or pending.empty() or pending.back().type != tokens::FUNCTION)
+          return {};
+
+        Ret node = call_node(pending.back().name, pending.back().args_num);
+        if (not node or not emit(*node, pending.back().args_num, fold_of(*node)))
+          return {};
+        pending.pop_back();
+        break;
+      }
+
+      default:
+      {
+        auto priority = internal::binary_infix_priority(token.type);
+        if (not priority or token.type == tokens::OP_ASSIGN)
+          return {};
+
+        if (not emit_operators(*priority))
+          return {};
+        pending.push_back({.type = token.type, .priority = *priority});
+      }
+    }
+  }
+
+  if (not emit_operators(0) or not pending.empty() or folds.size() != 1)
+    return {};
+
+  return rpn;
+}
+
+inline RPN fuse_nodes(const RPN& rpn, bool fma)
+{
+  using namespace shared::node;
+
+  RPN res;
+  res.reserve(rpn.size());
+
+  // the node that is 'offset' nodes before the end of 'res', if there is one
+  auto back = [&](size_t offset) -> const RPN::value_type*
+  {
+    return offset < res.size() ? &res[res.size() - 1 - offset] : nullptr;
+  };
+
+  // replaces the last 'count' nodes of 'res' with 'node'
+  auto fuse = [&](size_t count, RPN::value_type node)
+  {
+    res.resize(res.size() - count);
+    res.push_back(std::move(node));
+  };
+
+  // the right operand of a binary operator is the node right before it when that node pushes
+  // a plain value, and the left operand is the node before that one when it pushes a plain value too
+  for (const RPN::value_type& node: rpn)
+  {
+    const Number* num = std::get_if<Number>(back(0));
+    const double* const* global_constant = std::get_if<const double*>(back(0));
+
+    if (std::holds_alternative<Add>(node) and num)
+      fuse(1, AddNumber{num->value});
+
+    // a - n is exactly a + (-n)
+    else if (std::holds_alternative<Subtract>(node) and num)
+      fuse(1, AddNumber{-num->value});
+
+    else if (std::holds_alternative<Add>(node) and global_constant)
+      fuse(1, AddGlobalConstant{*global_constant});
+
+    else if (std::holds_alternative<Add>(node) and fma and std::get_if<Multiply>(back(0)))
+      fuse(1, MultiplyAdd{});
+
+    else if (std::holds_alternative<Multiply>(node))
+    {
+      const InputVariable* var = std::get_if<InputVariable>(back(1));
+      const Number* num_first = std::get_if<Number>(back(1));
+      const InputVariable* var_second = std::get_if<InputVariable>(back(0));
+
+      if (num and var)
+        fuse(2, ScaledInput{var->index, num->value});
+      else if (num_first and var_second)
+        fuse(2, ScaledInput{var_second->index, num_first->value});
+      else if (num)
+        fuse(1, MultiplyNumber{num->value});
+      else if (global_constant)
+        fuse(1, MultiplyGlobalConstant{*global_constant});
+      else res.push_back(node);
+    }
+    else res.push_back(node);
+  }
+
+  return res;
+}
+
+inline RPN use_vector_math(RPN rpn)
+{
+  for (RPN::value_type& node: rpn)
+    if (auto* f = std::get_if<CppFunction<1>>(&node))
+      if (auto approximation = approx::counterpart(*f))
+        *f = *approximation;
+
+  return rpn;
+}
+
+inline size_t max_stack_depth(const RPN& rpn)
+{
+  size_t depth = 0, max_depth = 0;
+  for (const auto& node: rpn)
+  {
+    // number of values the node pushes minus the number it pops
+    const std::ptrdiff_t delta = std::visit(
+      utils::overloaded{
+        [](shared::node::Add) -> std::ptrdiff_t { return -1; },
+        [](shared::node::Subtract) -> std::ptrdiff_t { return -1; },
+        [](shared::node::Multiply) -> std::ptrdiff_t { return -1; },
+        [](shared::node::Divide) -> std::ptrdiff_t { return -1; },
+        [](shared::node::Power) -> std::ptrdiff_t { return -1; },
+        [](shared::node::UnaryMinus) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::Number&) -> std::ptrdiff_t { return 1; },
+        [](const shared::node::InputVariable&) -> std::ptrdiff_t { return 1; },
+        [](const double*) -> std::ptrdiff_t { return 1; },
+        []<size_t args_num>(CppFunction<args_num>) -> std::ptrdiff_t { return 1 - std::ptrdiff_t(args_num); },
+        [](const LinkedFunc<Type::RPN>* f) -> std::ptrdiff_t { return 1 - std::ptrdiff_t(f->args_num); },
+        [](const LinkedSeq<Type::RPN>*) -> std::ptrdiff_t { return 0; },
+        [](const LinkedData<Type::RPN>*) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::LoadLocal&) -> std::ptrdiff_t { return 1; },
+        [](const shared::node::AddNumber&) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::MultiplyNumber&) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::AddGlobalConstant&) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::MultiplyGlobalConstant&) -> std::ptrdiff_t { return 0; },
+        [](const shared::node::ScaledInput&) -> std::ptrdiff_t { return 1; },
+        [](const shared::node::MultiplyAdd&) -> std::ptrdiff_t { return -2; },
+      },
+      node);
+
+    assert(std::ptrdiff_t(depth) + delta >= 0);
+    depth += delta;
+    max_depth = std::max(max_depth, depth);
+  }
+  return max_depth;
+}
+
+namespace internal {
+
+  /// @brief generates the instructions of a Bytecode program from a tree
+  /// @note  temporaries are allocated in a stack-like fashion: the result of a node
+  ///        is written in the first free temporary when the node's evaluation starts
+  struct BytecodeCompiler
+  {
+    Bytecode& res;
+
+    /// @brief fills the input variable count, the constant pool and the global constant pool
+    void collect_leaves(FAST<Type::BYTECODE>::Ref tree)
+    {
+      for (auto subnode: tree.subnodes())
+        collect_leaves(subnode);
+
+      if (const auto* var = std::get_if<shared::node::InputVariable>(&tree.node()))
+        res.input_vars_num = std::max(res.input_vars_num, uint32_t(var->index + 1));
+
+      else if (const auto* number = std::get_if<shared::node::Number>(&tree.node()))
+        pool_index(res.constants, number->value);
+
+      else if (const auto* global_constant = std::get_if<const double*>(&tree.node()))
+        pool_index(res.global_constants, *global_constant);
+    }
+
+    /// @brief returns the index of 'val' in 'pool', appends it if it's not there yet
+    /// @note  values are compared bitwise, so NaNs and signed zeros get their own entry
+    template <class T>
+    static uint32_t pool_index(std::vector<T>& pool, T val)
+    {
+      auto it = std::ranges::find_if(pool,
+                                     [&](const T& pool_val)
+                                     {
+                                       if constexpr (std::is_same_v<T, double>)
+                                         return std::bit_cast<uint64_t>(pool_val)
+                                                == std::bit_cast<uint64_t>(val);
+                                       else return pool_val == val;
+                                     });
+      if (it == pool.end())
+      {
+        pool.push_back(val);
+        return uint32_t(pool.size() - 1);
+      }
+      else return uint32_t(it - pool.begin());
+    }
+
+    /// @brief appends an instruction to the program
+    void emit(bytecode::OpCode op, uint32_t dst, uint32_t a, uint32_t b = 0)
+    {
+      res.instructions.push_back(bytecode::Instruction{op, dst, a, b});
+      res.registers_num = std::max(res.registers_num, dst + 1);
+    }
+
+    /// @brief compiles 'tree' and returns the register that will hold its value
+    /// @param free_reg: first temporary register that can be used, the result of
+    ///                  'tree' is written there if it's not a leaf (number, variable...)
+    uint32_t operator () (FAST<Type::BYTECODE>::Ref tree, uint32_t free_reg)
+    {
+      using bytecode::OpCode;
+
+      // compiles the subnodes, each one's result being left where it's computed
+      auto compile_args = [&]
+      {
+        std::array<uint32_t, max_func_args> regs = {};
+        assert(tree.subnodes().size() <= max_func_args);
+
+        uint32_t next_free_reg = free_reg;
+        for (size_t i = 0; i < tree.subnodes().size(); i++)
+        {
+          regs[i] = (*this)(tree.subnodes()[i], next_free_reg);
+          if (regs[i] == next_free_reg)
+            next_free_reg++;
+        }
+        return regs;
+      };
+
+      // compiles the subnodes, the result of the i-th one being in the register 'free_reg + i'
+      auto compile_contiguous_args = [&]
+      {
+        for (uint32_t i = 0; i < tree.subnodes().size(); i++)
+          if (uint32_t reg = (*this)(tree.subnodes()[i], free_reg + i); reg != free_reg + i)
+            emit(OpCode::MOVE, free_reg + i, reg);
+      };
+
+      auto emit_operation = [&](OpCode op)
+      {
+        auto regs = compile_args();
+        emit(op, free_reg, regs[0], regs[1]);
+        return free_reg;
+      };
+
+      auto emit_call = [&](OpCode op, uint32_t callee)
+      {
+        auto regs = compile_args();
+        emit(op, free_reg, regs[0], callee);
+        return free_reg;
+      };
+
+      auto emit_contiguous_args_call = [&](OpCode op, uint32_t callee)
+      {
+        compile_contiguous_args();
+        emit(op, free_reg, free_reg, callee);
+        res.registers_num = std::max(res.registers_num, free_reg + uint32_t(tree.subnodes().size()));
+        return free_reg;
+      };
+
+      return std::visit(
+        utils::overloaded{
+          [&](shared::node::Add) { return emit_operation(OpCode::ADD); },
+          [&](shared::node::Subtract) { return emit_operation(OpCode::SUBTRACT); },
+          [&](shared::node::Multiply) { return emit_operation(OpCode::MULTIPLY); },
+          [&](shared::node::Divide) { return emit_operation(OpCode::DIVIDE); },
+          [&](shared::node::Power) { return emit_operation(OpCode::POWER); },
+          [&](shared::node::UnaryMinus) { return emit_operation(OpCode::NEGATE); },
+          [&](const shared::node::InputVariable& var) { return uint32_t(var.index); },
+          [&](const shared::node::Number& number)
+          {
+            return res.input_vars_num + pool_index(res.constants, number.value);
+          },
+          [&](const double* global_constant)
+          {
+            return res.input_vars_num + uint32_t(res.constants.size())
+                   + pool_index(res.global_constants, global_constant);
+          },
+          [&](CppFunction<1> f)
+          {
+            return emit_call(OpCode::CALL_CPP_1, pool_index(res.cpp_functions_1, f));
+          },
+          [&](CppFunction<2> f)
+          {
+            return emit_contiguous_args_call(OpCode::CALL_CPP_2, pool_index(res.cpp_functions_2, f));
+          },
+          [&](const LinkedFunc<Type::BYTECODE>* f)
+          {
+            return emit_contiguous_args_call(OpCode::CALL_FUNC, pool_index(res.functions, f));
+          },
+          [&](const LinkedSeq<Type::BYTECODE>* u)
+          {
+            return emit_call(OpCode::CALL_SEQ, pool_index(res.sequences, u));
+          },
+          [&](const LinkedData<Type::BYTECODE>* u)
+          {
+            return emit_call(OpCode::CALL_DATA, pool_index(res.data, u));
+          },
+          [&]<class T>(const T&) -> uint32_t
+            requires shared::is_rpn_only<T>
+          {
+            // only RPN programs have local values and superinstructions
+            std::unreachable();
+          },
+        },
+        tree.node());
+    }
+  };
+}
+
+inline Bytecode make_bytecode(const FAST<Type::BYTECODE>& tree)
+{
+  Bytecode res;
+  internal::BytecodeCompiler compiler{res};
+
+  compiler.collect_leaves(tree);
+
+  const uint32_t temps_begin = res.input_vars_num
+                               + uint32_t(res.constants.size() + res.global_constants.size());
+
+  res.registers_num = temps_begin;
+  res.result = compiler(tree, temps_begin);
+
   return res;
 }
 
@@ -33,34 +33,42 @@ inline bool is_valid_name(std::string_view name)
 }
 
 /// @brief appends dependencies of 'ast' in 'deps'
+template <std::ranges::viewable_range Range>
+  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
 struct direct_dependency_saver
 {
-  Deps deps;
+  std::string_view expression;
+  const Range& input_vars;
+  Deps deps = {};
 
-  direct_dependency_saver& operator () (const AST& ast)
+  direct_dependency_saver& operator () (AST::Ref ast)
   {
     std::visit(
       utils::overloaded{
         [&](const AST::Func& func) {
           // we don't register operators
           if (func.type == AST::Func::FUNCTION)
-            deps[ast.name.substr].type = Dep::FUNCTION;
+            deps[std::string(ast->name.in(expression))].type = Dep::FUNCTION;
 
-          std::ranges::for_each(func.subnodes, std::ref(*this));
+          std::ranges::for_each(ast.subnodes(), std::ref(*this));
         },
         [&](const AST::InputVariable&) {},
         [&](const AST::Number&) {},
         [&](AST::Variable) {
-          deps[ast.name.substr].type = Dep::VARIABLE;
+          const std::string_view name = ast->name.in(expression);
+          if (std::ranges::find(input_vars, name) == input_vars.end())
+            deps[std::string(name)].type = Dep::VARIABLE;
         }},
-      ast.dyn_data);
+      ast->dyn_data);
     return *this;
   }
 };
 
-inline Deps direct_dependencies(const AST& ast)
+template <std::ranges::viewable_range Range>
+  requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::string_view>
+Deps direct_dependencies(const AST& ast, std::string_view expression, const Range& input_vars)
 {
-  return std::move(direct_dependency_saver{}(ast).deps);
+  return std::move(direct_dependency_saver<Range>{expression, input_vars}(ast).deps);
 }
 
 /// @brief create LHS instance from a string representing the left hand side
@@ -73,47 +81,49 @@ inline std::expected<LHS, zc::Error> parse_lhs(std::string_view lhs_expr, std::s
 }
 
 /// @brief create LHS instance from an already parsed string
-inline std::expected<LHS, zc::Error> parse_lhs(const AST& lhs, std::string_view full_expr)
+inline std::expected<LHS, zc::Error> parse_lhs(AST::Ref lhs, std::string_view full_expr)
 {
   // can either be a variable or a function call
-  if (lhs.is_var())
-    return LHS{.name = lhs.name, .substr = lhs.name};
+  if (lhs->is_var())
+    return LHS{.name = lhs->name, .substr = lhs->name};
 
-  else if (lhs.is_func())
+  else if (lhs->is_func())
   {
-    const auto& func_data = lhs.func_data();
-    auto res = LHS{.name = lhs.name, .substr = func_data.full_expr};
+    const auto& func_data = lhs->func_data();
+    auto res = LHS{.name = lhs->name, .substr = func_data.full_expr};
 
     if(func_data.type != parsing::AST::Func::FUNCTION)
-      return std::unexpected(Error::unexpected(lhs.name, std::string(full_expr)));
+      return std::unexpected(Error::unexpected(lhs->name, std::string(full_expr)));
 
     // we don't handle functions with no input variables
     // they are used as variables instead
-    assert(not func_data.subnodes.empty());
+    assert(not lhs.subnodes().empty());
 
-    res.input_vars.reserve(func_data.subnodes.size());
-    for (const auto& arg: func_data.subnodes)
+    res.input_vars.reserve(lhs.subnodes().size());
+    for (AST::Ref arg: lhs.subnodes())
     {
-      if (not arg.is_var()) [[ unlikely ]]
-        return std::unexpected(Error::unexpected(arg.name, std::string(full_expr)));
-      else res.input_vars.push_back(arg.name);
+      if (not arg->is_var()) [[ unlikely ]]
+        return std::unexpected(Error::unexpected(arg->name, std::string(full_expr)));
+      else res.input_vars.push_back(arg->name);
     }
 
     return res;
   }
-  else return std::unexpected(Error::unexpected(lhs.name, std::string(full_expr)));
+  else return std::unexpected(Error::unexpected(lhs->name, std::string(full_expr)));
 }
 
 /// @brief changes the begin position of every token within the ast by 'offset'
 inline void offset_tokens(AST& ast, int offset)
 {
-  ast.name.begin += offset;
-  if (ast.is_func())
+  auto offset_node = [&](AST::Entry& node)
   {
-    ast.func_data().full_expr.begin += offset;
-    for (auto& node : ast.func_data().subnodes)
-      offset_tokens(node, offset);
-  }
+    node.data.name.begin += offset;
+    if (node.data.is_func())
+      node.data.func_data().full_expr.begin += offset;
+  };
+
+  offset_node(ast.root);
+  std::ranges::for_each(ast.pool, offset_node);
 }
 
 } // namespace parsing
@@ -0,0 +1,420 @@
+#pragma once
+
+/****************************************************************************
+**  Copyright (c) 2024, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator's source code.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+/// @brief vector primitives over the widest instruction set enabled at compile time
+///        (AVX-512, AVX or SSE4.1), with a scalar fallback, and the vectorized
+///        transcendental functions written over them
+
+namespace zc {
+namespace simd {
+
+#if defined(__AVX512F__)
+
+  using Vec = __m512d;
+  inline constexpr size_t width = 8;
+
+  inline Vec load(const double* p) { return _mm512_loadu_pd(p); }
+  inline void store(double* p, Vec a) { _mm512_storeu_pd(p, a); }
+
+  inline Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+  inline Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+  inline Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+  inline Vec div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+  inline Vec max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+  inline Vec min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+  inline Vec sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+  inline Vec abs(Vec a) { return _mm512_abs_pd(a); }
+  inline Vec floor(Vec a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  inline Vec ceil(Vec a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+  inline Vec neg(Vec a)
+  {
+    return _mm512_castsi512_pd(
+      _mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x8000000000000000)));
+  }
+
+  inline Vec set1(double x) { return _mm512_set1_pd(x); }
+  inline Vec round(Vec a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+  using Mask = __mmask8;
+
+  inline Mask lt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+  inline Mask gt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+  inline Mask eq(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+  inline Mask isnan(Vec a) { return _mm512_cmp_pd_mask(a, a, _CMP_UNORD_Q); }
+  inline Vec select(Mask m, Vec a, Vec b) { return _mm512_mask_blend_pd(m, b, a); }
+  inline bool any(Mask m) { return m != 0; }
+
+  inline Vec pow2(Vec n) { return _mm512_scalef_pd(_mm512_set1_pd(1.), n); }
+  inline Vec exponent(Vec a) { return _mm512_getexp_pd(a); }
+  inline Vec mantissa(Vec a) { return _mm512_getmant_pd(a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+
+#elif defined(__AVX__)
+
+  using Vec = __m256d;
+  inline constexpr size_t width = 4;
+
+  inline Vec load(const double* p) { return _mm256_loadu_pd(p); }
+  inline void store(double* p, Vec a) { _mm256_storeu_pd(p, a); }
+
+  inline Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+  inline Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+  inline Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+  inline Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+  inline Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+  inline Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+  inline Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+  inline Vec abs(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  inline Vec floor(Vec a) { return _mm256_floor_pd(a); }
+  inline Vec ceil(Vec a) { return _mm256_ceil_pd(a); }
+  inline Vec neg(Vec a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+
+  inline Vec set1(double x) { return _mm256_set1_pd(x); }
+  inline Vec round(Vec a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+  using Mask = __m256d;
+
+  inline Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  inline Mask gt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  inline Mask eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  inline Mask isnan(Vec a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+  inline Vec select(Mask m, Vec a, Vec b) { return _mm256_blendv_pd(b, a, m); }
+  inline bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+
+  // AVX has no 256 bits integer instructions: the bit manipulations work on each 128 bits half
+
+  inline Vec pow2(Vec n)
+  {
+    auto half = [](__m128d h)
+    {
+      // adding 1.5 * 2^52 puts the integer 'h' in the low bits of the mantissa
+      const __m128i biased = _mm_add_epi64(_mm_castpd_si128(_mm_add_pd(h, _mm_set1_pd(0x1.8p52))),
+                                           _mm_set1_epi64x(1023));
+      return _mm_castsi128_pd(_mm_slli_epi64(biased, 52));
+    };
+    return _mm256_set_m128d(half(_mm256_extractf128_pd(n, 1)), half(_mm256_castpd256_pd128(n)));
+  }
+
+  inline Vec exponent(Vec a)
+  {
+    auto half = [](__m128d h)
+    {
+      const __m128i biased = _mm_or_si128(_mm_srli_epi64(_mm_castpd_si128(h), 52),
+                                          _mm_castpd_si128(_mm_set1_pd(0x1p52)));
+      return _mm_sub_pd(_mm_castsi128_pd(biased), _mm_set1_pd(0x1p52 + 1023));
+    };
+    return _mm256_set_m128d(half(_mm256_extractf128_pd(a, 1)), half(_mm256_castpd256_pd128(a)));
+  }
+
+  inline Vec mantissa(Vec a)
+  {
+    return _mm256_or_pd(_mm256_and_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(0x000FFFFFFFFFFFFF))),
+                        _mm256_set1_pd(1.));
+  }
+
+#elif defined(__SSE4_1__)
+
+  using Vec = __m128d;
+  inline constexpr size_t width = 2;
+
+  inline Vec load(const double* p) { return _mm_loadu_pd(p); }
+  inline void store(double* p, Vec a) { _mm_storeu_pd(p, a); }
+
+  inline Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+  inline Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+  inline Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+  inline Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+  inline Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+  inline Vec min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+  inline Vec sqrt(Vec a) { return _mm_sqrt_pd(a); }
+  inline Vec abs(Vec a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  inline Vec floor(Vec a) { return _mm_floor_pd(a); }
+  inline Vec ceil(Vec a) { return _mm_ceil_pd(a); }
+  inline Vec neg(Vec a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+
+  inline Vec set1(double x) { return _mm_set1_pd(x); }
+  inline Vec round(Vec a) { return _mm_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+  using Mask = __m128d;
+
+  inline Mask lt(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+  inline Mask gt(Vec a, Vec b) { return _mm_cmpgt_pd(a, b); }
+  inline Mask eq(Vec a, Vec b) { return _mm_cmpeq_pd(a, b); }
+  inline Mask isnan(Vec a) { return _mm_cmpunord_pd(a, a); }
+  inline Vec select(Mask m, Vec a, Vec b) { return _mm_blendv_pd(b, a, m); }
+  inline bool any(Mask m) { return _mm_movemask_pd(m) != 0; }
+
+  inline Vec pow2(Vec n)
+  {
+    // adding 1.5 * 2^52 puts the integer 'n' in the low bits of the mantissa
+    const __m128i biased = _mm_add_epi64(_mm_castpd_si128(_mm_add_pd(n, _mm_set1_pd(0x1.8p52))),
+                                         _mm_set1_epi64x(1023));
+    return _mm_castsi128_pd(_mm_slli_epi64(biased, 52));
+  }
+
+  inline Vec exponent(Vec a)
+  {
+    const __m128i biased = _mm_or_si128(_mm_srli_epi64(_mm_castpd_si128(a), 52),
+                                        _mm_castpd_si128(_mm_set1_pd(0x1p52)));
+    return _mm_sub_pd(_mm_castsi128_pd(biased), _mm_set1_pd(0x1p52 + 1023));
+  }
+
+  inline Vec mantissa(Vec a)
+  {
+    return _mm_or_pd(_mm_and_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(0x000FFFFFFFFFFFFF))), _mm_set1_pd(1.));
+  }
+
+#else
+
+  // scalar fallback: with 'width' being one, the vector loop of each kernel runs one lane at a time
+  using Vec = double;
+  inline constexpr size_t width = 1;
+
+  inline Vec load(const double* p) { return *p; }
+  inline void store(double* p, Vec a) { *p = a; }
+
+  inline Vec add(Vec a, Vec b) { return a + b; }
+  inline Vec sub(Vec a, Vec b) { return a - b; }
+  inline Vec mul(Vec a, Vec b) { return a * b; }
+  inline Vec div(Vec a, Vec b) { return a / b; }
+  inline Vec max(Vec a, Vec b) { return a > b ? a : b; }
+  inline Vec min(Vec a, Vec b) { return a < b ? a : b; }
+  inline Vec sqrt(Vec a) { return std::sqrt(a); }
+  inline Vec abs(Vec a) { return std::abs(a); }
+  inline Vec floor(Vec a) { return std::floor(a); }
+  inline Vec ceil(Vec a) { return std::ceil(a); }
+  inline Vec neg(Vec a) { return -a; }
+
+  inline Vec set1(double x) { return x; }
+  inline Vec round(Vec a) { return std::nearbyint(a); }
+
+  using Mask = bool;
+
+  inline Mask lt(Vec a, Vec b) { return a < b; }
+  inline Mask gt(Vec a, Vec b) { return a > b; }
+  inline Mask eq(Vec a, Vec b) { return a == b; }
+  inline Mask isnan(Vec a) { return std::isnan(a); }
+  inline Vec select(Mask m, Vec a, Vec b) { return m ? a : b; }
+  inline bool any(Mask m) { return m; }
+
+  // converting NaN or infinite values to int is undefined behavior, e.g. with exp(NaN): they get 2^n through exp2
+  inline Vec pow2(Vec n) { return std::isfinite(n) ? std::ldexp(1., int(std::clamp(n, -2100., 2100.))) : std::exp2(n); }
+
+  // frexp gives zero and non-finite values back as is, unlike ilogb whose results for them can't be negated
+  inline Vec exponent(Vec a)
+  {
+    int e = 0;
+    std::frexp(a, &e);
+    return std::isfinite(a) and a != 0 ? double(e - 1) : 0.;
+  }
+  inline Vec mantissa(Vec a)
+  {
+    int e = 0;
+    return 2 * std::frexp(a, &e);
+  }
+
+#endif
+
+  /// @brief applies a[i] = op(a[i]) over the vector lanes, then the scalar tail with 'scalar_op'
+  template <class VecOp, class ScalarOp>
+  void apply(double* a, size_t n, VecOp&& op, ScalarOp&& scalar_op)
+  {
+    size_t i = 0;
+    for (; i + width <= n; i += width)
+      store(a + i, op(load(a + i)));
+    for (; i < n; i++)
+      a[i] = scalar_op(a[i]);
+  }
+
+  /// @brief applies a[i] = op(a[i], b[i]) over the vector lanes, then the scalar tail with 'scalar_op'
+  template <class VecOp, class ScalarOp>
+  void apply(double* a, const double* b, size_t n, VecOp&& op, ScalarOp&& scalar_op)
+  {
+    size_t i = 0;
+    for (; i + width <= n; i += width)
+      store(a + i, op(load(a + i), load(b + i)));
+    for (; i < n; i++)
+      a[i] = scalar_op(a[i], b[i]);
+  }
+
+  // approximations of transcendental functions, written once over the primitives above:
+  //  - pow2(n) is 2^n for an integer 'n' in [-1022, 1023]
+  //  - 'x = mantissa(x) * 2^exponent(x)' with mantissa(x) in [1, 2), for positive normal numbers 'x'
+
+  /// @brief evaluates the polynomial of coefficients 'coefs', highest degree first, at 'x'
+  template <size_t N>
+  Vec horner(Vec x, const std::array<double, N>& coefs)
+  {
+    Vec res = set1(coefs[0]);
+    for (size_t i = 1; i < N; i++)
+      res = add(mul(res, x), set1(coefs[i]));
+    return res;
+  }
+
+  /// @brief returns the first lane of 'a'
+  inline double first(Vec a)
+  {
+    std::array<double, width> vals;
+    store(vals.data(), a);
+    return vals[0];
+  }
+
+  /// @brief applies 'scalar_op' on each lane of 'a'
+  template <class ScalarOp>
+  Vec per_lane(Vec a, ScalarOp&& scalar_op)
+  {
+    std::array<double, width> vals;
+    store(vals.data(), a);
+    for (double& val: vals)
+      val = scalar_op(val);
+    return load(vals.data());
+  }
+
+  inline Vec exp(Vec x)
+  {
+    // out of this range, the result is either 0 or inf, NaNs are kept
+    x = min(set1(710.), max(set1(-746.), x));
+
+    // x = n ln(2) + r with |r| <= ln(2)/2, where ln(2) is split in two so that n * ln2_hi is exact
+    constexpr double ln2_hi = 6.93147180369123816490e-01, ln2_lo = 1.90821492927058770002e-10;
+    const Vec n = round(mul(x, set1(std::numbers::log2e)));
+    const Vec r = sub(sub(x, mul(n, set1(ln2_hi))), mul(n, set1(ln2_lo)));
+
+    // taylor series up to r^13: the remainder is below 2^-53
+    constexpr auto inverse_factorials = []
+    {
+      std::array<double, 14> coefs;
+      double factorial = 1;
+      for (size_t k = 0; k < coefs.size(); k++)
+      {
+        factorial *= std::max(k, size_t(1));
+        coefs[coefs.size() - 1 - k] = 1. / factorial;
+      }
+      return coefs;
+    }();
+    const Vec exp_r = horner(r, inverse_factorials);
+
+    // 2^n may not be a normal number: it is applied in two halves
+    const Vec n1 = floor(mul(n, set1(0.5)));
+    return mul(mul(exp_r, pow2(n1)), pow2(sub(n, n1)));
+  }
+
+  inline Vec log(Vec x)
+  {
+    // subnormal numbers are scaled up to normal ones
+    const Mask subnormal = lt(x, set1(std::numeric_limits<double>::min()));
+    const Vec y = select(subnormal, mul(x, set1(0x1p54)), x);
+
+    // y = m 2^e with m in [sqrt(2)/2, sqrt(2))
+    Vec m = mantissa(y);
+    Vec e = select(subnormal, sub(exponent(y), set1(54.)), exponent(y));
+    const Mask above_sqrt2 = gt(m, set1(std::numbers::sqrt2));
+    m = select(above_sqrt2, mul(m, set1(0.5)), m);
+    e = select(above_sqrt2, add(e, set1(1.)), e);
+
+    // ln(m) = 2 atanh(s) = 2 (s + s^3/3 + s^5/5 + ...) with s = (m-1)/(m+1), |s| <= 0.1716:
+    // the series up to s^21 has a remainder below 2^-53
+    const Vec s = div(sub(m, set1(1.)), add(m, set1(1.)));
+    constexpr auto coefs = []
+    {
+      std::array<double, 11> coefs;
+      for (size_t k = 0; k < coefs.size(); k++)
+        coefs[coefs.size() - 1 - k] = 2. / double(2 * k + 1);
+      return coefs;
+    }();
+    const Vec log_m = mul(horner(mul(s, s), coefs), s);
+
+    constexpr double ln2_hi = 6.93147180369123816490e-01, ln2_lo = 1.90821492927058770002e-10;
+    Vec res = add(mul(e, set1(ln2_hi)), add(log_m, mul(e, set1(ln2_lo))));
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    res = select(eq(x, set1(0.)), set1(-inf), res);
+    res = select(lt(x, set1(0.)), set1(std::numeric_limits<double>::quiet_NaN()), res);
+    res = select(eq(x, set1(inf)), x, res);
+    return select(isnan(x), x, res);
+  }
+
+  /// @brief sin(x + quadrant * pi/2), 'quadrant' being 0 (sin) or 1 (cos)
+  inline Vec sin(Vec x, double quadrant)
+  {
+    // x = n pi/2 + r with |r| <= pi/4, where pi/2 is split in three so that n * pio2_1 and n * pio2_2 are exact
+    constexpr double pio2_1 = 1.57079632673412561417e+00, pio2_2 = 6.07710050630396597660e-11,
+                     pio2_2t = 2.02226624879595063154e-21;
+    const Vec n = round(mul(x, set1(2 / std::numbers::pi)));
+    const Vec r = sub(sub(sub(x, mul(n, set1(pio2_1))), mul(n, set1(pio2_2))), mul(n, set1(pio2_2t)));
+    const Vec z = mul(r, r);
+
+    // minimax polynomials of fdlibm's __kernel_sin and __kernel_cos
+    const Vec sin_r = add(r, mul(mul(r, z), horner(z, std::array{1.58969099521155010221e-10,
+                                                                 -2.50507602534068634195e-08,
+                                                                 2.75573137070700676789e-06,
+                                                                 -1.98412698298579493134e-04,
+                                                                 8.33333333332248946124e-03,
+                                                                 -1.66666666666666324348e-01})));
+    const Vec hz = mul(z, set1(0.5));
+    const Vec w = sub(set1(1.), hz);
+    const Vec cos_r = add(w, add(sub(sub(set1(1.), w), hz),
+                                 mul(mul(z, z), horner(z, std::array{-1.13596475577881948265e-11,
+                                                                     2.08757232129817482790e-09,
+                                                                     -2.75573143513906633035e-07,
+                                                                     2.48015872894767294178e-05,
+                                                                     -1.38888888888741095749e-03,
+                                                                     4.16666666666666019037e-02}))));
+
+    // q = (n + quadrant) mod 4 gives which of sin(r), cos(r), -sin(r), -cos(r) is the result
+    const Vec k = add(n, set1(quadrant));
+    const Vec q = sub(k, mul(floor(mul(k, set1(0.25))), set1(4.)));
+    Vec res = select(eq(sub(q, mul(floor(mul(q, set1(0.5))), set1(2.))), set1(1.)), cos_r, sin_r);
+    res = select(gt(q, set1(1.5)), neg(res), res);
+
+    // the reduction above is exact for |n| < 2^20, libm takes care of the rare larger inputs
+    const Mask large = gt(abs(x), set1(0x1p18 * std::numbers::pi));
+    if (any(large)) [[unlikely]]
+      res = select(large, per_lane(x, [&](double val) { return quadrant == 0. ? std::sin(val) : std::cos(val); }), res);
+
+    return res;
+  }
+
+  inline Vec sin(Vec x)
+  {
+    // keeps the sign of zero
+    return select(eq(x, set1(0.)), x, sin(x, 0.));
+  }
+
+  inline Vec cos(Vec x)
+  {
+    return sin(x, 1.);
+  }
+
+} // namespace simd
+
+} // namespace zc
@@ -22,4 +22,5 @@
 
 #include <zecalculator/evaluation/evaluation.h>
 #include <zecalculator/math_objects/aliases.h>
+#include <zecalculator/math_objects/sampling.h>
 #include <zecalculator/mathworld/mathworld.h>
@@ -42,20 +42,20 @@ int main()
 
     expect(bool(expect_node)) << expect_node << fatal;
 
-    AST expected_node = ast::Node::make_func(
+    AST expected_node = AST::make_func(
       AST::Func::OP_ADD,
       tokens::Text{"+", 1},
       tokens::Text{expression, 0},
-      {ast::Node::make_number(tokens::Text{"2", 0}, 2.0),
-       ast::Node::make_func(AST::Func::OP_MULTIPLY,
-                            tokens::Text{"*", 3},
-                            tokens::Text{"2*2", 2},
-                            {ast::Node::make_number(tokens::Text{"2", 2}, 2.0),
-                             ast::Node::make_number(tokens::Text{"2", 4}, 2.0)})});
+      {AST::make_number(tokens::Text{"2", 0}, 2.0),
+       AST::make_func(AST::Func::OP_MULTIPLY,
+                      tokens::Text{"*", 3},
+                      tokens::Text{"2*2", 2},
+                      {AST::make_number(tokens::Text{"2", 2}, 2.0),
+                       AST::make_number(tokens::Text{"2", 4}, 2.0)})});
 
     expect(*expect_node == expected_node) << *expect_node;
 
-    expect(direct_dependencies(*expect_node).empty());
+    expect(direct_dependencies(*expect_node, expression).empty());
 
   };
 
@@ -75,7 +75,7 @@ int main()
 
     expect(*expect_node == expected_node) << *expect_node;
 
-    expect(direct_dependencies(*expect_node).empty());
+    expect(direct_dependencies(*expect_node, expression).empty());
 
   };
 
@@ -129,6 +129,106 @@ int main()
 
   };
 
+  "power chain & unary minus"_test = []()
+  {
+    // operators are left associative, a unary minus after '^' only takes the next operand
+    std::string expression = "2^-a^b";
+
+    auto expect_node = tokenize(expression).and_then(make_ast{expression});
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    AST expected_node
+      = AST::make_func(AST::Func::OP_POWER,
+                       tokens::Text{"^", 4},
+                       tokens::Text{expression, 0},
+                       {AST::make_func(AST::Func::OP_POWER,
+                                       tokens::Text{"^", 1},
+                                       tokens::Text{"2^-a", 0},
+                                       {AST::make_number(tokens::Text{"2", 0}, 2.),
+                                        AST::make_func(AST::Func::OP_UNARY_MINUS,
+                                                       tokens::Text{"-", 2},
+                                                       tokens::Text{"-a", 2},
+                                                       {AST::make_var(tokens::Text{"a", 3})})}),
+                        AST::make_var(tokens::Text{"b", 5})});
+
+    expect(*expect_node == expected_node) << *expect_node;
+
+  };
+
+  "separators as operands"_test = []()
+  {
+    // the right hand side of an operation is checked first
+    std::string expression = "(1,2)*3+(4,5)*6";
+
+    auto expect_node = tokenize(expression).and_then(make_ast{expression});
+
+    expect(not expect_node and expect_node.error() == zc::Error::unexpected(tokens::Text{",", 10}, expression))
+      << expect_node;
+
+    // functions and unary minus can take separators
+    std::string expression2 = "f(1,2) - (3,4)";
+    expect(tokenize(expression2).and_then(make_ast{expression2}).error()
+           == zc::Error::unexpected(tokens::Text{",", 11}, expression2));
+
+    std::string expression3 = "f(-(1,2))";
+    expect(bool(tokenize(expression3).and_then(make_ast{expression3})));
+  };
+
+  "long expression"_test = []()
+  {
+    std::string expression = "0";
+    for (int i = 1; i != 3000; i++)
+      expression += (i % 2 ? "+x*" : "-cos(x)^") + std::to_string(i);
+
+    auto expect_node = tokenize(expression).and_then(make_ast{expression, std::array{"x"}});
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    // left associative: the root is the last operation, the whole expression being its span
+    expect((*expect_node)->name == tokens::Text{"+", expression.rfind('+')});
+    expect((*expect_node)->func_data().full_expr == tokens::Text{expression, 0});
+  };
+
+  "deeply nested expression"_test = []()
+  {
+    std::string expression = "x";
+    for (int i = 0; i != 2000; i++)
+      expression = "cos(" + expression + "+1)";
+
+    auto expect_node = tokenize(expression).and_then(make_ast{expression});
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    // the texts of the tree are positions in the expression instead of copies of it at every level
+    AST::Ref node = *expect_node;
+    for (int i = 0; i != 2000; i++)
+    {
+      expect(node->func_data().full_expr == tokens::Text(4 * i, expression.size() - 7 * i)) << fatal;
+      node = node.subnodes()[0].subnodes()[0];
+    }
+    expect(node->name == tokens::Text{"x", 4 * 2000});
+    expect(node->name.in(expression) == "x");
+  };
+
+  "long separator list"_test = []()
+  {
+    std::string expression = "f(0";
+    for (int i = 1; i != 3000; i++)
+      expression += "," + std::to_string(i);
+    expression += ")";
+
+    auto expect_node
+      = tokenize(expression).and_then(make_ast{expression}).transform(flatten_separators);
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    auto args = expect_node->subnodes();
+    expect(args.size() == 3000_ul) << fatal;
+    for (size_t i = 0; i != args.size(); i++)
+      expect(args[i]->is_number() and args[i]->number_data().value == double(i)) << fatal;
+  };
+
   "function expression"_test = []()
   {
     std::string expression = "(cos(sin(x)+1))+1";
@@ -157,7 +257,7 @@ int main()
 
     expect(*expect_node == expected_node) << *expect_node;
 
-    expect(direct_dependencies(*expect_node)
+    expect(direct_dependencies(*expect_node, expression)
            == zc::Deps{{"cos", {zc::Dep::FUNCTION}},
                              {"sin", {zc::Dep::FUNCTION}}});
 
@@ -172,17 +272,22 @@ int main()
     expect(bool(simple_ast)) << simple_ast << fatal;
 
     // "x" is considered a variable for now
-    expect(direct_dependencies(simple_ast.value())
+    expect(direct_dependencies(simple_ast.value(), expression)
            == zc::Deps{{"cos", {zc::Dep::FUNCTION}},
                              {"sin", {zc::Dep::FUNCTION}},
                              {"x", {zc::Dep::VARIABLE}}});
 
-    auto expect_node = simple_ast.transform(mark_input_vars{std::array{"x"}});
+    auto expect_node = simple_ast.transform(mark_input_vars{expression, std::array{"x"}});
 
     expect(bool(expect_node)) << expect_node << fatal;
 
     // "x" became an "input variable" and therefore not an external dependency anymore
-    expect(direct_dependencies(expect_node.value())
+    expect(direct_dependencies(expect_node.value(), expression)
+           == zc::Deps{{"cos", {zc::Dep::FUNCTION}},
+                             {"sin", {zc::Dep::FUNCTION}}});
+
+    // same without marking them first
+    expect(direct_dependencies(simple_ast.value(), expression, std::array{"x"})
            == zc::Deps{{"cos", {zc::Dep::FUNCTION}},
                              {"sin", {zc::Dep::FUNCTION}}});
 
@@ -207,6 +312,33 @@ int main()
 
   };
 
+  "non finite numbers written back"_test = []()
+  {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+    // e.g. folded by differentiate
+    AST tree = AST::make_func(AST::Func::OP_POWER,
+                              tokens::Text{"^", 1},
+                              tokens::Text{"a^b+c", 0},
+                              {AST::make_number(tokens::Text{"a", 0}, -inf),
+                               AST::make_func(AST::Func::OP_ADD,
+                                              tokens::Text{"+", 3},
+                                              tokens::Text{"b+c", 2},
+                                              {AST::make_number(tokens::Text{"b", 2}, nan),
+                                               AST::make_number(tokens::Text{"c", 4}, inf)})});
+
+    const std::string expression = to_expression(tree, "a^b+c");
+    expect(expression == "(-1/0)^((0/0)+(1/0))") << expression;
+
+    zc::MathWorld<Type::FAST> world;
+    const auto res = world.evaluate(expression);
+    expect(bool(res)) << res << fatal;
+    expect(std::isnan(*res));
+
+    expect(world.evaluate(to_expression(AST::make_number(tokens::Text{"a", 0}, -inf), "a")).value() == -inf);
+  };
+
   "direct dependencies"_test = []()
   {
     std::string expression = "(cos(sin(x)+1+w)/u(f(h(y))))+1+cos(x)+f(y)+u(w)";
@@ -215,7 +347,7 @@ int main()
 
     expect(bool(expect_node)) << expect_node << fatal;
 
-    expect(direct_dependencies(expect_node.value())
+    expect(direct_dependencies(expect_node.value(), expression)
            == zc::Deps{{"cos", {zc::Dep::FUNCTION}},
                              {"sin", {zc::Dep::FUNCTION}},
                              {"w", {zc::Dep::VARIABLE}},
@@ -0,0 +1,71 @@
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/zecalculator.h>
+
+// testing specific headers
+#include <zecalculator/test-utils/print-utils.h>
+#include <boost/ut.hpp>
+#include <zecalculator/parsing/data_structures/bytecode.h>
+
+using namespace zc::parsing;
+
+int main()
+{
+  using namespace boost::ut;
+
+  "simple bytecode expression"_test = []()
+  {
+    std::string expression = "2 - 3 + 2";
+
+    zc::MathWorld<Type::BYTECODE> world;
+
+    auto expect_tree = tokenize(expression)
+                         .and_then(make_ast{expression})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<Type::BYTECODE>{expression, world});
+
+    expect(bool(expect_tree)) << expect_tree << fatal;
+
+    auto program = make_bytecode(expect_tree.value());
+
+    using bytecode::OpCode;
+
+    // registers: [ 2 | 3 | temporary ]
+    Bytecode expected_program;
+    expected_program.constants = {2.0, 3.0};
+    expected_program.instructions = {{OpCode::SUBTRACT, 2, 0, 1}, {OpCode::ADD, 2, 2, 0}};
+    expected_program.registers_num = 3;
+    expected_program.result = 2;
+
+    expect(bool(program == expected_program));
+  };
+
+  "bytecode function call"_test = []()
+  {
+    zc::MathWorld<Type::BYTECODE> world;
+    world.new_object() = "f(x, y) = x * y";
+    auto& g = world.new_object() = "g(x) = f(x + 1, 2) + x";
+
+    expect(bool(g)) << fatal;
+
+    expect(g({3.0}).value() == 11.0_d);
+  };
+}
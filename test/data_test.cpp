@@ -35,7 +35,7 @@ int main()
 
   "simple data"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data(line)", {"1.0", "2.0*line", "data(0)+data(1)"});
@@ -49,11 +49,11 @@ int main()
     expect(*data({1}) == 2.0_d);
     expect(*data({2}) == 3.0_d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "unexpected name expressions"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object();
@@ -78,11 +78,11 @@ int main()
     expect(data.error() == zc::Error::unexpected(Token::Variable("x", 5), "data(x,y,z)"))
       << data.error() << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "dependent expressions"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -139,11 +139,11 @@ int main()
     expect(data({2}).value() == 11.0_d);
     expect(g({2}).value() == 4.0_d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "set value in empty data object"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set_name("data");
@@ -155,11 +155,11 @@ int main()
     expect(data({10}).value() == 10.0_d);
     expect(data({4}).error() == zc::Error::empty_expression());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "set many data points"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -176,11 +176,11 @@ int main()
     for (size_t i = 0 ; i < expected_vals.size() ; i++)
       expect(expected_vals[i] == data({double(i)}).value());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "insert many data points"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -197,11 +197,11 @@ int main()
     for (size_t i = 0 ; i < expected_vals.size() ; i++)
       expect(expected_vals[i] == data({double(i)}).value());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "append many data points"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -218,11 +218,11 @@ int main()
     for (size_t i = 0 ; i < expected_vals.size() ; i++)
       expect(expected_vals[i] == data({double(i)}).value());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "insert one data point"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -239,11 +239,11 @@ int main()
     for (size_t i = 0 ; i < expected_vals.size() ; i++)
       expect(expected_vals[i] == data({double(i)}).value());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "insert one data point above current size"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -254,11 +254,11 @@ int main()
 
     expect(data.get_data_size().value() == 16) << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "remove many data points"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& data = world.new_object().set("data", std::vector<std::string>(10, "1"));
@@ -280,11 +280,11 @@ int main()
     for (size_t i = 0 ; i < expected_vals.size() ; i++)
       expect(expected_vals[i] == data({double(i)}).value());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "play with dependencies"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -310,6 +310,31 @@ int main()
     expect(bool(data1)) << [&]{ return data1.error(); } << fatal;
     expect(bool(data2)) << [&]{ return data2.error(); } << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "data points moved around keep relinking"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+
+    auto& a = (world.new_object() = "a = 1");
+    auto& data = world.new_object().set("data", std::vector<std::string>{"a", "a+1"});
+
+    // short strings get moved around, along with the text they hold
+    data.insert_data_points(0, std::vector<std::string>(100, "2*a"));
+    data.insert_data_point(50, "a+3");
+    data.remove_data_points(10, 20);
+
+    a = "a = 2";
+
+    expect(bool(data)) << [&]{ return data.error(); } << fatal;
+    expect(data.get_data_size().value() == 83) << fatal;
+    expect(data({0}).value() == 4.);
+    expect(data({30}).value() == 5.);
+    expect(data({81}).value() == 2.);
+    expect(data({82}).value() == 3.);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
 }
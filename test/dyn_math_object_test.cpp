@@ -37,7 +37,7 @@ int main()
 
   "rename CppFunction"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -59,11 +59,11 @@ int main()
 
     expect(bool(f));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "rename Function"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -94,11 +94,37 @@ int main()
     expect(bool(g));
     expect(bool(data({0})) and bool(data({1}))) << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "copied objects read their own strings"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+
+    // short names and equations: the strings keep their text inline, a copy must read its own
+    auto& f = world.new_object() = "f(x) = g(x)";
+    auto& u = world.new_object() = "u(n) = 0 ; f(n)";
+
+    std::optional<DynMathObject<type>> f_copy = f, u_copy = u;
+    DynMathObject<type> f_moved = std::move(*f_copy);
+    f_copy.reset();
+
+    f = "h(y) = 2*y";
+    u = "v(k) = k";
+
+    expect(f_moved.get_name() == "f");
+    expect(f_moved.get_input_var_names() == std::vector<std::string>{"x"});
+    expect(f_moved.direct_dependencies() == Deps{{"g", {Dep::FUNCTION}}});
+
+    expect(u_copy->get_name() == "u");
+    expect(u_copy->direct_dependencies() == Deps{{"f", {Dep::FUNCTION}}});
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "rename Function without input vars"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -114,11 +140,11 @@ int main()
     expect(not bool(f)) << fatal;
     expect(f.error() == zc::Error::undefined_variable(Text{"x", 11}, "new_f= cos(x)")) << f.error();
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "rename Data"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -142,11 +168,11 @@ int main()
 
     expect(bool(f)) << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "fighting for the same name"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -177,11 +203,11 @@ int main()
     expect(bool(f3));
 
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "revision updates"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -239,12 +265,12 @@ int main()
     expect(g.get_revision() == 6_u) << fatal;
     expect(h.get_revision() == 6_u) << fatal;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
 
   "sequence & data revision updates"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     eval::Cache cache;
@@ -278,6 +304,6 @@ int main()
     expect(cache[g.get_slot()].get_cached_revision() == 3_u);
     expect(cache[h.get_slot()].get_cached_revision() == 3_u);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
 }
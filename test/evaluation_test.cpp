@@ -37,27 +37,27 @@ int main()
 
   "simple function evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
     expect(world.evaluate("cos(2)").value() == std::cos(2.0));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "simple expression evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
     expect(world.evaluate("2+2*2").value() == 6._d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "operator same priority"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -68,23 +68,21 @@ int main()
     expect(world.evaluate("2-2+2+2").value() == 4._d);
     expect(world.evaluate("2-2+2-2").value() == 0._d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "complex expression evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST
-                                                                        : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
     expect(world.evaluate("2/3+2*2*exp(2)^2.5").value() == 2./3.+2.*2.*std::pow(std::exp(2.), 2.5));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "unary minus evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST
-                                                                        : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -108,32 +106,32 @@ int main()
     expect(world.evaluate("2-(-(-cos(math::pi)))*2").value() == 4.);
     expect(world.evaluate("0+-2^-2").value() == -0.25);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "global constant expression evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
     expect(world.evaluate("2*math::π + math::pi/2").value() == 2.5 * std::numbers::pi);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "global constant registering and evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     world.new_object() = "my_constant1 = 2.0";
     world.new_object() = "my_constant2 = 3.0";
 
     expect(world.evaluate("my_constant1 + my_constant2").value() == 5.0_d);
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "undefined global constant"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -147,11 +145,11 @@ int main()
                                             expression))
       << error;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "input var evaluation shadowing a global constant"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     world.new_object() = "x  =   2.0";
@@ -164,24 +162,24 @@ int main()
 
     expect(res == expected_res);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "wrong object type: function as variable"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
     auto error = world.evaluate("2 + cos").error();
 
     expect(error.type == Error::WRONG_OBJECT_TYPE);
-    expect(error.token == parsing::tokens::Text{"cos", 4});
+    expect(error.token == parsing::tokens::OwnedText{"cos", 4});
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "min/max"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -189,24 +187,24 @@ int main()
 
     expect(res == 0._d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "wrong object type: variable as function"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     world.new_object() = "g = 3";
 
     auto error = world.evaluate("7 + g(3)").error();
     expect(error.type == Error::WRONG_OBJECT_TYPE);
-    expect(error.token == parsing::tokens::Text{"g", 4});
+    expect(error.token == parsing::tokens::OwnedText{"g", 4});
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "random separators"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -215,11 +213,11 @@ int main()
     expect(not bool(world.evaluate("cos(,3)")));
     expect(not bool(world.evaluate("sin(3;3)")));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
-  "AST/FAST/RPN creation speed"_test = []<class StructType>()
+  "AST/FAST/RPN/BYTECODE creation speed"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
     MathWorld<type> world;
 
     constexpr std::string_view static_expr = "2+ 3 -  cos(x) - 2 + 3 * 2.5343E+12-34234+2-4 * 34 / 634534           + 45.4E+2";
@@ -241,28 +239,38 @@ int main()
       if constexpr (std::is_same_v<StructType, AST_TEST>)
       {
         auto exp_ast = parsing::tokenize(expr).and_then(parsing::make_ast{expr});
-        if(exp_ast) dummy += exp_ast->dyn_data.index();
+        if(exp_ast) dummy += (*exp_ast)->dyn_data.index();
       }
       else if constexpr (std::is_same_v<StructType, FAST_TEST>)
       {
         auto exp_ast = parsing::tokenize(expr)
                          .and_then(parsing::make_ast{expr})
                          .and_then(parsing::make_fast<type>{expr, world});
-        if(exp_ast) dummy += exp_ast->node.index();
+        if(exp_ast) dummy += exp_ast->node().index();
       }
-      else
+      else if constexpr (std::is_same_v<StructType, RPN_TEST>)
       {
-        static_assert(std::is_same_v<StructType, RPN_TEST>);
         auto exp_ast = parsing::tokenize(expr)
                          .and_then(parsing::make_ast{expr})
                          .and_then(parsing::make_fast<type>{expr, world})
                          .transform(parsing::make_RPN);
         if(exp_ast) dummy += exp_ast->size();
       }
+      else
+      {
+        static_assert(std::is_same_v<StructType, BYTECODE_TEST>);
+        auto exp_ast = parsing::tokenize(expr)
+                         .and_then(parsing::make_ast{expr})
+                         .and_then(parsing::make_fast<type>{expr, world})
+                         .transform(parsing::make_bytecode);
+        if(exp_ast) dummy += exp_ast->instructions.size();
+      }
     });
 
-    constexpr std::string_view type_str_v = std::is_same_v<StructType, AST_TEST> ? "AST" :
-                                            std::is_same_v<StructType, FAST_TEST> ? "FAST" : "RPN";
+    constexpr std::string_view type_str_v = std::is_same_v<StructType, AST_TEST>    ? "AST"
+                                            : std::is_same_v<StructType, FAST_TEST> ? "FAST"
+                                            : std::is_same_v<StructType, RPN_TEST>  ? "RPN"
+                                                                                    : "BYTECODE";
 
     // the absolute value doesn't mean anything really, but we can compare between performance improvements
     std::cout << type_str_v << " creation time: "
@@ -270,5 +278,5 @@ int main()
               << std::endl;
     std::cout << "dummy: " << dummy << std::endl;
 
-  } | std::tuple<AST_TEST, FAST_TEST, RPN_TEST>{};
+  } | std::tuple<AST_TEST, FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 }
@@ -35,7 +35,7 @@ int main()
 
   "dependent expression"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     const double t = 3;
 
@@ -63,6 +63,6 @@ int main()
 
     expect(expr().value() == cpp_expr());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
 }
@@ -34,7 +34,7 @@ int main()
 
   "simple expression"_test = []<class StructType>()
   {
-    constexpr Type type = std::is_same_v<StructType, FAST_TEST> ? Type::FAST : Type::RPN;
+    constexpr Type type = parsing_type<StructType>;
 
     zc::MathWorld<type> world;
     std::string expression = "2+2*2";
@@ -55,11 +55,11 @@ int main()
 
     expect(*expect_node == expected_node) << *expect_node;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function expression"_test = []<class StructType>()
   {
-    constexpr Type type = std::is_same_v<StructType, FAST_TEST> ? Type::FAST : Type::RPN;
+    constexpr Type type = parsing_type<StructType>;
     zc::MathWorld<type> world;
 
     std::string expression = "(cos(sin(x)+1))+1";
@@ -85,5 +85,80 @@ int main()
 
     expect(*expect_node == expected_node) << *expect_node;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "constant folding"_test = []<class StructType>()
+  {
+    constexpr Type type = parsing_type<StructType>;
+    zc::MathWorld<type> world;
+
+    world.new_object().set("impure", zc::CppFunction{+[](double x) { return x; }});
+
+    std::string expression = "2*3 + cos(0) + x*(1-2^2) + impure(-1)";
+
+    auto expect_node = tokenize(expression)
+                         .and_then(make_ast{expression, std::array{"x"}})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<type>{expression, world})
+                         .transform(fold_constants<type>);
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    using T = FAST<type>;
+    using Node = shared::Node<type>;
+    using zc::utils::variant_convert;
+
+    // user defined functions are not folded, but their arguments are
+    FAST<type> expected_node = T{shared::node::Add{},
+                                 {T{shared::node::Add{},
+                                    {T{shared::node::Number{7.0}},
+                                     T{shared::node::Multiply{},
+                                       {T{shared::node::InputVariable{0}},
+                                        T{shared::node::Number{-3.0}}}}}},
+                                  T{variant_convert<Node>{}(*world.get("impure")->get_linked_repr()),
+                                    {T{shared::node::Number{-1.0}}}}}};
+
+    expect(*expect_node == expected_node) << *expect_node;
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "simplification"_test = []<class StructType>()
+  {
+    constexpr Type type = parsing_type<StructType>;
+    zc::MathWorld<type> world;
+
+    std::string expression = "x^3 * 1 - (-(-y))/4 + x^-0.5 + 0*x + x^-2";
+
+    auto expect_node = tokenize(expression)
+                         .and_then(make_ast{expression, std::array{"x", "y"}})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<type>{expression, world})
+                         .transform(fold_constants<type>)
+                         .transform(simplify<type>);
+
+    expect(bool(expect_node)) << expect_node << fatal;
+
+    using T = FAST<type>;
+    using namespace shared::node;
+
+    const T x = T{InputVariable{0}};
+    const T y = T{InputVariable{1}};
+
+    // 0*x is kept: it's -0 when x is negative, and NaN when x is infinite
+    // x^-0.5 is kept: 1/sqrt(x) differs from it when x is -0 or -inf
+    // x^-2 is kept: 1/(x*x) is 0 when x*x overflows
+    FAST<type> expected_node
+      = T{Add{},
+          {T{Add{},
+             {T{Add{},
+                {T{Subtract{},
+                   {T{Multiply{}, {T{Multiply{}, {x, x}}, x}},
+                    T{Multiply{}, {y, T{Number{0.25}}}}}},
+                 T{Power{}, {x, T{Number{-0.5}}}}}},
+              T{Multiply{}, {T{Number{0.0}}, x}}}},
+           T{Power{}, {x, T{Number{-2.}}}}}};
+
+    expect(*expect_node == expected_node) << *expect_node;
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 }
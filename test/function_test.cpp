@@ -26,7 +26,9 @@
 #include <zecalculator/test-utils/structs.h>
 #include <zecalculator/test-utils/utils.h>
 
+#include <bit>
 #include <numbers>
+#include <numeric>
 
 using namespace zc;
 using namespace std::literals;
@@ -37,7 +39,7 @@ int main()
 
   "multi-parameter function evaluation"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object() = "f(omega,t) = cos(omega * t) + omega * t";
@@ -57,11 +59,11 @@ int main()
     auto* obj = world.get("f");
     expect(obj && (*obj)({omega, t}).value() == expected_res);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function evaluation shadowing a global constant"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     world.new_object() = "x = 2.0";
@@ -81,11 +83,11 @@ int main()
     auto* f_obj = world.get("f");
     expect(f_obj && (*f_obj)({1.0}).value() == expected_res);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function calling another function"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f1 = world.new_object();
@@ -128,11 +130,11 @@ int main()
 
     if (bool(expected_res1))
       expect(std::fabs(expected_res1.value() - cpp_f1(x)) < 1e-11) << expected_res1.value() << " = " << cpp_f1(x);
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function overwrites"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -175,11 +177,11 @@ int main()
     expect(f({3}).value() == cpp_f_2(3));
     expect((*f_obj)({3}).value() == cpp_f_2(3));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "nested multi-variable functions"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -209,11 +211,106 @@ int main()
     auto* f_obj = world.get("f");
     expect(f_obj && (*f_obj)({x, y}).value() == cpp_f(x, y));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "inlined function calls"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    expect(world.get_inlining());
+
+    auto& g = world.new_object() = "g(x, y) = x*y + x";
+    auto& h = world.new_object() = "h(x) = x + h(x-1)";
+    auto& f = world.new_object() = "f(x) = g(x, 3) - g(2, x) + h(x)";
+
+    expect(bool(g) and bool(h) and bool(f)) << fatal;
+
+    auto calls = [](const auto& obj)
+    {
+      const auto& repr = std::get<const parsing::LinkedFunc<type>*>(*obj.get_linked_repr())->repr;
+      return std::ranges::count_if(repr,
+                                   [](auto&& node)
+                                   { return std::holds_alternative<const parsing::LinkedFunc<type>*>(node); });
+    };
+
+    // g is inlined, the recursive function h is not
+    if constexpr (type == parsing::Type::RPN)
+      expect(calls(f) == 1);
+
+    // the caller follows the changes of the callees
+    h = "h(x) = 10*x";
+    expect(bool(f)) << fatal;
+
+    if constexpr (type == parsing::Type::RPN)
+      expect(calls(f) == 0);
+
+    expect(f({5.}).value() == 5*3 + 5 - (2*5 + 2) + 50);
+
+    g = "g(x, y) = x - y";
+    expect(f({5.}).value() == 5 - 3 - (2 - 5) + 50);
+
+    world.set_inlining(false);
+    expect(not world.get_inlining());
+
+    if constexpr (type == parsing::Type::RPN)
+      expect(calls(f) == 3);
+
+    expect(f({5.}).value() == 5 - 3 - (2 - 5) + 50);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "inlining keeps the arguments that must be evaluated"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+
+    static size_t calls = 0;
+    world.new_object().set("counted", CppFunction{+[](double x) { calls++; return x; }});
+    world.new_object() = "one(x) = cos(0)";
+    world.new_object() = "twice(x) = x + x";
+    world.new_object() = "u(n) = 0 ; u(n-1) + 1";
+    world.new_object() = "r(x) = r(x) + 1";
+
+    auto& f = world.new_object() = "f(n) = one(u(n))";
+    auto& g = world.new_object() = "g(x) = one(r(x))";
+    auto& h = world.new_object() = "h(x) = one(counted(x)) + twice(counted(x))";
+    auto& k = world.new_object() = "k(x) = one(cos(x)) + twice(sin(x))";
+
+    // recursive: it does not get inlined, and is called as a leaf
+    world.new_object() = "loop = loop + 1";
+    auto& l = world.new_object() = "l(x) = one(loop) + twice(loop)";
+
+    expect(f and g and h and k and l) << fatal;
+
+    // errors of unused arguments are not dropped
+    eval::max_bottom_up_terms = 1000;
+    expect(f({1e6}).error() == Error::recursion_depth_overflow());
+    eval::max_bottom_up_terms = 10'000'000;
+    expect(f({-1.}).value() == 1.);
+    expect(g({1.}).error() == Error::recursion_depth_overflow());
+    expect(l({1.}).error() == Error::recursion_depth_overflow());
+
+    // C++ functions with side effects are called once per call, as written
+    expect(h({2.}).value() == 5.);
+    expect(calls == 2_u);
+
+    // pure arguments can still be dropped or duplicated
+    if constexpr (type == parsing::Type::RPN)
+    {
+      const auto& repr = std::get<const parsing::LinkedFunc<type>*>(*k.get_linked_repr())->repr;
+      expect(std::ranges::none_of(repr,
+                                  [](auto&& node)
+                                  { return std::holds_alternative<const parsing::LinkedFunc<type>*>(node); }));
+    }
+    expect(k({1.}).value() == 1 + 2 * std::sin(1.));
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function with dot in name"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -224,11 +321,11 @@ int main()
     expect(fx({1}).value() == 2.0);
     expect(fy().value() == 4.0);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "calling function with wrong number of arguments"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -242,11 +339,11 @@ int main()
     expect(res.error() == Error::mismatched_fun_args(parsing::tokens::Text{"1, 2, 3", 6}, var_expr))
       << res.error();
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "multi variable function"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -261,14 +358,333 @@ int main()
     expect(bool(res)) << fatal;
     expect(res.value() == 7_i);
 
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "batch evaluation"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    world.new_object() = "a = 3";
+    world.new_object() = "g(x, y) = x*y - a";
+    world.new_object() = "u(n) = 1 ; u(n-1) + 2";
+    auto& f = world.new_object() = "f(x) = 2*cos(x)^2 + g(x, x+1) / max(1, x) - u(3)";
+    auto& h = world.new_object() = "h(x, y) = g(y, x) + f(y)";
+
+    expect(f.has_value() and h.has_value()) << fatal;
+
+    // more points than the batch block size to exercise partial blocks
+    std::vector<double> xs(1000), ys(1000);
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+      xs[i] = 0.01 * double(i) - 3.;
+      ys[i] = std::sqrt(double(i));
+    }
+
+    std::vector<double> out(xs.size());
+    eval::Cache cache;
+
+    auto res = f.evaluate_batch(xs, out, &cache);
+    expect(bool(res)) << fatal;
+    for (size_t i = 0; i < xs.size(); i++)
+      expect(out[i] == f({xs[i]}).value()) << i;
+
+    res = h.evaluate_batch(std::array<std::span<const double>, 2>{xs, ys}, out);
+    expect(bool(res)) << fatal;
+    for (size_t i = 0; i < xs.size(); i++)
+      expect(out[i] == h({xs[i], ys[i]}).value()) << i;
+
+    // a workspace reused from one call to the next gives the same results
+    eval::BatchWorkspace workspace;
+    for (size_t call = 0; call != 2; call++)
+    {
+      std::ranges::fill(out, 0.);
+      res = h.evaluate_batch(std::array<std::span<const double>, 2>{xs, ys}, out, nullptr, &workspace);
+      expect(bool(res)) << fatal;
+      for (size_t i = 0; i < xs.size(); i++)
+        expect(out[i] == h({xs[i], ys[i]}).value()) << i;
+    }
+
+    // wrong number of input variables
+    res = h.evaluate_batch(xs, out);
+    expect(not res and res.error() == Error::cpp_incorrect_argnum());
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "batch evaluation calling functions with many arguments"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    // the calls are kept, instead of being inlined
+    MathWorld<type> world;
+    world.set_inlining(false);
+
+    world.new_object() = "k(x, y, z) = x*y - z";
+    auto& f = world.new_object() = "f(x) = k(x, 1, 2) + k(2, x, k(x, x, 3))";
+
+    expect(f.has_value()) << fatal;
+
+    std::vector<double> xs(300);
+    for (size_t i = 0; i < xs.size(); i++)
+      xs[i] = 0.1 * double(i) - 10.;
+
+    std::vector<double> out(xs.size());
+
+    auto res = f.evaluate_batch(xs, out);
+    expect(bool(res)) << fatal;
+    for (size_t i = 0; i < xs.size(); i++)
+      expect(out[i] == f({xs[i]}).value()) << i;
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "batch evaluation of builtin functions"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object()
+              = "f(x, y) = sqrt(x) + abs(x) * floor(y) - ceil(x) / max(x, y) + min(y, x)^2 - exp(-x)";
+
+    expect(f.has_value()) << fatal;
+
+    // odd number of points to exercise the scalar tail of the vector kernels
+    std::vector<double> xs = {0., -0., 1., -1., 2.5, -2.5, 1e300, -1e-300,
+                              std::numeric_limits<double>::infinity(),
+                              -std::numeric_limits<double>::infinity(),
+                              std::nan("")};
+    std::vector<double> ys = xs;
+    std::ranges::reverse(ys);
+    for (size_t i = 0; i < 30; i++)
+    {
+      xs.push_back(0.37 * double(i) - 5.);
+      ys.push_back(3. - 0.21 * double(i));
+    }
+
+    std::vector<double> out(xs.size());
+
+    auto res = f.evaluate_batch(std::array<std::span<const double>, 2>{xs, ys}, out);
+    expect(bool(res)) << fatal;
+    for (size_t i = 0; i < xs.size(); i++)
+      expect(std::bit_cast<uint64_t>(out[i]) == std::bit_cast<uint64_t>(f({xs[i], ys[i]}).value()))
+        << xs[i] << ys[i];
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "dual number evaluation"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    world.new_object() = "a = 3";
+    world.new_object() = "g(x, y) = x*y - a";
+    world.new_object() = "u(n) = 1 ; u(n-1) + 2";
+    auto& f = world.new_object() = "f(x) = 2*cos(x)^2 + g(x, x+1) / max(1, x) - u(3) + sqrt(exp(x))";
+    auto& h = world.new_object() = "h(x, y) = g(y, x) + x^y";
+
+    expect(f.has_value() and h.has_value()) << fatal;
+
+    auto df = [](double x)
+    {
+      const double g = x * (x + 1) - 3, dg = 2 * x + 1;
+      const double quotient_derivative = x > 1 ? (dg * x - g) / (x * x) : dg;
+      return -4 * std::cos(x) * std::sin(x) + quotient_derivative + std::sqrt(std::exp(x)) / 2;
+    };
+
+    for (double x: {-2.5, -0.3, 0.7, 1.5, 4.})
+    {
+      auto res = f.evaluate_dual({x}, 0);
+      expect(bool(res)) << fatal;
+      expect(res->value == f({x}).value()) << x;
+      expect(std::abs(res->derivative - df(x)) < 1e-10) << x;
+    }
+
+    // derivative with respect to each input variable
+    auto dh_dx = h.evaluate_dual({2., 3.}, 0);
+    auto dh_dy = h.evaluate_dual({2., 3.}, 1);
+    expect(bool(dh_dx) and bool(dh_dy)) << fatal;
+    expect(dh_dx->value == h({2., 3.}).value());
+    expect(std::abs(dh_dx->derivative - (3. + 3. * 4.)) < 1e-12);
+    expect(std::abs(dh_dy->derivative - (2. + 8. * std::log(2.))) < 1e-12);
+
+    // sequences are only defined over integers
+    auto* u = world.get("u");
+    expect(u and u->evaluate_dual({3.}, 0).value() == Dual{7., 0.});
+
+    // the variable index is out of range
+    auto res = h.evaluate_dual({2., 3.}, 2);
+    expect(not res and res.error() == Error::cpp_incorrect_argnum());
+
+    // user defined C++ functions have no known derivative, unless they do not depend on the variable
+    world.new_object().set("twice", CppFunction<1>{[](double x) { return 2 * x; }});
+    auto& k = world.new_object() = "k(x, y) = x*twice(y) + twice(3)";
+    expect(bool(k)) << fatal;
+
+    expect(k.evaluate_dual({2., 5.}, 0).value() == Dual{26., 10.});
+    res = k.evaluate_dual({2., 5.}, 1);
+    expect(not res and res.error() == Error::not_implemented());
+
   } | std::tuple<FAST_TEST, RPN_TEST>{};
 
+  "gradient evaluation"_test = []()
+  {
+    rpn::MathWorld world;
+    world.new_object() = "a = 3";
+    world.new_object() = "g(x, y) = x*y - a + g0(x)";
+    world.new_object() = "g0(x) = x";
+    world.new_object() = "u(n) = 1 ; u(n-1) + 2";
+    auto& f = world.new_object()
+              = "f(x, y, z) = g(x, z)^2 / (1 + y*y) + sqrt(x*z) * cos(y) - max(z, 2*x) + u(3) * y + exp(x+y+z)";
+
+    expect(bool(f)) << fatal;
+
+    // without inlining, the gradient also goes through function calls
+    for (auto [inlining, x, y, z]: {std::tuple{true, 0.5, -1., 2.},
+                                    {true, 1.5, 2., 0.3},
+                                    {false, 3., 0.1, 0.2},
+                                    {false, -0.5, 1., -2.}})
+    {
+      world.set_inlining(inlining);
+
+      std::array<double, 3> gradient;
+      auto res = f.evaluate_gradient({x, y, z}, gradient);
+      expect(bool(res)) << fatal;
+      expect(*res == f({x, y, z}).value());
+
+      // compare with forward mode, which differentiates one variable at a time
+      for (size_t i = 0; i < 3; i++)
+      {
+        auto dual = f.evaluate_dual({x, y, z}, i);
+        expect(bool(dual)) << fatal;
+        expect(std::abs(gradient[i] - dual->derivative) < 1e-9 * std::max(1., std::abs(gradient[i])))
+          << i << gradient[i] << dual->derivative;
+      }
+
+      // a workspace reused across evaluations gives the same results
+      eval::GradientWorkspace workspace;
+      for (size_t j = 0; j != 2; j++)
+      {
+        std::array<double, 3> reused_gradient;
+        expect(f.evaluate_gradient({x, y, z}, reused_gradient, nullptr, &workspace) == res);
+        expect(reused_gradient == gradient);
+      }
+      expect(workspace.frames.size() == (inlining ? 1_ul : 3_ul));
+    }
+
+    // the gradient has the wrong size
+    std::array<double, 2> gradient;
+    auto res = f.evaluate_gradient({1., 2., 3.}, gradient);
+    expect(not res and res.error() == Error::cpp_incorrect_argnum());
+
+    // user defined C++ functions have no known derivative, unless they do not depend on the inputs
+    world.new_object().set("twice", CppFunction<1>{[](double x) { return 2 * x; }});
+    auto& h = world.new_object() = "h(x, y) = twice(x) + y*twice(3)";
+
+    res = h.evaluate_gradient({1., 2.}, gradient);
+    expect(not res and res.error() == Error::not_implemented());
+
+    h = "h(x, y) = x*y + twice(3)";
+    res = h.evaluate_gradient({1., 2.}, gradient);
+    expect(bool(res)) << fatal;
+    expect(*res == 8. and gradient == std::array{2., 1.});
+  };
+
+  "jit compiled functions"_test = []()
+  {
+    auto is_jitted = [](const rpn::DynMathObject& obj)
+    {
+      using LinkedFunc = parsing::LinkedFunc<parsing::Type::RPN>;
+      auto repr = obj.get_linked_repr();
+      return repr and std::holds_alternative<const LinkedFunc*>(*repr)
+             and bool(std::get<const LinkedFunc*>(*repr)->jit);
+    };
+
+    auto define = [](rpn::MathWorld& world)
+    {
+      world.new_object() = "h = 2.5";
+      world.new_object() = "g(x, y) = x^2 - y/3 + cos(x) * h";
+      world.new_object() = "k = g(1, 2)";
+      world.new_object() = "u(n) = 1 ; u(n-1) * 2";
+      return std::array{&(world.new_object() = "f(x) = -g(x, 2*x) / h + max(x, 1) - 3/x + k^x"),
+                        &(world.new_object() = "p(x) = 2*x + u(3)")};
+    };
+
+    const bool jit_enabled = eval::jit::enabled;
+
+    eval::jit::enabled = false;
+    rpn::MathWorld rpn_world;
+    auto [rpn_f, rpn_p] = define(rpn_world);
+
+    eval::jit::enabled = jit_enabled;
+    rpn::MathWorld jit_world;
+    auto [jit_f, jit_p] = define(jit_world);
+
+    expect(not is_jitted(*rpn_f));
+    expect(is_jitted(*jit_f) == eval::jit::supported);
+
+    // calls a sequence: evaluated as RPN
+    expect(not is_jitted(*jit_p));
+    expect(jit_p->evaluate({1.}) == rpn_p->evaluate({1.}));
+
+    auto check_same_results = [&]
+    {
+      for (double x: {-3., -0.5, 0., 0.1, 1., 7.25, 1e10})
+        expect(std::bit_cast<uint64_t>(jit_f->evaluate({x}).value())
+               == std::bit_cast<uint64_t>(rpn_f->evaluate({x}).value())) << x;
+    };
+
+    check_same_results();
+
+    // relinking re-compiles the callers
+    for (rpn::MathWorld* world: {&rpn_world, &jit_world})
+      *world->get("g") = "g(x, y) = x * y + 1";
+
+    expect(is_jitted(*jit_f) == eval::jit::supported);
+    check_same_results();
+
+    // the callee calls a sequence now: callers fall back to RPN
+    for (rpn::MathWorld* world: {&rpn_world, &jit_world})
+      *world->get("g") = "g(x, y) = x * y + u(2)";
+
+    expect(not is_jitted(*jit_f));
+    check_same_results();
+
+    for (rpn::MathWorld* world: {&rpn_world, &jit_world})
+      *world->get("g") = "g(x, y) = x - y";
+
+    expect(is_jitted(*jit_f) == eval::jit::supported);
+    check_same_results();
+
+    // chains of calls deeper than the recursion depth limit give the same error as RPN
+    for (rpn::MathWorld* world: {&rpn_world, &jit_world})
+    {
+      world->set_inlining(false);
+      world->new_object() = "c0(x) = x + 1";
+      for (size_t i = 1; i <= eval::max_recursion_depth + 1; i++)
+        world->new_object() = "c" + std::to_string(i) + "(x) = c" + std::to_string(i - 1) + "(x) + 1";
+    }
+
+    const size_t max_depth = eval::max_recursion_depth;
+    for (std::string name: {"c" + std::to_string(max_depth), "c" + std::to_string(max_depth + 1)})
+    {
+      const auto* rpn_c = rpn_world.get(name);
+      const auto* jit_c = jit_world.get(name);
+      expect(is_jitted(*jit_c) == eval::jit::supported);
+      expect(jit_c->evaluate({1.}) == rpn_c->evaluate({1.})) << name;
+      expect(jit_world.evaluate(name + "(1) * 2") == rpn_world.evaluate(name + "(1) * 2")) << name;
+    }
+    expect(rpn_world.get("c" + std::to_string(max_depth))->evaluate({1.}).value() == double(max_depth + 2));
+    expect(rpn_world.get("c" + std::to_string(max_depth + 1))->evaluate({1.}).error()
+           == Error::recursion_depth_overflow());
+  };
+
   "function benchmark"_test = []<class StructType>()
   {
     constexpr auto duration = nanoseconds(500ms);
     {
-      constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
-      constexpr std::string_view data_type_str_v = std::is_same_v<StructType, FAST_TEST> ? "FAST" : "RPN";
+      constexpr parsing::Type type = parsing_type<StructType>;
+      constexpr std::string_view data_type_str_v = std::is_same_v<StructType, FAST_TEST>  ? "FAST"
+                                                   : std::is_same_v<StructType, RPN_TEST> ? "RPN"
+                                                                                          : "BYTECODE";
 
       MathWorld<type> world;
       auto& f = (world.new_object() = "f(x) =3*cos(3*x) + 2*sin(x/2) + 4");
@@ -284,6 +700,18 @@ int main()
                 << duration_cast<nanoseconds>(duration / iterations).count() << "ns"
                 << std::endl;
       std::cout << "dummy val: " << res << std::endl;
+
+      std::vector<double> xs(1024), out(1024);
+      std::iota(xs.begin(), xs.end(), 0.);
+      res = 0;
+      iterations =
+        loop_call_for(duration, [&]{
+          res += f.evaluate_batch(xs, out).has_value() ? out.back() : 0.;
+      });
+      std::cout << "Avg zc::Function<" << data_type_str_v << "> batch eval time: "
+                << duration_cast<nanoseconds>(duration / (iterations * xs.size())).count() << "ns"
+                << std::endl;
+      std::cout << "dummy val: " << res << std::endl;
     }
     {
       auto cpp_f = [](double x) {
@@ -303,11 +731,57 @@ int main()
 
     }
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "gradient benchmark"_test = []()
+  {
+    constexpr auto duration = nanoseconds(500ms);
+
+    rpn::MathWorld world;
+    auto& f = (world.new_object() = "f(x, y, z) = 3*cos(3*x) * y + 2*sin(x/2) / z + 4*x*y*z");
+    expect(bool(f)) << fatal;
+
+    // the gradient is recorded from the RPN program: compare with its evaluation without JIT
+    const auto& linked_f = *std::get<const parsing::LinkedFunc<parsing::Type::RPN>*>(*f.get_linked_repr());
+
+    double x = 0;
+    double res = 0;
+    size_t iterations =
+      loop_call_for(duration, [&]{
+        res += zc::evaluate(linked_f.repr, linked_f.stack_depth, std::array{x, 2., 3.}, 0, nullptr).value();
+        x++;
+    });
+    const auto eval_time = duration / iterations;
+    std::cout << "Avg zc::Function<RPN> eval time, without JIT: "
+              << duration_cast<nanoseconds>(eval_time).count() << "ns" << std::endl;
+
+    std::array<double, 3> gradient;
+    x = 0;
+    iterations =
+      loop_call_for(duration, [&]{
+        res += f.evaluate_gradient({x, 2., 3.}, gradient).value();
+        x++;
+    });
+    std::cout << "Avg zc::Function<RPN> gradient eval time: "
+              << duration_cast<nanoseconds>(duration / iterations).count() << "ns" << std::endl;
+
+    eval::GradientWorkspace workspace;
+    x = 0;
+    iterations =
+      loop_call_for(duration, [&]{
+        res += f.evaluate_gradient({x, 2., 3.}, gradient, nullptr, &workspace).value();
+        x++;
+    });
+    const auto gradient_time = duration / iterations;
+    std::cout << "Avg zc::Function<RPN> gradient eval time, reused workspace: "
+              << duration_cast<nanoseconds>(gradient_time).count() << "ns ("
+              << double(gradient_time.count()) / double(eval_time.count()) << "x eval time)" << std::endl;
+    std::cout << "dummy val: " << res + gradient[0] << std::endl;
+  };
 
   "sequence direct dependencies"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -319,11 +793,11 @@ int main()
     expect(seq.direct_dependencies()
            == Deps{{"u", {t}}, {"f", {t}}, {"cos", {t}}});
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "function direct dependencies"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -340,11 +814,11 @@ int main()
                          {"cos", {Dep::FUNCTION}},
                          {"math::pi", {Dep::VARIABLE}}}); // "u" and "f"
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "name of function in error state"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
 
@@ -352,6 +826,179 @@ int main()
 
     expect(f.get_name() == "f");
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "symbolic derivative"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+
+    world.new_object() = "g(y) = y^3";
+    world.new_object() = "f(x, y) = cos(2*x) * g(y) + x/y + 2^x";
+    auto& df_dx = world.derivative("f", "x", "df_dx");
+    auto& df_dy = world.derivative("f", "y", "df_dy");
+
+    expect(bool(df_dx) and bool(df_dy)) << fatal;
+    expect(df_dx.get_input_var_names() == std::vector<std::string>{"x", "y"});
+
+    auto check = [](double x, double y, double cos_coef)
+    {
+      return [=](const DynMathObject<type>& df_dx, const DynMathObject<type>& df_dy)
+      {
+        const double expected_dx = -2*sin(2*x) * cos_coef * y*y*y + 1/y + std::log(2) * std::pow(2, x);
+        const double expected_dy = cos(2*x) * cos_coef * 3*y*y - x/(y*y);
+        expect(std::abs(df_dx({x, y}).value() - expected_dx) < 1e-12 * (1 + std::abs(expected_dx)));
+        expect(std::abs(df_dy({x, y}).value() - expected_dy) < 1e-12 * (1 + std::abs(expected_dy)));
+      };
+    };
+
+    check(0.7, 1.3, 1.)(df_dx, df_dy);
+    check(-2.1, 0.4, 1.)(df_dx, df_dy);
+
+    // the derivative depends on the function it is derived from
+    expect(df_dx.direct_dependencies().contains("f"));
+
+    // and follows its changes, as well as the ones of the functions it calls
+    world.get("g")->operator = ("g(y) = 5*y^3");
+    check(0.7, 1.3, 5.)(df_dx, df_dy);
+
+    *world.get("f") = "f(x, y) = x*y";
+    expect(df_dx({2, 3}).value() == 3);
+    expect(df_dy({2, 3}).value() == 2);
+
+    // derivatives of user defined functions can be differentiated in turn
+    world.new_object() = "h(t) = sin(t)^2 + exp(-t) * sqrt(t)";
+    auto& dh = world.derivative("h", "t", "dh");
+    auto& d2h = world.derivative("dh", "t", "d2h");
+    expect(bool(dh) and bool(d2h)) << fatal;
+    const double t = 0.8;
+    expect(std::abs(dh({t}).value()
+                    - (2*sin(t)*cos(t) - std::exp(-t)*std::sqrt(t) + std::exp(-t)*0.5/std::sqrt(t)))
+           < 1e-12);
+    expect(std::abs(d2h({t}).value()
+                    - (2*cos(2*t) + std::exp(-t)*std::sqrt(t) - std::exp(-t)/std::sqrt(t)
+                       - std::exp(-t)*0.25/std::pow(t, 1.5)))
+           < 1e-12);
+
+    // same derivatives as automatic differentiation, also where the function is not differentiable
+    auto& a = world.new_object() = "a(x) = abs(x) + 2*sign(x)";
+    auto& da = world.derivative("a", "x", "da");
+    expect(bool(a) and bool(da)) << fatal;
+    for (double x: {-1.5, 0., 2.})
+    {
+      expect(da({x}).value() == sign(x)) << x;
+      if constexpr (type != parsing::Type::BYTECODE)
+        expect(da({x}).value() == a.evaluate_dual({x}, 0).value().derivative) << x;
+    }
+    expect(std::isnan(sign(std::nan(""))));
+    expect(std::isnan(da({std::nan("")}).value()));
+
+    // "sign" is a builtin name
+    auto& s = world.new_object() = "sign(x) = x";
+    expect(s.error() and s.error()->type == Error::NAME_ALREADY_TAKEN);
+
+    // errors
+    world.new_object() = "r(x) = x * r(x - 1)";
+    world.new_object() = "m(x) = max(x, 1)";
+    expect(not world.derivative("r", "x", "dr"));
+    expect(not world.derivative("m", "x", "dm"));
+    expect(not world.derivative("f", "z", "dz"));
+    expect(not world.derivative("unknown", "x", "du"));
+
+    // the derivative becomes valid once the function gets defined
+    world.new_object() = "unknown(x) = 3*x";
+    expect(world.get("du")->evaluate({1}).value() == 3);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "parallel batch evaluation"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    world.new_object() = "u(n) = 1 ; 2 ; u(n-1) + u(n-2)";
+    world.new_object() = "floor_mod(a, b) = a - b * floor(a / b)";
+    auto& f = world.new_object() = "f(x, y) = 3*cos(3*x) + 2*sin(y/2) + 4 + u(floor_mod(floor(x), 7))";
+
+    expect(bool(f)) << fatal;
+
+    const size_t n = 100'003;
+    std::vector<double> xs(n), ys(n), expected(n), out(n);
+    for (size_t i = 0; i != n; i++)
+    {
+      xs[i] = 0.001 * double(i);
+      ys[i] = -0.5 * double(i);
+    }
+
+    const std::array<std::span<const double>, 2> input_vars = {xs, ys};
+    expect(f.evaluate_batch(input_vars, expected).has_value()) << fatal;
+
+    eval::ThreadPool pool(4);
+    expect(pool.size() == 4_ul);
+
+    // the same pool runs several jobs, with chunks that do not split evenly between the workers
+    for (size_t chunk_size: {size_t(1000), size_t(4096), eval::parallel_chunk_size})
+    {
+      std::ranges::fill(out, 0.);
+      if constexpr (type == parsing::Type::RPN)
+        expect(evaluate_parallel(std::get<const parsing::LinkedFunc<type>*>(*f.get_linked_repr())->repr,
+                                 input_vars, out, pool, chunk_size).has_value());
+      else expect(f.evaluate_parallel(input_vars, out, pool).has_value());
+      expect(out == expected);
+    }
+
+    std::ranges::fill(out, 0.);
+    expect(f.evaluate_parallel(input_vars, out, pool).has_value());
+    expect(out == expected);
+
+    // errors: the one with the smallest index gets reported
+    world.new_object() = "v(n) = 0 ; 0 ; v(n+1)";
+    world.new_object().set("d(line)", {"0", "missing(line)", "0"});
+    auto& g = world.new_object() = "g(x) = v(x) + d(x)";
+    expect(bool(g)) << fatal;
+    std::vector<double> ns(n, 0.);
+    ns[n / 3] = 2.; // overflows the recursion depth
+    ns[n / 2] = 1.; // calls an undefined function
+    std::vector<double> g_out(n);
+    auto res = g.evaluate_parallel(ns, g_out, pool);
+    expect(not res.has_value() and res.error().type == Error::RECURSION_DEPTH_OVERFLOW);
+
+    ns[n / 3] = 0.;
+    res = g.evaluate_parallel(ns, g_out, pool);
+    expect(not res.has_value() and res.error().type == Error::UNDEFINED_FUNCTION);
+
+    // wrong sizes
+    std::vector<double> small_out(10);
+    expect(not f.evaluate_parallel(input_vars, small_out, pool).has_value());
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "work stealing thread pool"_test = []()
+  {
+    eval::ThreadPool pool(3);
+
+    // the first tasks take much longer: the workers that get them have their other tasks stolen
+    // note: expect() is not thread safe, tasks only record what gets checked once the job is done
+    std::vector<std::atomic<size_t>> runs(200);
+    std::atomic<bool> bad_worker = false;
+    pool.run(runs.size(), [&](size_t task, size_t worker)
+    {
+      if (worker >= 3)
+        bad_worker = true;
+      if (task < 5)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      runs[task]++;
+    });
+
+    expect(not bad_worker);
+    expect(std::ranges::all_of(runs, [](auto& r) { return r == 1; }));
+
+    // an empty job returns right away
+    std::atomic<bool> called = false;
+    pool.run(0, [&](size_t, size_t) { called = true; });
+    expect(not called);
+
+  };
 
 }
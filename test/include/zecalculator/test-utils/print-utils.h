@@ -26,10 +26,17 @@ std::ostream& operator<<(std::ostream& os,
 std::ostream& operator<<(std::ostream& os,
                          const zc::parsing::shared::Node<zc::parsing::Type::FAST>& node);
 
+std::ostream& operator<<(std::ostream& os,
+                         const zc::parsing::FAST<zc::parsing::Type::BYTECODE>& node);
+
+std::ostream& operator<<(std::ostream& os,
+                         const zc::parsing::shared::Node<zc::parsing::Type::BYTECODE>& node);
+
 std::ostream& operator << (std::ostream& os, const zc::parsing::AST& node);
 
 
 std::ostream& operator<<(std::ostream &, const zc::parsing::tokens::Text&);
+std::ostream& operator<<(std::ostream &, const zc::parsing::tokens::OwnedText&);
 
 std::ostream& operator << (std::ostream& os, zc::Dep::ObjectType type);
 
@@ -1,5 +1,18 @@
 #pragma once
 
+#include <type_traits>
+
+#include <zecalculator/parsing/types.h>
+
 struct AST_TEST {};
 struct FAST_TEST {};
 struct RPN_TEST {};
+struct BYTECODE_TEST {};
+
+/// @brief parsing type a FAST_TEST, RPN_TEST or BYTECODE_TEST test struct refers to
+template <class StructType>
+constexpr zc::parsing::Type parsing_type = std::is_same_v<StructType, FAST_TEST>
+                                             ? zc::parsing::Type::FAST
+                                             : std::is_same_v<StructType, RPN_TEST>
+                                                 ? zc::parsing::Type::RPN
+                                                 : zc::parsing::Type::BYTECODE;
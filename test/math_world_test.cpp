@@ -24,6 +24,9 @@
 #include <boost/ut.hpp>
 #include <zecalculator/test-utils/print-utils.h>
 #include <zecalculator/test-utils/structs.h>
+#include <zecalculator/test-utils/utils.h>
+
+#include <iostream>
 
 using namespace zc;
 using parsing::tokens::Text;
@@ -34,78 +37,78 @@ int main()
 
   "simple test"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto* cppFunc = world.get("sqrt");
     expect(cppFunc != nullptr and (*cppFunc)({4}) == 2);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add constant then set value"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& c1 = (world.new_object() = "my_constant1 = 42");
 
     expect(c1().value() == 42.0);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add same constant twice"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     world.new_object() = "my_constant1 = 2.0";
     expect(not (world.new_object() = "my_constant1 = 3.0"));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add constant with white spaces 1"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& cst = world.new_object() = "   my_constant1 = 2.0";
     expect(cst.get_name() == "my_constant1");
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add constant with white spaces 2"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& cst = world.new_object().set("  cst   ", {1.0});
     expect(cst.get_name() == "cst");
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add CppFunction with white spaces"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object().set(" better_cos   ", CppFunction<1>{std::cos});
     expect(f.get_name() == "better_cos");
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "Add CppFunction with invalid name"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object().set(" 1+1   ", CppFunction<1>{std::cos});
     expect(f.error() == zc::Error::unexpected(Text{"+", 2}, " 1+1   ")) << f.error();
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "erase object with pointer"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object() = "f(x) = cos(x)";
@@ -124,28 +127,28 @@ int main()
     expect(g.error().value().type == Error::UNDEFINED_FUNCTION
            and g.error().value().token.substr == "f") << g.error();
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "invalidity chain"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object() = "f(x) = g(x)+1";
 
     expect(not f.has_value()) << fatal;
     expect(f.error().value().type == Error::UNDEFINED_FUNCTION
-           and f.error().value().token == parsing::tokens::Text{.substr = "g", .begin = 7});
+           and f.error().value().token == parsing::tokens::OwnedText{"g", 7});
 
     auto& g = world.new_object() = "g(x) = z(x)+1";
 
     expect(not f.has_value()) << fatal;
     expect(f.error().value().type == Error::OBJECT_INVALID_STATE
-           and f.error().value().token == parsing::tokens::Text{.substr = "g", .begin = 7});
+           and f.error().value().token == parsing::tokens::OwnedText{"g", 7});
 
     expect(not g.has_value()) << fatal;
     expect(g.error().value().type == Error::UNDEFINED_FUNCTION
-           and g.error().value().token == parsing::tokens::Text{.substr = "z", .begin = 7});
+           and g.error().value().token == parsing::tokens::OwnedText{"z", 7});
 
     auto& z = world.new_object() = "z(x) = f(x)+1";
 
@@ -156,11 +159,11 @@ int main()
     auto res = z({1});
     expect(not res and res.error() == Error::recursion_depth_overflow()) << res;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "cannot erase object in the wrong world"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world1;
     world1.new_object() = "f(x) = cos(x)";
@@ -171,11 +174,11 @@ int main()
     // cannot erase 'g' in 'world1'
     expect(not bool(world1.erase(g)));
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "erase object by name"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object() = "f(x)=cos(x)";
@@ -195,7 +198,195 @@ int main()
     expect(not f.has_value() and f.error().value().type == Error::UNDEFINED_FUNCTION
            and f.error().value().token.substr == "cos");
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "constant folding toggle"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    expect(world.get_constant_folding());
+
+    // so cos(0)*x does not become x, and nodes do not get fused
+    world.set_simplification(false);
+    world.set_node_fusion(false);
+
+    auto& f = world.new_object() = "f(x) = 2*3 + cos(0)*x";
+    expect(f.has_value()) << [&]{ return f.error(); } << fatal;
+
+    auto rpn_size = [](const auto& obj)
+    {
+      return std::get<const parsing::LinkedFunc<type>*>(*obj.get_linked_repr())->repr.size();
+    };
+
+    if constexpr (type == parsing::Type::RPN)
+      expect(rpn_size(f) == 5_u);
+
+    expect(f({2.}).value() == 8.);
+    expect(world.evaluate("2^10 - f(1)").value() == 1017.);
+
+    world.set_constant_folding(false);
+    expect(not world.get_constant_folding());
+
+    // every object got relinked without folding
+    if constexpr (type == parsing::Type::RPN)
+      expect(rpn_size(f) == 8_u);
+
+    expect(f({2.}).value() == 8.);
+    expect(world.evaluate("2^10 - f(1)").value() == 1017.);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "simplification toggle"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    expect(world.get_simplification());
+
+    world.set_node_fusion(false);
+
+    auto& f = world.new_object() = "f(x) = x^2 * 1 + x/4";
+    expect(f.has_value()) << [&]{ return f.error(); } << fatal;
+
+    auto rpn_size = [](const auto& obj)
+    {
+      return std::get<const parsing::LinkedFunc<type>*>(*obj.get_linked_repr())->repr.size();
+    };
+
+    // x*x + x*0.25
+    if constexpr (type == parsing::Type::RPN)
+      expect(rpn_size(f) == 7_u);
+
+    expect(f({2.}).value() == 4.5);
+    expect(world.evaluate("f(2) - 2^-2").value() == 4.25);
+
+    // powers give the same results as std::pow for signed zeros and infinities
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    for (std::string n: {"0.5", "-0.5", "1.5", "2", "3", "-1", "-2", "-3"})
+    {
+      auto& p = world.new_object() = "p(x) = x^" + n;
+      expect(p.has_value()) << [&]{ return p.error(); } << fatal;
+
+      for (double x: {0., -0., inf, -inf})
+      {
+        const double res = p({x}).value(), expected = std::pow(x, std::stod(n));
+        expect(res == expected and std::signbit(res) == std::signbit(expected)) << n << x << res;
+      }
+
+      expect(bool(world.erase(p)));
+    }
+
+    // negative exponents are left to std::pow: x^8 overflows here
+    auto& q = world.new_object() = "q(x) = x^-8";
+    expect(q({1e40}).value() == std::pow(1e40, -8.));
+    expect(bool(world.erase(q)));
+
+    world.set_simplification(false);
+    expect(not world.get_simplification());
+
+    if constexpr (type == parsing::Type::RPN)
+      expect(rpn_size(f) == 9_u);
+
+    expect(f({2.}).value() == 4.5);
+    expect(world.evaluate("f(2) - 2^-2").value() == 4.25);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+
+  "prepared expression"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object() = "f(x) = 2*x + a";
+    auto& a = world.new_object() = "a = 1";
+    expect(f.has_value() and a.has_value()) << fatal;
+
+    auto expr = world.compile("f(x) * y + a", {"x", "y"});
+    expect(not expr.error());
+    expect(not expr.is_stale());
+    expect(expr.get_world_revision() == world.get_revision());
+
+    expect(expr({1., 3.}).value() == 10.);
+    expect(expr({2., -1.}).value() == -4.);
+
+    const std::vector<double> vals = {0.5, 2.};
+    expect(expr(vals).value() == 5.);
+
+    // changes in the world make the expression relink on its next call
+    a = "a = 2";
+    expect(expr.is_stale());
+    expect(expr({1., 3.}).value() == 14.);
+    expect(not expr.is_stale());
+
+    f = "f(x) = x^2";
+    expect(expr({2., 3.}).value() == 14.);
+
+    // wrong number of inputs
+    expect(expr({1.}).error() == Error::cpp_incorrect_argnum());
+    expect(expr({1., 2., 3.}).error() == Error::cpp_incorrect_argnum());
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "prepared expression with undefined objects"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+
+    auto expr = world.compile("g(x) + 1", {"x"});
+    expect(expr.error() == Error::undefined_function(Text{"g", 0}, "g(x) + 1"));
+    expect(expr({1.}).error() == Error::undefined_function(Text{"g", 0}, "g(x) + 1"));
+
+    auto& g = world.new_object() = "g(x) = 3*x";
+    expect(g.has_value()) << fatal;
+
+    expect(expr({2.}).value() == 7.);
+    expect(not expr.error());
+
+    // the handle gets back in an error state when the object it uses goes away
+    expect(world.erase("g").has_value());
+    expect(expr({2.}).error() == Error::undefined_function(Text{"g", 0}, "g(x) + 1"));
+
+    expect(world.compile("").error() == Error::empty_expression());
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+
+  "prepared expression benchmark"_test = []<class StructType>()
+  {
+    constexpr auto duration = nanoseconds(500ms);
+    constexpr parsing::Type type = parsing_type<StructType>;
+    constexpr std::string_view data_type_str_v = std::is_same_v<StructType, FAST_TEST>  ? "FAST"
+                                                 : std::is_same_v<StructType, RPN_TEST> ? "RPN"
+                                                                                        : "BYTECODE";
+
+    MathWorld<type> world;
+    world.new_object() = "f(x) = 3*cos(3*x) + 2*sin(x/2) + 4";
+
+    double res = 0;
+    size_t iterations =
+      loop_call_for(duration, [&]{
+        res += world.evaluate("f(2) * 3 + 1").value();
+    });
+    std::cout << "Avg MathWorld<" << data_type_str_v << ">::evaluate time: "
+              << duration_cast<nanoseconds>(duration / iterations).count() << "ns"
+              << std::endl;
+    std::cout << "dummy val: " << res << std::endl;
+
+    auto expr = world.compile("f(x) * y + 1", {"x", "y"});
+    res = 0;
+    iterations =
+      loop_call_for(duration, [&]{
+        res += expr({2., 3.}).value();
+    });
+    std::cout << "Avg PreparedExpression<" << data_type_str_v << "> eval time: "
+              << duration_cast<nanoseconds>(duration / iterations).count() << "ns"
+              << std::endl;
+    std::cout << "dummy val: " << res << std::endl;
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   return 0;
 }
@@ -55,4 +55,368 @@ int main()
 
     expect(bool(rpn_expr == expected_rpn)) << "Expected: " << expected_rpn << "Answer: " << rpn_expr;
   };
+
+  "rpn compiled straight from tokens"_test = []()
+  {
+    zc::MathWorld<Type::RPN> world;
+    world.set_inlining(false);
+    world.new_object() = "a = 3";
+    world.new_object() = "f(x, y) = x + y";
+    world.new_object() = "u(n) = 1 ; u(n-1) * 2";
+
+    const std::vector<std::string> input_vars = {"x"};
+
+    // same program as the pipeline without its passes, simplification being the only one compile_rpn follows
+    world.set_simplification(false);
+    for (std::string expression: {"2 - 3 + 2*(3 + cos(4))",
+                                  "-x^2^-a*+3",
+                                  "2^-x^a - -(4)",
+                                  "f(x, -u(f(a, 2))/4)"})
+    {
+      auto expect_rpn = tokenize(expression)
+                          .and_then(make_ast{expression, input_vars})
+                          .transform(flatten_separators)
+                          .and_then(make_fast<Type::RPN>{expression, world})
+                          .transform(make_RPN);
+
+      expect(bool(expect_rpn)) << expression << fatal;
+
+      auto rpn = compile_rpn{expression, world, input_vars}(tokenize(expression).value());
+      expect(rpn == std::optional{*expect_rpn}) << expression;
+    }
+
+    // powers of a single node get the multiplications of simplify()
+    world.set_simplification(true);
+    const RPN::value_type x = shared::node::InputVariable{0};
+    const RPN x_cubed = {x, x, shared::node::Multiply{}, x, shared::node::Multiply{}};
+    expect(compile_rpn{"x^3", world, input_vars}(tokenize("x^3").value()) == std::optional{x_cubed});
+
+    // anything else is left to the usual pipeline
+    for (std::string expression: {"b + 1", "f(1)", "a = 2", "(1, 2)", "f(1, 2) ; 1", "f((1, 2))", "u",
+                                  "(x+1)^2", "x^(1+1)", "x^-(-2)"})
+      expect(not compile_rpn{expression, world, input_vars}(tokenize(expression).value())) << expression;
+
+    expect(world.evaluate("f(a, 2) * u(3)").value() == 40.);
+
+    // same results as linked objects, powers included
+    world.new_object() = "c = 1.1";
+    const std::string powers = "c^3 + c^-2 + c^0.5 + (c+1)^2 + c^(1+1) + 1.1^5 + c^a";
+    auto& h = world.new_object() = "h = " + powers;
+    expect(world.evaluate(powers).value() == h().value());
+
+    auto& g = world.new_object() = "g = 1.1^3 + 0.1*0.3 + 2^-a";
+    for (bool fma: {false, true})
+    {
+      world.set_fma_contraction(fma);
+      expect(world.evaluate("1.1^3 + 0.1*0.3 + 2^-a").value() == g().value()) << fma;
+    }
+    expect(world.evaluate("f(1)").error() == zc::Error::mismatched_fun_args(tokens::Text{"1", 2}, "f(1)"));
+
+    // evaluation errors are returned as is: the expression is not evaluated a second time
+    static size_t calls = 0;
+    world.new_object().set("counted", zc::CppFunction{+[](double x) { calls++; return x; }});
+    world.new_object() = "r(x) = r(x) + 1";
+
+    expect(world.evaluate("counted(1) + r(1)").error() == zc::Error::recursion_depth_overflow());
+    expect(calls == 1_u);
+  };
+
+  "rpn max stack depth"_test = []()
+  {
+    std::string expression = "2 - 3 + 2*(3 + cos(4))";
+
+    zc::MathWorld<Type::RPN> world;
+
+    auto expect_tree = tokenize(expression)
+                         .and_then(make_ast{expression})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<Type::RPN>{expression, world});
+
+    expect(bool(expect_tree)) << expect_tree << fatal;
+
+    // 2 3 - 2 3 4 cos + * +
+    expect(max_stack_depth(make_RPN(expect_tree.value())) == 4_u);
+  };
+
+  "rpn deeper than the fixed size stack"_test = []()
+  {
+    // right nested additions: every '1' stays on the stack until the end
+    const size_t depth = 3 * zc::eval::rpn_stack_size;
+    std::string expression;
+    for (size_t i = 0; i < depth; i++)
+      expression += "1+(";
+    expression += "1" + std::string(depth, ')');
+
+    zc::MathWorld<Type::RPN> world;
+    auto& f = world.new_object() = "f(x) = x + " + expression;
+
+    expect(bool(f)) << fatal;
+    expect(f({1.0}).value() == double(depth + 2));
+  };
+
+  "rpn common subexpressions"_test = []()
+  {
+    std::string expression = "sin(3*x)^2 + cos(3*x)*sin(3*x)";
+
+    zc::MathWorld<Type::RPN> world;
+
+    auto expect_tree = tokenize(expression)
+                         .and_then(make_ast{expression, std::array{"x"}})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<Type::RPN>{expression, world});
+
+    expect(bool(expect_tree)) << expect_tree << fatal;
+
+    auto rpn_expr = make_RPN(expect_tree.value());
+
+    auto cpp_f = [&](std::string_view name)
+    {
+      return std::get<zc::CppFunction<1>>(*world.get(name)->get_linked_repr());
+    };
+
+    // 3*x then sin(3*x) are computed first, and stay at the bottom of the stack
+    RPN expected_rpn = {shared::node::Number{3.0},
+                        shared::node::InputVariable{0},
+                        shared::node::Multiply{},
+                        shared::node::LoadLocal{0},
+                        cpp_f("sin"),
+                        shared::node::LoadLocal{1},
+                        shared::node::Number{2.0},
+                        shared::node::Power{},
+                        shared::node::LoadLocal{0},
+                        cpp_f("cos"),
+                        shared::node::LoadLocal{1},
+                        shared::node::Multiply{},
+                        shared::node::Add{}};
+
+    expect(bool(rpn_expr == expected_rpn)) << "Expected: " << expected_rpn << "Answer: " << rpn_expr;
+
+    auto& f = world.new_object() = "f(x) = " + expression;
+    expect(bool(f)) << fatal;
+
+    for (double x: {-2., 0., 0.3, 5.})
+    {
+      const double expected = std::pow(std::sin(3*x), 2) + std::cos(3*x)*std::sin(3*x);
+      const double res = f({x}).value();
+      expect(std::fabs(res - expected) < 1e-14) << x;
+
+      double batch_res = 0;
+      expect(bool(f.evaluate_batch(std::span(&x, 1), std::span(&batch_res, 1))));
+      expect(batch_res == res) << x;
+    }
+  };
+
+  "rpn common subexpressions calling sequences"_test = []()
+  {
+    zc::MathWorld<Type::RPN> world;
+    auto& u = world.new_object() = "u(n) = 1 ; u(n-1) + 1";
+    auto& f = world.new_object() = "f(x) = u(x+1) * u(x+1)";
+
+    expect(bool(u) and bool(f)) << fatal;
+
+    // sequences are not shared, but their pure arguments are
+    auto repr = *f.get_linked_repr();
+    const RPN& rpn = std::get<const LinkedFunc<Type::RPN>*>(repr)->repr;
+    expect(std::ranges::count_if(rpn, [](auto&& node) { return std::holds_alternative<const LinkedSeq<Type::RPN>*>(node); }) == 2);
+    expect(std::ranges::count_if(rpn, [](auto&& node) { return std::holds_alternative<shared::node::LoadLocal>(node); }) == 2);
+
+    expect(f({3.}).value() == 25.);
+  };
+
+  "rpn common subexpressions calling impure functions"_test = []()
+  {
+    zc::MathWorld<Type::RPN> world;
+    world.set_inlining(false);
+
+    static size_t calls = 0;
+    world.new_object().set("impure", zc::CppFunction{+[](double x) { calls++; return x; }});
+    auto& g = world.new_object() = "g(x) = impure(x) + 1";
+    world.new_object() = "k(x) = 2 * g(x)";
+    auto& f = world.new_object() = "f(x) = k(x) + k(x)";
+
+    expect(bool(g) and bool(f)) << fatal;
+
+    auto calls_num = [](const zc::DynMathObject<Type::RPN>& obj)
+    {
+      const RPN& rpn = std::get<const LinkedFunc<Type::RPN>*>(*obj.get_linked_repr())->repr;
+      return std::ranges::count_if(rpn, [](auto&& node) { return std::holds_alternative<const LinkedFunc<Type::RPN>*>(node); });
+    };
+
+    // functions that call impure ones, even indirectly, are not shared
+    expect(calls_num(f) == 2);
+    expect(f({1.}).value() == 8.);
+    expect(calls == 2_u);
+
+    // purity follows the changes of the functions called
+    g = "g(x) = x + 1";
+    expect(calls_num(f) == 1);
+    expect(f({1.}).value() == 8.);
+
+    g = "g(x) = impure(x) + 1";
+    expect(calls_num(f) == 2);
+    calls = 0;
+    expect(f({1.}).value() == 8.);
+    expect(calls == 2_u);
+  };
+
+  "rpn superinstructions"_test = []()
+  {
+    std::string expression = "2*x + y*math::pi - 4 + x*(y*y)";
+
+    zc::MathWorld<Type::RPN> world;
+
+    auto expect_tree = tokenize(expression)
+                         .and_then(make_ast{expression, std::array{"x", "y"}})
+                         .transform(flatten_separators)
+                         .and_then(make_fast<Type::RPN>{expression, world});
+
+    expect(bool(expect_tree)) << expect_tree << fatal;
+
+    const double* pi = std::get<const double*>(*world.get("math::pi")->get_linked_repr());
+
+    RPN fused = fuse_nodes(make_RPN(expect_tree.value()));
+    RPN expected_rpn = {shared::node::ScaledInput{0, 2.0},
+                        shared::node::InputVariable{1},
+                        shared::node::MultiplyGlobalConstant{pi},
+                        shared::node::Add{},
+                        shared::node::AddNumber{-4.0},
+                        shared::node::InputVariable{0},
+                        shared::node::InputVariable{1},
+                        shared::node::InputVariable{1},
+                        shared::node::Multiply{},
+                        shared::node::Multiply{},
+                        shared::node::Add{}};
+
+    expect(bool(fused == expected_rpn)) << "Expected: " << expected_rpn << "Answer: " << fused;
+    expect(max_stack_depth(fused) == 4_u);
+
+    // x + y*y
+    RPN contracted = fuse_nodes(RPN{shared::node::InputVariable{0},
+                                    shared::node::InputVariable{1},
+                                    shared::node::InputVariable{1},
+                                    shared::node::Multiply{},
+                                    shared::node::Add{}},
+                                true);
+    RPN expected_contracted = {shared::node::InputVariable{0},
+                               shared::node::InputVariable{1},
+                               shared::node::InputVariable{1},
+                               shared::node::MultiplyAdd{}};
+
+    expect(bool(contracted == expected_contracted)) << "Expected: " << expected_contracted << "Answer: " << contracted;
+
+    auto& f = world.new_object() = "f(x, y) = " + expression;
+    auto& g = world.new_object() = "g(x, y) = x + y*y";
+    expect(bool(f) and bool(g)) << fatal;
+
+    constexpr std::array xs = {-2., 0.1, 0.3, 7.};
+    constexpr std::array ys = {1.1, -0.7, 1e8, 3.};
+
+    auto results = [&](const auto& obj)
+    {
+      std::array<double, xs.size()> res;
+      for (size_t i = 0; i < xs.size(); i++)
+        res[i] = obj({xs[i], ys[i]}).value();
+      return res;
+    };
+
+    auto batch_results = [&](const auto& obj)
+    {
+      std::array<double, xs.size()> res;
+      expect(bool(obj.evaluate_batch(std::array<std::span<const double>, 2>{xs, ys}, res)));
+      return res;
+    };
+
+    // superinstructions give the exact same results
+    const auto fused_res = results(f);
+    expect(batch_results(f) == fused_res);
+
+    world.set_node_fusion(false);
+    expect(not world.get_node_fusion());
+    expect(results(f) == fused_res);
+
+    world.set_node_fusion(true);
+    world.set_fma_contraction(true);
+    expect(world.get_fma_contraction());
+
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+      const double expected = std::fma(ys[i], ys[i], xs[i]);
+      expect(g({xs[i], ys[i]}).value() == expected) << xs[i] << ys[i];
+      expect(batch_results(g)[i] == expected) << xs[i] << ys[i];
+    }
+  };
+
+  "rpn vector math"_test = []()
+  {
+    namespace approx = zc::approx;
+
+    RPN rpn = use_vector_math(RPN{shared::node::InputVariable{0},
+                                  zc::CppFunction<1>{std::cos},
+                                  zc::CppFunction<1>{std::log10},
+                                  zc::CppFunction<1>{std::log}});
+    RPN expected_rpn = {shared::node::InputVariable{0},
+                        zc::CppFunction<1>{approx::cos},
+                        zc::CppFunction<1>{std::log10},
+                        zc::CppFunction<1>{approx::log}};
+
+    expect(bool(rpn == expected_rpn)) << "Expected: " << expected_rpn << "Answer: " << rpn;
+
+    zc::MathWorld<Type::RPN> world;
+    auto& f = world.new_object() = "f(x) = cos(x) + sin(3*x) * exp(-x/4) - ln(x^2 + 1)";
+    expect(bool(f)) << fatal;
+
+    auto reference = [](double x)
+    {
+      return std::cos(x) + std::sin(3 * x) * std::exp(-x / 4) - std::log(x * x + 1);
+    };
+
+    // odd number of points to exercise the scalar tail of the vector kernels
+    std::vector<double> xs;
+    for (double x = -20; x <= 20; x += 0.37)
+      xs.push_back(x);
+    xs.push_back(1e6);
+
+    std::vector<double> out(xs.size());
+
+    // libm by default
+    expect(not world.get_vector_math());
+    for (double x: xs)
+      expect(f({x}).value() == reference(x)) << x;
+
+    world.set_vector_math(true);
+    expect(world.get_vector_math());
+
+    // one-shot evaluations get the approximations too
+    expect(world.evaluate("cos(2) + ln(3)").value() == approx::cos(2) + approx::log(3));
+
+    expect(bool(f.evaluate_batch(xs, out))) << fatal;
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+      const double res = f({xs[i]}).value();
+      expect(out[i] == res) << xs[i];
+      expect(std::abs(res - reference(xs[i])) <= 1e-13 * std::max(1., std::abs(reference(xs[i])))) << xs[i];
+    }
+
+    // special values are handled as in libm
+    using Func = double (*)(double);
+    const std::array<std::pair<Func, Func>, 4> approximations = {{
+      {approx::cos, [](double x) { return std::cos(x); }},
+      {approx::sin, [](double x) { return std::sin(x); }},
+      {approx::exp, [](double x) { return std::exp(x); }},
+      {approx::log, [](double x) { return std::log(x); }},
+    }};
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    for (double x: {0., -0., 1., -1., 1e-310, 700., -740., std::numbers::pi, inf, -inf})
+      for (auto [approximation, libm]: approximations)
+      {
+        const double res = approximation(x), expected = libm(x);
+        if (std::isnan(expected))
+          expect(std::isnan(res)) << x << res;
+        else if (std::isinf(expected) or expected == 0)
+          expect(res == expected and std::signbit(res) == std::signbit(expected)) << x << res << expected;
+        else expect(std::abs(res - expected) <= 4 * std::numeric_limits<double>::epsilon() * std::abs(expected))
+               << x << res << expected;
+      }
+  };
 }
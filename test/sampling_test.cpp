@@ -0,0 +1,132 @@
+/****************************************************************************
+**  Copyright (c) 2023, Adel Kara Slimane <adel.ks@zegrapher.com>
+**
+**  This file is part of ZeCalculator.
+**
+**  ZeCalculators is free software: you may copy, redistribute and/or modify it
+**  under the terms of the GNU Affero General Public License as published by the
+**  Free Software Foundation, either version 3 of the License, or (at your
+**  option) any later version.
+**
+**  This file is distributed in the hope that it will be useful, but
+**  WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+**  General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <zecalculator/zecalculator.h>
+
+// testing specific headers
+#include <boost/ut.hpp>
+#include <zecalculator/test-utils/print-utils.h>
+#include <zecalculator/test-utils/structs.h>
+
+#include <cmath>
+
+using namespace zc;
+
+/// @brief biggest vertical distance, in pixels, between the curve of 'f' and the polyline, over a fine grid
+template <class F>
+double max_pixel_error(const SampledCurve& curve, F&& f, double pixel_height)
+{
+  double max_error = 0;
+  for (size_t i = 1; i < curve.points.size(); i++)
+  {
+    const auto [x0, y0] = curve.points[i-1];
+    const auto [x1, y1] = curve.points[i];
+    if (not std::isfinite(y0) or not std::isfinite(y1))
+      continue;
+
+    for (double t = 0.1; t < 1; t += 0.1)
+    {
+      const double x = std::lerp(x0, x1, t);
+      max_error = std::max(max_error, std::abs(f(x) - std::lerp(y0, y1, t)) / pixel_height);
+    }
+  }
+  return max_error;
+}
+
+int main()
+{
+  using namespace boost::ut;
+
+  "straight lines are not refined"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object() = "f(x) = 2*x + 1";
+
+    auto curve = sample_adaptive(f, -1., 1., {.pixel_width = 0.01, .pixel_height = 0.01, .initial_samples = 17});
+    expect(bool(curve)) << fatal;
+
+    // the initial points, then the middle of each segment between them
+    expect(curve->evaluations == 33_ul);
+    expect(curve->batches == 2_ul);
+    expect(curve->points.size() == 33_ul);
+    expect(std::ranges::is_sorted(curve->points, {}, &SampledCurve::Point::x));
+    expect(curve->points.front() == SampledCurve::Point{-1, -1});
+    expect(curve->points.back() == SampledCurve::Point{1, 3});
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "curves are sampled within tolerance"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object() = "f(x) = sin(x^2) + exp(-10*(x-1)^2)";
+
+    // a 1000x500 pixels plot
+    const SamplingOptions options = {.pixel_width = 4. / 1000, .pixel_height = 4. / 500};
+    auto curve = sample_adaptive(f, -2., 2., options);
+    expect(bool(curve)) << fatal;
+
+    const double error = max_pixel_error(*curve,
+                                         [](double x) { return std::sin(x*x) + std::exp(-10*(x-1)*(x-1)); },
+                                         options.pixel_height);
+    expect(error < 2 * options.tolerance) << error;
+
+    // much less than one evaluation per pixel
+    expect(curve->evaluations < 400_ul) << curve->evaluations;
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "bounds of the domain get located"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object() = "f(x) = sqrt(x - 0.3) + sqrt(0.8 - x)";
+
+    const SamplingOptions options = {.pixel_width = 0.001, .pixel_height = 0.001};
+    auto curve = sample_adaptive(f, -1., 1., options);
+    expect(bool(curve)) << fatal;
+
+    auto first_finite = std::ranges::find_if(curve->points, [](auto p) { return std::isfinite(p.y); });
+    auto last_finite = std::ranges::find_if(curve->points | std::views::reverse,
+                                            [](auto p) { return std::isfinite(p.y); });
+    expect(first_finite != curve->points.end()) << fatal;
+    expect(first_finite->x - 0.3 < options.pixel_width);
+    expect(0.8 - last_finite->x < options.pixel_width);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "sampling errors"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& f = world.new_object() = "f(x, y) = x + y";
+    auto& g = world.new_object() = "g(x) = h(x)";
+
+    const SamplingOptions options = {.pixel_width = 0.01, .pixel_height = 0.01};
+    expect(not sample_adaptive(f, 0., 1., options));
+    expect(not sample_adaptive(g, 0., 1., options));
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+}
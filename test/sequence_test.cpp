@@ -33,7 +33,7 @@ int main()
 
   "fibonacci sequence"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& fib = world.new_object() = "fib(n) = 0 ; 1 ; fib(n-1) + fib(n-2)";
@@ -52,11 +52,11 @@ int main()
     auto* fib_obj = world.get("fib");
     expect(fib_obj && (*fib_obj)({10}).value() == 55.0_d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "fibonacci sequence with cache"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     eval::Cache cache;
 
@@ -79,32 +79,138 @@ int main()
     auto* fib_obj = world.get("fib");
     expect(fib_obj && (*fib_obj)({10}, &cache).value() == 55.0_d);
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "recursive sequences are evaluated bottom-up"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& fib = world.new_object() = "fib(n) = 0 ; 1 ; fib(n-1) + fib(n-2)";
+    auto& count = world.new_object() = "count(n) = 0 ; count(n-1) + 1";
+    auto& square = world.new_object() = "square(n) = 1 ; n^2";
+
+    expect(bool(fib) and bool(count) and bool(square)) << fatal;
+
+    double a = 0, b = 1;
+    for (int i = 0; i != 100; i++)
+      b = std::exchange(a, b) + b;
+
+    // top-down evaluation overflows the recursion depth: the missing terms get computed bottom-up
+    expect(fib({100}).value() == a);
+    expect(count({1e6}).value() == 1e6);
+
+    // the terms end up in the cache, when one is given
+    eval::Cache cache;
+    expect(fib({200}, &cache).has_value());
+    expect(fib({150}, &cache).value() == fib({150}).value());
+
+    // sequences that do not call themselves are evaluated directly
+    expect(square({1e9}).value() == 1e18);
+
+    // sparse recurrences only compute the terms they ask for, top-down
+    auto& digits = world.new_object() = "digits(n) = 0 ; digits(n/10) + 1";
+    expect(bool(digits)) << fatal;
+
+    expect(digits({1e12}).value() == 13.);
+
+    eval::Cache digits_cache;
+    expect(digits({5e6}, &digits_cache).value() == 8.);
+    expect(digits_cache.find(digits.get_slot())->indexed()->get_capacity()
+           == eval::IndexCache::default_capacity);
+
+    // the cache grows along with the terms computed bottom-up, up to a bounded capacity
+    eval::max_bottom_up_cache_capacity = 4096;
+    eval::Cache count_cache;
+    expect(count({1e5}, &count_cache).value() == 1e5);
+    expect(count_cache.find(count.get_slot())->indexed()->get_capacity() == 4096_ul);
+    eval::max_bottom_up_cache_capacity = size_t(1) << 20;
+
+    // the number of terms computed at once is bounded
+    expect(count({1e12}).error() == Error::recursion_depth_overflow());
+    expect(count({1e30}).error() == Error::recursion_depth_overflow());
+    expect(square({1e30}).value() == std::pow(1e30, 2));
+
+    // indices that are not numbers, or infinite, give NaN like negative ones
+    expect(std::isnan(count({std::nan("")}).value()));
+    expect(std::isnan(count({std::numeric_limits<double>::infinity()}).value()));
+    expect(std::isnan(world.evaluate("count(0/0) + fib(1/0)").value()));
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "recursive sequences looking back further than the cache capacity"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& u = world.new_object() = "u(n) = 1 ; 1 ; u(n-1) + u(n/2)";
+
+    expect(bool(u)) << fatal;
+
+    constexpr size_t n = 100'000;
+    static_assert(n / 2 > eval::IndexCache::default_capacity);
+
+    std::vector<double> terms = {1, 1};
+    for (size_t i = 2; i <= n; i++)
+      terms.push_back(terms[i-1] + terms[size_t(std::round(double(i) / 2))]);
+
+    // the terms computed bottom-up are not evicted while they are still needed
+    expect(u({double(n)}).value() == terms[n]);
+
+    eval::Cache cache;
+    expect(u({double(n/2)}, &cache).value() == terms[n/2]);
+    expect(u({double(n)}, &cache).value() == terms[n]);
+    expect(u({double(n/4)}, &cache).value() == terms[n/4]);
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
+
+  "sequence cache backends"_test = []<class StructType>()
+  {
+    constexpr parsing::Type type = parsing_type<StructType>;
+
+    MathWorld<type> world;
+    auto& fib = world.new_object() = "fib(n) = 0 ; 1 ; fib(n-1) + fib(n-2)";
+    auto& u = world.new_object() = "u(n) = 2 ; u(n-1) + 1";
+
+    expect(bool(fib) and bool(u)) << fatal;
+
+    // sequences get an index-addressed cache by default
+    eval::Cache cache;
+    expect(fib({50}, &cache).value() == 12586269025.);
+    expect(cache.find(fib.get_slot())->get_backend() == eval::SlotCache::INDEXED);
+
+    // a backend selected beforehand is kept
+    cache.get_or_create(u.get_slot(), eval::SlotCache::KEYED);
+    expect(u({10}, &cache).value() == 12.);
+    expect(cache.find(u.get_slot())->get_backend() == eval::SlotCache::KEYED);
+    expect(cache.find(u.get_slot())->get_value(u.get_revision(), 9.) == std::optional{11.});
+
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "recursion depth overflow"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& bad = world.new_object() = "bad(n) = bad(n+10) + bad(n+20)";
 
     expect(bad({0}).error() == Error::recursion_depth_overflow());
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 
   "invalid function depending on invalid sequence"_test = []<class StructType>()
   {
-    constexpr parsing::Type type = std::is_same_v<StructType, FAST_TEST> ? parsing::Type::FAST : parsing::Type::RPN;
+    constexpr parsing::Type type = parsing_type<StructType>;
 
     MathWorld<type> world;
     auto& f = world.new_object() = "f(x) = cos(x) + u(n)";
     auto& u = world.new_object() = "u(n) = 1 ; 1 ; u";
 
     expect(f.error().value().type == Error::UNDEFINED_VARIABLE) << f.error().value().type;
-    expect(f.error().value().token == parsing::Token::Variable("n", 18)) << f.error().value().token;
+    expect(f.error().value().token == parsing::tokens::OwnedText{"n", 18}) << f.error().value().token;
 
     expect(u.error().value().type == Error::WRONG_OBJECT_TYPE) << u.error().value().type;
-    expect(u.error().value().token == parsing::Token::Variable("u", 15)) << u.error().value().token;
+    expect(u.error().value().token == parsing::tokens::OwnedText{"u", 15}) << u.error().value().token;
 
-  } | std::tuple<FAST_TEST, RPN_TEST>{};
+  } | std::tuple<FAST_TEST, RPN_TEST, BYTECODE_TEST>{};
 }
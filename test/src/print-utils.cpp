@@ -7,6 +7,12 @@
 namespace std {
 
 std::ostream& operator<<(std::ostream& os, const zc::parsing::tokens::Text& txt_token)
+{
+  os << txt_token.size << " chars at " << txt_token.begin << " ";
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const zc::parsing::tokens::OwnedText& txt_token)
 {
   os << txt_token.substr << " at " << txt_token.begin << " ";
   return os;
@@ -14,7 +20,7 @@ std::ostream& operator<<(std::ostream& os, const zc::parsing::tokens::Text& txt_
 
 std::ostream &operator<<(std::ostream &os, const zc::parsing::Token &token)
 {
-  os << magic_enum::enum_name(token.type) << " " << token.substr;
+  os << magic_enum::enum_name(token.type) << " at " << token.begin;
   return os;
 }
 
@@ -35,6 +41,13 @@ void shared_node_printer(std::ostream& os,
         zc::parsing::shared::node::UnaryMinus,
         zc::parsing::shared::node::InputVariable,
         zc::parsing::shared::node::Number,
+        zc::parsing::shared::node::LoadLocal,
+        zc::parsing::shared::node::AddNumber,
+        zc::parsing::shared::node::MultiplyNumber,
+        zc::parsing::shared::node::AddGlobalConstant,
+        zc::parsing::shared::node::MultiplyGlobalConstant,
+        zc::parsing::shared::node::ScaledInput,
+        zc::parsing::shared::node::MultiplyAdd,
         zc::parsing::LinkedFunc,
         zc::parsing::LinkedData,
         zc::parsing::LinkedSeq;
@@ -77,7 +90,32 @@ void shared_node_printer(std::ostream& os,
       [&](const Number &n)
       {
         os << "Number " << n.value;
-      }},
+      },
+      [&](const LoadLocal &l)
+      {
+        os << "LoadLocal: index: " << l.index;
+      },
+      [&](const AddNumber &n)
+      {
+        os << "+ Number " << n.value;
+      },
+      [&](const MultiplyNumber &n)
+      {
+        os << "× Number " << n.value;
+      },
+      [&](const AddGlobalConstant &c)
+      {
+        os << "+ Global Constant value: " << *c.constant;
+      },
+      [&](const MultiplyGlobalConstant &c)
+      {
+        os << "× Global Constant value: " << *c.constant;
+      },
+      [&](const ScaledInput &v)
+      {
+        os << "ScaledInput: index: " << v.index << " factor: " << v.factor;
+      },
+      [&](MultiplyAdd) { os << "fma "; }},
     node);
 }
 
@@ -95,15 +133,22 @@ std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+std::ostream& operator<<(std::ostream& os,
+                         const zc::parsing::shared::Node<zc::parsing::Type::BYTECODE>& node)
+{
+  shared_node_printer(os, node);
+  return os;
+}
+
 template <zc::parsing::Type type>
-void fast_printer(std::ostream& os, const zc::parsing::FAST<type>& node, size_t padding = 0)
+void fast_printer(std::ostream& os, typename zc::parsing::FAST<type>::Ref node, size_t padding = 0)
 {
-  shared_node_printer(os, node.node, padding);
-  if (not node.subnodes.empty())
+  shared_node_printer(os, node.node(), padding);
+  if (not node.subnodes().empty())
   {
     os << "{\n";
-    for (auto&& subnode: node.subnodes)
-      fast_printer(os, subnode, padding + 2);
+    for (auto subnode: node.subnodes())
+      fast_printer<type>(os, subnode, padding + 2);
     os << std::string(padding, ' ') << "}";
   }
   os << std::endl;
@@ -112,18 +157,25 @@ void fast_printer(std::ostream& os, const zc::parsing::FAST<type>& node, size_t
 std::ostream &operator<<(std::ostream &os,
                          const zc::parsing::FAST<zc::parsing::Type::FAST> &node)
 {
-  fast_printer(os, node);
+  fast_printer<zc::parsing::Type::FAST>(os, node);
   return os;
 }
 
 std::ostream &operator<<(std::ostream &os,
                          const zc::parsing::FAST<zc::parsing::Type::RPN> &node)
 {
-  fast_printer(os, node);
+  fast_printer<zc::parsing::Type::RPN>(os, node);
+  return os;
+}
+
+std::ostream &operator<<(std::ostream &os,
+                         const zc::parsing::FAST<zc::parsing::Type::BYTECODE> &node)
+{
+  fast_printer<zc::parsing::Type::BYTECODE>(os, node);
   return os;
 }
 
-void syntax_node_print_helper(std::ostream& os, const zc::parsing::AST& node, size_t padding = 0)
+void syntax_node_print_helper(std::ostream& os, zc::parsing::AST::Ref node, size_t padding = 0)
 {
   const std::string padding_str(padding, ' ');
 
@@ -132,31 +184,31 @@ void syntax_node_print_helper(std::ostream& os, const zc::parsing::AST& node, si
       [&](const zc::parsing::AST::Func &func)
       {
         if (func.type == zc::parsing::AST::Func::FUNCTION)
-          os << padding_str << "Function<" << func.subnodes.size()
+          os << padding_str << "Function<" << node.subnodes().size()
               << "> ";
         else
           os << padding_str << magic_enum::enum_name(func.type);
 
-        os << " at " << node.name.begin
+        os << " at " << node->name.begin
             << " subexpr: " << func.full_expr << " {" << std::endl;
-        for (auto &&operand : func.subnodes)
+        for (auto operand : node.subnodes())
           syntax_node_print_helper(os, operand, padding + 2);
         os << padding_str << "}" << std::endl;
       },
       [&](const zc::parsing::AST::InputVariable &input_var)
       {
-        os << padding_str << "InputVariable " << node.name
+        os << padding_str << "InputVariable " << node->name
             << "index: " << size_t(input_var.index) << std::endl;
       },
       [&](const zc::parsing::AST::Number &)
       {
-        os << padding_str << "Number " << node.name << std::endl;
+        os << padding_str << "Number " << node->name << std::endl;
       },
       [&](zc::parsing::AST::Variable)
       {
-        os << padding_str << "Variable " << node.name << std::endl;
+        os << padding_str << "Variable " << node->name << std::endl;
       }},
-      node.dyn_data);
+      node->dyn_data);
 }
 
 std::ostream& operator << (std::ostream& os, const zc::parsing::AST& node)
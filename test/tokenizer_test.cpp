@@ -225,7 +225,7 @@ int main()
 
     const auto& token = parsing.value()[2];
 
-    expect(token.substr == "cos");
+    expect(token.in(str) == "cos");
     expect(token.begin == 2);
   };
 
@@ -279,7 +279,7 @@ int main()
       expr.resize(static_expr_size + i, ' ');
 
       auto exp_parsing = tokenize(expr);
-      dummy += exp_parsing.value().back().substr.size();
+      dummy += exp_parsing.value().back().size;
     });
 
     // the absolute value doesn't mean anything really, but we can compare between performance improvements
@@ -1,3 +1,4 @@
+#include <zecalculator/evaluation/index_cache.h>
 #include <zecalculator/evaluation/object_cache.h>
 #include <zecalculator/zecalculator.h>
 
@@ -5,6 +6,7 @@
 #include <boost/ut.hpp>
 #include <zecalculator/test-utils/print-utils.h>
 #include <zecalculator/test-utils/structs.h>
+#include <zecalculator/test-utils/utils.h>
 
 using namespace zc;
 
@@ -144,6 +146,166 @@ int main()
     expect(cache.get_buffer_size() == 2_u);
   };
 
+  "ObjectCache: least recently used value gets evicted"_test = []()
+  {
+    eval::ObjectCache cache({1., 2., 3.}, {1., 2., 3.}, 0, 3);
+
+    // reading 1 makes 2 the least recently used value
+    expect(cache.get_value(0, 1.) == std::optional{1.});
+    cache.insert(0, 4., 4.);
+
+    expect(cache.get_cache().keys() == std::vector{1., 3., 4.}) << cache.get_cache().keys();
+    expect(cache.size() == 3_ul);
+  };
+
+  "ObjectCache insert benchmark"_test = []()
+  {
+    constexpr auto duration = nanoseconds(200ms);
+
+    // the insert cost should not depend on the buffer size
+    for (size_t buffer_size: {32ul, 1024ul, 32768ul})
+    {
+      eval::ObjectCache cache(buffer_size);
+      double key = 0;
+      size_t iterations =
+        loop_call_for(duration, [&]{
+          cache.insert(0, key, key);
+          key++;
+      });
+      std::cout << "Avg ObjectCache insert time, buffer size " << buffer_size << ": "
+                << duration_cast<nanoseconds>(duration / iterations).count() << "ns"
+                << std::endl;
+      expect(cache.size() == std::min(buffer_size, iterations));
+    }
+  };
+
+  "IndexCache: slots, revision and clear"_test = []()
+  {
+    eval::IndexCache cache(3);
+
+    // rounded up to a power of two
+    expect(cache.get_capacity() == 4_ul);
+
+    cache.insert(0, 0, 10.);
+    cache.insert(0, 1, 11.);
+    expect(cache.get_value(0, 0) == std::optional{10.});
+    expect(cache.get_value(0, 1) == std::optional{11.});
+    expect(not cache.get_value(0, 2).has_value());
+
+    // index 4 shares its slot with index 0
+    cache.insert(0, 4, 14.);
+    expect(cache.get_value(0, 4) == std::optional{14.});
+    expect(not cache.get_value(0, 0).has_value());
+    expect(cache.get_value(0, 1) == std::optional{11.});
+
+    // a new revision drops everything
+    expect(not cache.get_value(1, 1).has_value());
+    cache.insert(1, 2, 22.);
+    expect(cache.get_cached_revision() == 1_u);
+    expect(cache.get_value(1, 2) == std::optional{22.});
+    expect(not cache.get_value(1, 1).has_value());
+
+    cache.clear();
+    expect(not cache.get_value(1, 2).has_value());
+  };
+
+  "IndexCache: growing keeps the values"_test = []()
+  {
+    eval::IndexCache cache(4);
+
+    cache.insert(0, 1, 11.);
+    cache.insert(0, 6, 16.);
+
+    // already large enough
+    cache.reserve(3);
+    expect(cache.get_capacity() == 4_ul);
+
+    cache.reserve(5);
+    expect(cache.get_capacity() == 8_ul);
+    expect(cache.get_value(0, 1) == std::optional{11.});
+    expect(cache.get_value(0, 6) == std::optional{16.});
+
+    // indices 4 and 5 no longer share their slots with 0 and 1
+    cache.insert(0, 0, 10.);
+    cache.insert(0, 4, 14.);
+    cache.insert(0, 5, 15.);
+    expect(cache.get_value(0, 0) == std::optional{10.});
+    expect(cache.get_value(0, 1) == std::optional{11.});
+
+    // cleared values do not come back
+    cache.clear();
+    cache.reserve(16);
+    expect(not cache.get_value(0, 6).has_value());
+  };
+
+  "IndexCache: growing before the first insertion"_test = []()
+  {
+    eval::IndexCache cache;
+    expect(not cache.get_value(0, 0).has_value());
+
+    cache.reserve(5000);
+    expect(cache.get_capacity() == 8192_ul);
+
+    cache.insert(0, 1, 11.);
+    cache.insert(0, 4097, 14097.);
+    expect(cache.get_value(0, 1) == std::optional{11.});
+    expect(cache.get_value(0, 4097) == std::optional{14097.});
+  };
+
+  "SlotCache: backend selection"_test = []()
+  {
+    eval::SlotCache keyed;
+    expect(keyed.get_backend() == eval::SlotCache::KEYED);
+    keyed.insert(0, 0.5, 1.);
+    expect(keyed.get_value(0, 0.5) == std::optional{1.});
+
+    eval::SlotCache indexed(eval::SlotCache::INDEXED);
+    expect(indexed.indexed() != nullptr and indexed.keyed() == nullptr);
+
+    // non-integer keys are not stored
+    indexed.insert(0, 0.5, 1.);
+    indexed.insert(0, -1., 1.);
+    indexed.insert(0, 3., 3.);
+    expect(not indexed.get_value(0, 0.5).has_value());
+    expect(not indexed.get_value(0, -1.).has_value());
+
+    // neither are keys out of the range of size_t
+    indexed.insert(0, 1e30, 1.);
+    expect(not indexed.get_value(0, 1e30).has_value());
+    expect(not indexed.get_value(0, 0x1p64).has_value());
+    expect(not indexed.get_value(0, std::numeric_limits<double>::infinity()).has_value());
+    expect(indexed.get_value(0, 3.) == std::optional{3.});
+
+    // switching drops the values
+    indexed.use(eval::SlotCache::KEYED);
+    expect(indexed.get_backend() == eval::SlotCache::KEYED);
+    expect(not indexed.get_value(0, 3.).has_value());
+  };
+
+  "Cache: per slot caches"_test = []()
+  {
+    eval::Cache cache;
+
+    expect(cache.find(3) == nullptr);
+    expect(cache.size() == 0_ul);
+
+    // created lazily, the backend is only used on creation
+    auto& slot_cache = cache.get_or_create(3, eval::SlotCache::INDEXED);
+    expect(&cache.get_or_create(3) == &slot_cache);
+    expect(slot_cache.get_backend() == eval::SlotCache::INDEXED);
+    expect(not cache.contains(0) and cache.contains(3));
+
+    // other slots do not move existing caches
+    cache[100].insert(0, 1., 1.);
+    expect(cache.find(3) == &slot_cache);
+    expect(cache.size() == 2_ul);
+
+    cache.erase(3);
+    expect(cache.find(3) == nullptr);
+    expect(cache.size() == 1_ul);
+    expect(cache[100].get_value(0, 1.) == std::optional{1.});
+  };
+
   "LHS parsing"_test = []()
   {
     using parsing::tokens::Text;